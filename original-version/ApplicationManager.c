@@ -19,6 +19,7 @@
 #include "SocketServer.h"
 #include "util.h"
 #include "DataPublisher.h"
+#include "FanOut.h"
 #include "MeasurementCoordinator.h"
 #include "TimingUtils.h"
 #include "HardwareManager.h"
@@ -34,6 +35,7 @@ struct ApplicationManager {
     GPSData gps_measurements;
     BatteryState battery_state;
     SenderContext* sender_ctx;
+    FanOut* fan_out;
     CsvLogger csv_logger;
     
     pthread_mutex_t cal_mutex;
@@ -145,9 +147,14 @@ AppManagerError app_manager_init(ApplicationManager* app) {
         return APP_ERROR_COORDINATOR_INIT_FAILED;
     }
     
-    app->data_publisher = data_publisher_create(app->sender_ctx);
+    // Optional extra outputs (ScadaBR, socket); a failure here only loses those sinks
+    app->fan_out = fan_out_create_from_env();
+    
+    app->data_publisher = data_publisher_create(app->sender_ctx, app->fan_out);
     if (!app->data_publisher) {
         fprintf(stderr, "Failed to create Data Publisher.\n");
+        fan_out_destroy(app->fan_out);
+        app->fan_out = NULL; // app_manager_destroy() runs after a failed init too
         sender_destroy(app->sender_ctx);
         pthread_mutex_destroy(&app->cal_mutex);
         hardware_manager_cleanup(&app->hardware_manager);
@@ -189,7 +196,10 @@ void app_manager_destroy(ApplicationManager* app) {
     
     data_publisher_destroy(app->data_publisher);
     hardware_manager_cleanup(&app->hardware_manager);
-    sender_destroy(app->sender_ctx);
+    fan_out_destroy(app->fan_out);
+    SenderContext* sender = app->sender_ctx;
+    app->sender_ctx = NULL; // Nothing may reach the sender once its teardown starts
+    sender_destroy(sender);
     csv_logger_close(&app->csv_logger);
     pthread_mutex_destroy(&app->cal_mutex);
     
@@ -203,6 +213,11 @@ void app_manager_signal_shutdown(ApplicationManager* app) {
     app->keep_running = false;
 }
 
+void app_manager_request_replay(ApplicationManager* app) {
+    if (!app) return;
+    sender_request_replay(app->sender_ctx);
+}
+
 const char* app_manager_error_string(AppManagerError error) {
     switch (error) {
         case APP_SUCCESS:
@@ -68,6 +68,14 @@ void app_manager_destroy(ApplicationManager* app);
  */
 void app_manager_signal_shutdown(ApplicationManager* app);
 
+/**
+ * @brief Asks the sender to replay the offline backlog now (SIGUSR1).
+ *
+ * Async-signal-safe, so main.c can call it from its signal handler.
+ * @param app A pointer to the ApplicationManager instance.
+ */
+void app_manager_request_replay(ApplicationManager* app);
+
 /**
  * @brief Converts an error code to a human-readable string.
  *
@@ -0,0 +1,143 @@
+#include "BufferPool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+struct BufferPool {
+    PooledBuffer* headers;   // Slab of buffer headers
+    char* storage;           // Slab of buffer memory (slab_count * buffer_capacity)
+    size_t buffer_capacity;
+    size_t slab_count;
+    PooledBuffer* free_list; // Slab buffers ready to be acquired
+    size_t in_use;
+    unsigned long long heap_fallbacks;
+    pthread_mutex_t mutex;
+};
+
+BufferPool* buffer_pool_create(size_t buffer_capacity, size_t slab_count) {
+    if (buffer_capacity < 2) return NULL;
+
+    BufferPool* pool = calloc(1, sizeof(BufferPool));
+    if (!pool) {
+        perror("Failed to allocate BufferPool");
+        return NULL;
+    }
+
+    if (slab_count > 0) {
+        pool->headers = calloc(slab_count, sizeof(PooledBuffer));
+        pool->storage = malloc(slab_count * buffer_capacity);
+        if (!pool->headers || !pool->storage) {
+            perror("Failed to allocate BufferPool slab");
+            free(pool->headers);
+            free(pool->storage);
+            free(pool);
+            return NULL;
+        }
+    }
+
+    pool->buffer_capacity = buffer_capacity;
+    pool->slab_count = slab_count;
+
+    // Thread every slab buffer onto the free list
+    for (size_t i = 0; i < slab_count; i++) {
+        PooledBuffer* buffer = &pool->headers[i];
+        buffer->data = pool->storage + i * buffer_capacity;
+        buffer->capacity = buffer_capacity;
+        buffer->pool = pool;
+        buffer->from_slab = true;
+        buffer->next = pool->free_list;
+        pool->free_list = buffer;
+    }
+
+    pthread_mutex_init(&pool->mutex, NULL);
+    return pool;
+}
+
+void buffer_pool_destroy(BufferPool* pool) {
+    if (!pool) return;
+    if (pool->in_use > 0) {
+        fprintf(stderr, "BufferPool: destroyed with %zu buffers still in use\n", pool->in_use);
+    }
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool->headers);
+    free(pool->storage);
+    free(pool);
+}
+
+// Allocates a standalone buffer (header and data in one block) outside the slab
+static PooledBuffer* allocate_heap_buffer(BufferPool* pool, size_t capacity) {
+    PooledBuffer* buffer = malloc(sizeof(PooledBuffer) + capacity);
+    if (!buffer) {
+        perror("Failed to allocate fallback buffer");
+        return NULL;
+    }
+    buffer->data = (char*)(buffer + 1);
+    buffer->capacity = capacity;
+    buffer->pool = pool;
+    buffer->from_slab = false;
+    return buffer;
+}
+
+PooledBuffer* buffer_pool_acquire_sized(BufferPool* pool, size_t min_capacity) {
+    if (!pool) return NULL;
+
+    PooledBuffer* buffer = NULL;
+    pthread_mutex_lock(&pool->mutex);
+    if (min_capacity <= pool->buffer_capacity && pool->free_list) {
+        buffer = pool->free_list;
+        pool->free_list = buffer->next;
+    } else {
+        pool->heap_fallbacks++;
+    }
+    pool->in_use++;
+    pthread_mutex_unlock(&pool->mutex);
+
+    if (!buffer) {
+        size_t capacity = min_capacity > pool->buffer_capacity ? min_capacity : pool->buffer_capacity;
+        buffer = allocate_heap_buffer(pool, capacity);
+        if (!buffer) {
+            pthread_mutex_lock(&pool->mutex);
+            pool->in_use--;
+            pthread_mutex_unlock(&pool->mutex);
+            return NULL;
+        }
+    }
+
+    buffer->next = NULL;
+    buffer->length = 0;
+    buffer->data[0] = '\0';
+    return buffer;
+}
+
+PooledBuffer* buffer_pool_acquire(BufferPool* pool) {
+    return buffer_pool_acquire_sized(pool, 0);
+}
+
+void pooled_buffer_release(PooledBuffer** buffer) {
+    if (!buffer || !*buffer) return;
+
+    PooledBuffer* released = *buffer;
+    *buffer = NULL;
+    BufferPool* pool = released->pool;
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->in_use--;
+    if (released->from_slab) {
+        released->next = pool->free_list;
+        pool->free_list = released;
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    if (!released->from_slab) {
+        free(released);
+    }
+}
+
+void buffer_pool_get_stats(BufferPool* pool, BufferPoolStats* stats) {
+    if (!pool || !stats) return;
+    pthread_mutex_lock(&pool->mutex);
+    stats->slab_buffers = pool->slab_count;
+    stats->in_use = pool->in_use;
+    stats->heap_fallbacks = pool->heap_fallbacks;
+    pthread_mutex_unlock(&pool->mutex);
+}
@@ -0,0 +1,80 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+/**
+ * @file BufferPool.h
+ * @brief A thread-safe pool of fixed-size text buffers carved from a single slab.
+ *
+ * Buffers are handed between modules by ownership transfer: functions that
+ * take a `PooledBuffer**` consume the buffer and set the caller's pointer to
+ * NULL, so a buffer always has exactly one owner and is never copied. Once
+ * the slab is warm, acquiring and releasing buffers performs no heap
+ * allocation. If the slab is exhausted (or a larger buffer is requested),
+ * the pool falls back to a heap allocation that is freed again on release.
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef struct BufferPool BufferPool; // Opaque pool type
+
+typedef struct PooledBuffer {
+    char* data;                 // Always null-terminated within `capacity`
+    size_t length;              // Number of bytes in use, excluding the terminator
+    size_t capacity;            // Usable size of `data`
+    struct PooledBuffer* next;  // Intrusive link for the current owner (e.g. DataQueue)
+    BufferPool* pool;           // Pool the buffer returns to
+    bool from_slab;             // false for heap fallback buffers
+} PooledBuffer;
+
+typedef struct {
+    size_t slab_buffers;                    // Buffers carved from the slab
+    size_t in_use;                          // Buffers currently acquired
+    unsigned long long heap_fallbacks;      // Acquisitions that had to malloc
+} BufferPoolStats;
+
+/**
+ * @brief Creates a pool backed by one slab of `slab_count` buffers.
+ * @param buffer_capacity The usable size of each slab buffer.
+ * @param slab_count Number of buffers preallocated in the slab.
+ * @return A pointer to the new pool, or NULL on failure.
+ */
+BufferPool* buffer_pool_create(size_t buffer_capacity, size_t slab_count);
+
+/**
+ * @brief Destroys the pool. All buffers must have been released beforehand.
+ * @param pool The pool to destroy.
+ */
+void buffer_pool_destroy(BufferPool* pool);
+
+/**
+ * @brief Acquires an empty buffer of the pool's standard capacity.
+ * @param pool The pool.
+ * @return An empty buffer owned by the caller, or NULL on allocation failure.
+ */
+PooledBuffer* buffer_pool_acquire(BufferPool* pool);
+
+/**
+ * @brief Acquires an empty buffer able to hold at least `min_capacity` bytes.
+ *
+ * Requests larger than the standard capacity are served from the heap.
+ * @param pool The pool.
+ * @param min_capacity Minimum usable size, including the null terminator.
+ * @return An empty buffer owned by the caller, or NULL on allocation failure.
+ */
+PooledBuffer* buffer_pool_acquire_sized(BufferPool* pool, size_t min_capacity);
+
+/**
+ * @brief Returns a buffer to its pool and clears the caller's reference.
+ * @param buffer Address of the caller's buffer pointer; may point to NULL.
+ */
+void pooled_buffer_release(PooledBuffer** buffer);
+
+/**
+ * @brief Takes a consistent snapshot of the pool counters.
+ * @param pool The pool.
+ * @param stats Output structure.
+ */
+void buffer_pool_get_stats(BufferPool* pool, BufferPoolStats* stats);
+
+#endif // BUFFER_POOL_H
@@ -0,0 +1,172 @@
+#include "Compression.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#define GZIP_OUTPUT_INITIAL_SIZE (16 * 1024)
+
+struct GzipCompressor {
+    z_stream stream;
+    gz_header header;   // Only used by members with an extra field
+    unsigned char** output;
+    size_t* output_capacity;
+    bool failed;    // Sticky until the next begin()
+};
+
+GzipCompressor* gzip_compressor_create(int level) {
+    GzipCompressor* compressor = calloc(1, sizeof(GzipCompressor));
+    if (!compressor) {
+        perror("Failed to allocate gzip compressor");
+        return NULL;
+    }
+
+    // windowBits 15 + 16 selects the gzip wrapper expected by InfluxDB's Content-Encoding: gzip
+    if (deflateInit2(&compressor->stream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        fprintf(stderr, "deflateInit2 failed for compression level %d\n", level);
+        free(compressor);
+        return NULL;
+    }
+    return compressor;
+}
+
+void gzip_compressor_destroy(GzipCompressor* compressor) {
+    if (!compressor) return;
+    deflateEnd(&compressor->stream);
+    free(compressor);
+}
+
+void gzip_compressor_begin(GzipCompressor* compressor, unsigned char** output, size_t* output_capacity) {
+    gzip_compressor_begin_extra(compressor, output, output_capacity, NULL, 0);
+}
+
+void gzip_compressor_begin_extra(GzipCompressor* compressor, unsigned char** output, size_t* output_capacity,
+                                 const unsigned char* extra, size_t extra_size) {
+    // Keeps the allocated window and hash tables; only the stream state is cleared
+    deflateReset(&compressor->stream);
+    if (extra) {
+        memset(&compressor->header, 0, sizeof(compressor->header));
+        compressor->header.extra = (Bytef*)extra;
+        compressor->header.extra_len = (uInt)extra_size;
+        compressor->header.os = 3; // Unix, as in zlib's default header
+        deflateSetHeader(&compressor->stream, &compressor->header);
+    } else {
+        deflateSetHeader(&compressor->stream, Z_NULL); // deflateReset() keeps a previous custom header
+    }
+    compressor->output = output;
+    compressor->output_capacity = output_capacity;
+    compressor->failed = false;
+    compressor->stream.next_out = *output;
+    compressor->stream.avail_out = (uInt)*output_capacity;
+}
+
+// Doubles the output buffer and points the stream at its unused tail
+static bool grow_output(GzipCompressor* compressor) {
+    size_t used = compressor->stream.total_out;
+    size_t capacity = *compressor->output_capacity;
+    size_t new_capacity = capacity ? capacity * 2 : GZIP_OUTPUT_INITIAL_SIZE;
+
+    unsigned char* new_output = realloc(*compressor->output, new_capacity);
+    if (!new_output) {
+        perror("Failed to allocate memory for compressed data");
+        return false;
+    }
+    *compressor->output = new_output;
+    *compressor->output_capacity = new_capacity;
+    compressor->stream.next_out = new_output + used;
+    compressor->stream.avail_out = (uInt)(new_capacity - used);
+    return true;
+}
+
+static bool run_deflate(GzipCompressor* compressor, int flush) {
+    for (;;) {
+        if (compressor->stream.avail_out == 0 && !grow_output(compressor)) {
+            return false;
+        }
+        int status = deflate(&compressor->stream, flush);
+        if (status == Z_STREAM_END) return true;
+        if (status != Z_OK && status != Z_BUF_ERROR) {
+            fprintf(stderr, "deflate failed: %d\n", status);
+            return false;
+        }
+        // Without Z_FINISH we are done once all input is consumed and output space is left
+        if (flush == Z_NO_FLUSH && compressor->stream.avail_in == 0 && compressor->stream.avail_out > 0) {
+            return true;
+        }
+    }
+}
+
+bool gzip_compressor_append(GzipCompressor* compressor, const void* data, size_t size) {
+    if (!compressor || compressor->failed) return false;
+    if (size == 0) return true;
+
+    compressor->stream.next_in = (Bytef*)data;
+    compressor->stream.avail_in = (uInt)size;
+    if (!run_deflate(compressor, Z_NO_FLUSH)) {
+        compressor->failed = true;
+    }
+    return !compressor->failed;
+}
+
+bool gzip_compressor_finish(GzipCompressor* compressor, size_t* output_size) {
+    if (!compressor || compressor->failed) return false;
+
+    compressor->stream.next_in = Z_NULL;
+    compressor->stream.avail_in = 0;
+    if (!run_deflate(compressor, Z_FINISH)) {
+        compressor->failed = true;
+        return false;
+    }
+    *output_size = compressor->stream.total_out;
+    return true;
+}
+
+bool gzip_decompress_stream(const void* data, size_t size, size_t chunk_size, gzip_output_func_t on_output,
+                            void* user_context) {
+    unsigned char* chunk = malloc(chunk_size);
+    if (!chunk) {
+        perror("Failed to allocate decompression buffer");
+        return false;
+    }
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (inflateInit2(&stream, 15 + 16) != Z_OK) { // gzip wrapper only
+        free(chunk);
+        return false;
+    }
+    stream.next_in = (Bytef*)data;
+    stream.avail_in = (uInt)size;
+
+    bool success = true;
+    while (success) {
+        stream.next_out = chunk;
+        stream.avail_out = (uInt)chunk_size;
+        int status = inflate(&stream, Z_NO_FLUSH);
+        size_t produced = chunk_size - stream.avail_out;
+        if (produced > 0 && !on_output(chunk, produced, user_context)) {
+            success = false;
+        } else if (status == Z_STREAM_END) {
+            if (stream.avail_in == 0) break;
+            inflateReset(&stream); // Next member
+        } else if (status != Z_OK) {
+            fprintf(stderr, "inflate failed: %d\n", status);
+            success = false;
+        }
+    }
+    inflateEnd(&stream);
+    free(chunk);
+    return success;
+}
+
+int gzip_level_from_string(const char* text) {
+    if (!text || *text == '\0') return GZIP_DEFAULT_LEVEL;
+
+    char* endptr;
+    long level = strtol(text, &endptr, 10);
+    if (*endptr != '\0' || level < Z_NO_COMPRESSION || level > Z_BEST_COMPRESSION) {
+        fprintf(stderr, "Ignoring invalid compression level '%s', using the default.\n", text);
+        return GZIP_DEFAULT_LEVEL;
+    }
+    return (int)level;
+}
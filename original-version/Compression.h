@@ -0,0 +1,110 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * @file Compression.h
+ * @brief Reusable streaming gzip compressor for outgoing batches.
+ *
+ * A compressor keeps one deflate stream for its whole lifetime and resets it
+ * between batches instead of allocating zlib's internal state every time.
+ * Input is compressed as it is appended, while it is still in cache, and the
+ * output is written into a caller-owned buffer that is grown only when a batch
+ * needs more room, so steady-state compression does not allocate.
+ *
+ * A compressor is not thread-safe; each thread that compresses owns its own.
+ */
+
+#define GZIP_DEFAULT_LEVEL (-1) // zlib's default trade-off (level 6)
+
+typedef struct GzipCompressor GzipCompressor; // Opaque compressor type
+
+/**
+ * @brief Creates a compressor.
+ * @param level zlib compression level, 0 (store) to 9 (smallest), or GZIP_DEFAULT_LEVEL.
+ * @return A pointer to the compressor, or NULL on failure.
+ */
+GzipCompressor* gzip_compressor_create(int level);
+
+/**
+ * @brief Frees the compressor. Output buffers stay owned by their callers.
+ * @param compressor The compressor to destroy.
+ */
+void gzip_compressor_destroy(GzipCompressor* compressor);
+
+/**
+ * @brief Starts a new gzip member written into `*output`.
+ *
+ * The buffer is grown with realloc() as needed and both `*output` and
+ * `*output_capacity` are updated in place, so they must stay valid until
+ * gzip_compressor_finish() returns.
+ *
+ * @param compressor The compressor.
+ * @param output In/out: the output buffer (may point to NULL initially). Caller frees.
+ * @param output_capacity In/out: the allocated size of `*output`.
+ */
+void gzip_compressor_begin(GzipCompressor* compressor, unsigned char** output, size_t* output_capacity);
+
+/**
+ * @brief Like gzip_compressor_begin(), but stores `extra` in the FEXTRA field of the member header.
+ *
+ * The field is written at a fixed position: two length bytes at offset 10,
+ * followed by the `extra` bytes from offset 12. Since the header carries no
+ * checksum, those bytes can be patched in the output after the member is
+ * finished, e.g. to record the member's own size.
+ *
+ * @param compressor The compressor.
+ * @param output In/out: the output buffer (may point to NULL initially). Caller frees.
+ * @param output_capacity In/out: the allocated size of `*output`.
+ * @param extra Extra field contents (RFC 1952 subfields); must stay valid until the first append.
+ * @param extra_size Number of bytes in `extra`.
+ */
+void gzip_compressor_begin_extra(GzipCompressor* compressor, unsigned char** output, size_t* output_capacity,
+                                 const unsigned char* extra, size_t extra_size);
+
+/**
+ * @brief Compresses the next piece of input.
+ * @param compressor The compressor.
+ * @param data Input bytes.
+ * @param size Number of input bytes.
+ * @return false if compression or an output allocation failed; the member is then unusable.
+ */
+bool gzip_compressor_append(GzipCompressor* compressor, const void* data, size_t size);
+
+/**
+ * @brief Completes the gzip member started by gzip_compressor_begin().
+ * @param compressor The compressor.
+ * @param output_size Out: number of compressed bytes in the output buffer.
+ * @return true on success, false if any step of this member failed.
+ */
+bool gzip_compressor_finish(GzipCompressor* compressor, size_t* output_size);
+
+// Receives decompressed data in pieces; returns false to stop early
+typedef bool (*gzip_output_func_t)(const void* data, size_t size, void* user_context);
+
+/**
+ * @brief Decompresses a gzip stream of one or more concatenated members.
+ *
+ * Output is handed to `on_output` in pieces of at most `chunk_size` bytes as
+ * it is produced, so arbitrarily large streams need only one chunk of memory.
+ *
+ * @param data The compressed stream.
+ * @param size Number of bytes in `data`.
+ * @param chunk_size Size of the output buffer.
+ * @param on_output Called for every piece of output.
+ * @param user_context Passed to `on_output`.
+ * @return true if the whole stream was valid and `on_output` never asked to stop.
+ */
+bool gzip_decompress_stream(const void* data, size_t size, size_t chunk_size, gzip_output_func_t on_output,
+                            void* user_context);
+
+/**
+ * @brief Parses a compression level ("0"-"9"), falling back to GZIP_DEFAULT_LEVEL.
+ * @param text The level as text, may be NULL.
+ * @return The compression level.
+ */
+int gzip_level_from_string(const char* text);
+
+#endif // COMPRESSION_H
@@ -0,0 +1,128 @@
+#include "Crc32c.h"
+#include <pthread.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#define CRC32C_HAVE_HARDWARE 1
+#elif defined(__aarch64__)
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#define CRC32C_HAVE_HARDWARE 1
+#endif
+
+#define CRC32C_POLYNOMIAL 0x82F63B78U // Reflected Castagnoli polynomial
+
+typedef uint32_t (*crc32c_func_t)(uint32_t crc, const unsigned char* data, size_t size);
+
+static pthread_once_t g_once = PTHREAD_ONCE_INIT;
+static crc32c_func_t g_update;
+static const char* g_implementation;
+static uint32_t g_table[8][256]; // Slicing-by-8 tables, software version only
+
+// --- Software ---
+
+static void build_table(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (CRC32C_POLYNOMIAL & (0U - (crc & 1)));
+        }
+        g_table[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        for (int slice = 1; slice < 8; slice++) {
+            g_table[slice][i] = (g_table[slice - 1][i] >> 8) ^ g_table[0][g_table[slice - 1][i] & 0xFF];
+        }
+    }
+}
+
+static uint32_t update_software(uint32_t crc, const unsigned char* data, size_t size) {
+    while (size >= 8) {
+        uint32_t low = crc ^ ((uint32_t)data[0] | (uint32_t)data[1] << 8 | (uint32_t)data[2] << 16 |
+                              (uint32_t)data[3] << 24);
+        crc = g_table[7][low & 0xFF] ^ g_table[6][(low >> 8) & 0xFF] ^ g_table[5][(low >> 16) & 0xFF] ^
+              g_table[4][low >> 24] ^ g_table[3][data[4]] ^ g_table[2][data[5]] ^ g_table[1][data[6]] ^
+              g_table[0][data[7]];
+        data += 8;
+        size -= 8;
+    }
+    while (size-- > 0) {
+        crc = (crc >> 8) ^ g_table[0][(crc ^ *data++) & 0xFF];
+    }
+    return crc;
+}
+
+// --- Hardware ---
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2")))
+static uint32_t update_hardware(uint32_t crc, const unsigned char* data, size_t size) {
+    uint64_t crc64 = crc;
+    while (size >= 8) {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word)); // Unaligned load
+        crc64 = _mm_crc32_u64(crc64, word);
+        data += 8;
+        size -= 8;
+    }
+    crc = (uint32_t)crc64;
+    while (size-- > 0) {
+        crc = _mm_crc32_u8(crc, *data++);
+    }
+    return crc;
+}
+
+static int hardware_available(void) {
+    return __builtin_cpu_supports("sse4.2");
+}
+
+#define HARDWARE_NAME "sse4.2"
+#elif defined(__aarch64__)
+__attribute__((target("+crc")))
+static uint32_t update_hardware(uint32_t crc, const unsigned char* data, size_t size) {
+    while (size >= 8) {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        crc = __crc32cd(crc, word);
+        data += 8;
+        size -= 8;
+    }
+    while (size-- > 0) {
+        crc = __crc32cb(crc, *data++);
+    }
+    return crc;
+}
+
+static int hardware_available(void) {
+    return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+}
+
+#define HARDWARE_NAME "armv8-crc"
+#endif
+
+static void select_implementation(void) {
+#ifdef CRC32C_HAVE_HARDWARE
+    if (hardware_available()) {
+        g_update = update_hardware;
+        g_implementation = HARDWARE_NAME;
+        return;
+    }
+#endif
+    build_table();
+    g_update = update_software;
+    g_implementation = "software";
+}
+
+// --- Public Functions ---
+
+uint32_t crc32c_update(uint32_t crc, const void* data, size_t size) {
+    pthread_once(&g_once, select_implementation);
+    return ~g_update(~crc, data, size);
+}
+
+const char* crc32c_implementation(void) {
+    pthread_once(&g_once, select_implementation);
+    return g_implementation;
+}
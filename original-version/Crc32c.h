@@ -0,0 +1,35 @@
+#ifndef CRC32C_H
+#define CRC32C_H
+
+/**
+ * @file Crc32c.h
+ * @brief CRC-32C (Castagnoli) checksums, using the CPU's CRC instruction when it has one.
+ *
+ * On x86-64 with SSE4.2 and on AArch64 with the CRC extension the checksum is
+ * computed by the dedicated instruction, eight bytes at a time; elsewhere a
+ * table-driven software version produces the same values. The implementation
+ * is chosen once, on first use, and is safe to call from any thread.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Extends a CRC-32C with more data.
+ *
+ * Start with 0; feeding data in pieces gives the same result as feeding it at once.
+ *
+ * @param crc The checksum of the data so far.
+ * @param data The next bytes.
+ * @param size Number of bytes in `data`.
+ * @return The checksum including `data`.
+ */
+uint32_t crc32c_update(uint32_t crc, const void* data, size_t size);
+
+/**
+ * @brief Names the implementation in use, e.g. for a startup message.
+ * @return "sse4.2", "armv8-crc" or "software".
+ */
+const char* crc32c_implementation(void);
+
+#endif // CRC32C_H
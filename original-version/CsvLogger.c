@@ -5,6 +5,24 @@
 #include <sys/stat.h> // For mkdir
 #include <math.h>     // For isfinite
 
+static const char* const GPS_COLUMNS[] = { "latitude", "longitude", "altitude", "speed" };
+
+// Writes ",<value>" with the fewest digits that read back as the same value
+static void write_value(FILE* file, double value, int significant_digits) {
+    char text[FLOAT_FORMAT_MAX_LENGTH];
+    float_format(value, significant_digits, text);
+    fprintf(file, ",%s", text);
+}
+
+// Unavailable GPS values leave the column empty
+static void write_gps_value(FILE* file, double value, int significant_digits) {
+    if (isfinite(value)) {
+        write_value(file, value, significant_digits);
+    } else {
+        fputc(',', file);
+    }
+}
+
 void csv_logger_init(CsvLogger* logger, const Channel* channels) {
     logger->file_handle = NULL;
     logger->is_active = false;
@@ -29,6 +47,13 @@ void csv_logger_init(CsvLogger* logger, const Channel* channels) {
         logger->is_active = true;
         printf("CSV logging is ENABLED. Logging to file: %s\n", filename);
 
+        for (int i = 0; i < NUM_CHANNELS; i++) {
+            logger->channel_digits[i] = float_format_field_digits(channels[i].id);
+        }
+        for (int i = 0; i < 4; i++) {
+            logger->gps_digits[i] = float_format_field_digits(GPS_COLUMNS[i]);
+        }
+
         // Write header
         fprintf(logger->file_handle, "timestamp_iso8601,epoch_seconds");
         for (int i = 0; i < NUM_CHANNELS; i++) {
@@ -55,29 +80,18 @@ void csv_logger_log(const CsvLogger* logger, const Channel* channels, const GPSD
     fprintf(logger->file_handle, "%s,%ld", time_buf, now);
 
     for (int i = 0; i < NUM_CHANNELS; i++) {
-        fprintf(logger->file_handle, ",%d,%.4f", channels[i].raw_adc_value, channel_get_calibrated_value(&channels[i]));
+        fprintf(logger->file_handle, ",%d", channels[i].raw_adc_value);
+        write_value(logger->file_handle, channel_get_calibrated_value(&channels[i]), logger->channel_digits[i]);
     }
 
     // Handle potentially unavailable GPS data
-    if (gps_data && isfinite(gps_data->latitude)) {
-        fprintf(logger->file_handle, ",%.6f", gps_data->latitude);
-    } else {
-        fprintf(logger->file_handle, ",");
-    }
-    if (gps_data && isfinite(gps_data->longitude)) {
-        fprintf(logger->file_handle, ",%.6f", gps_data->longitude);
-    } else {
-        fprintf(logger->file_handle, ",");
-    }
-    if (gps_data && isfinite(gps_data->altitude)) {
-        fprintf(logger->file_handle, ",%.2f", gps_data->altitude);
-    } else {
-        fprintf(logger->file_handle, ",");
-    }
-    if (gps_data && isfinite(gps_data->speed)) {
-        fprintf(logger->file_handle, ",%.2f", gps_data->speed);
+    if (gps_data) {
+        write_gps_value(logger->file_handle, gps_data->latitude, logger->gps_digits[0]);
+        write_gps_value(logger->file_handle, gps_data->longitude, logger->gps_digits[1]);
+        write_gps_value(logger->file_handle, gps_data->altitude, logger->gps_digits[2]);
+        write_gps_value(logger->file_handle, gps_data->speed, logger->gps_digits[3]);
     } else {
-        fprintf(logger->file_handle, ",");
+        fprintf(logger->file_handle, ",,,,");
     }
 
     fprintf(logger->file_handle, "\n");
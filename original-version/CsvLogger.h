@@ -5,11 +5,14 @@
 #include <stdbool.h>
 #include "Measurement.h"
 #include "DataPublisher.h"
+#include "FloatFormat.h"
 
 // A structure to hold the state of the CSV logger
 typedef struct {
     FILE* file_handle;
     bool is_active;
+    int channel_digits[NUM_CHANNELS]; // Significant digits per value column, FLOAT_FORMAT_SHORTEST if unset
+    int gps_digits[4];                // latitude, longitude, altitude, speed
 } CsvLogger;
 
 /**
@@ -1,67 +1,106 @@
 #include "DataPublisher.h"
 #include "LineProtocol.h"
+#include "PointRecord.h"
 #include <stdio.h>
 #include <math.h>
 #include <stdlib.h>
 
+#define LAYOUT_COUNT (1u << FRAME_MAX_VALUES) // Every combination of active channels and valid GPS fields
+#define SCHEMA_UNREGISTERED (-2)                // -1 records a layout whose names were rejected
+
 struct DataPublisher {
-    LineProtocolBuilder* lp_builder;
     SenderContext* sender_ctx;
+    FanOut* fan_out;
+    // Point schema of each frame layout, registered the first time the layout is seen
+    int schema_ids[LAYOUT_COUNT];
 };
 
-DataPublisher* data_publisher_create(SenderContext* sender_ctx) {
+DataPublisher* data_publisher_create(SenderContext* sender_ctx, FanOut* fan_out) {
     if (!sender_ctx) return NULL;
     
     DataPublisher* publisher = malloc(sizeof(DataPublisher));
     if (!publisher) return NULL;
     
-    publisher->lp_builder = lp_builder_create_default();
-    if (!publisher->lp_builder) {
-        free(publisher);
-        return NULL;
+    for (unsigned int i = 0; i < LAYOUT_COUNT; ++i) {
+        publisher->schema_ids[i] = SCHEMA_UNREGISTERED;
     }
-    
     publisher->sender_ctx = sender_ctx;
+    publisher->fan_out = fan_out;
     return publisher;
 }
 
 void data_publisher_destroy(DataPublisher* publisher) {
     if (!publisher) return;
-    
-    if (publisher->lp_builder) {
-        lp_builder_destroy(publisher->lp_builder);
-    }
     free(publisher);
 }
 
-static bool add_channel_fields(LineProtocolBuilder* builder, const Channel channels[]) {
-    for (int i = 0; i < NUM_CHANNELS; ++i) {
-        if (!channels[i].is_active) continue; 
-        LineProtocolError error = lp_add_field_double(builder, 
-            channels[i].id, 
-            channel_get_calibrated_value(&channels[i]));
-        if (error != LP_SUCCESS) {
-            fprintf(stderr, "Error adding field for channel %d: %d\n", 
-                    channels[i].id, error);
-            return false;
-        }
+// Adds a value and marks its slot (channel index, or NUM_CHANNELS + GPS field index) in the layout
+static void frame_add_value(MeasurementFrame* frame, unsigned int* layout, unsigned int slot,
+                            const char* name, double value) {
+    if (frame->count < FRAME_MAX_VALUES) {
+        frame->values[frame->count].name = name;
+        frame->values[frame->count].value = value;
+        frame->count++;
+        *layout |= 1u << slot;
     }
-    return true;
 }
 
-static void add_gps_fields(LineProtocolBuilder* builder, const GPSData* gps_data) {
+// Snapshots the active channels and the valid GPS fields once for every sink.
+// Returns the layout: which of the possible values the frame holds.
+static unsigned int capture_frame(MeasurementFrame* frame, const Channel channels[], const GPSData* gps_data) {
+    unsigned int layout = 0;
+    frame->timestamp = lp_get_current_timestamp();
+    frame->count = 0;
+
+    for (int i = 0; i < NUM_CHANNELS; ++i) {
+        if (!channels[i].is_active) continue;
+        frame_add_value(frame, &layout, (unsigned int)i, channels[i].id, channel_get_calibrated_value(&channels[i]));
+    }
     if (isfinite(gps_data->latitude)) {
-        lp_add_field_double(builder, "latitude", gps_data->latitude);
+        frame_add_value(frame, &layout, NUM_CHANNELS, "latitude", gps_data->latitude);
     }
     if (isfinite(gps_data->longitude)) {
-        lp_add_field_double(builder, "longitude", gps_data->longitude);
+        frame_add_value(frame, &layout, NUM_CHANNELS + 1, "longitude", gps_data->longitude);
     }
     if (isfinite(gps_data->altitude)) {
-        lp_add_field_double(builder, "altitude", gps_data->altitude);
+        frame_add_value(frame, &layout, NUM_CHANNELS + 2, "altitude", gps_data->altitude);
     }
     if (isfinite(gps_data->speed)) {
-        lp_add_field_double(builder, "speed", gps_data->speed);
+        frame_add_value(frame, &layout, NUM_CHANNELS + 3, "speed", gps_data->speed);
+    }
+    return layout;
+}
+
+// Names are validated and copied into the registry once per layout, not per point
+static int schema_for_layout(DataPublisher* publisher, unsigned int layout, const MeasurementFrame* frame) {
+    if (publisher->schema_ids[layout] != SCHEMA_UNREGISTERED) return publisher->schema_ids[layout];
+
+    static const char* const tag_keys[] = { "source" };
+    static const char* const tag_values[] = { "instrumentacao" };
+    const char* field_names[FRAME_MAX_VALUES];
+    for (size_t i = 0; i < frame->count; ++i) {
+        field_names[i] = frame->values[i].name;
+    }
+    int schema_id = point_schema_register("measurements", tag_keys, tag_values, 1, field_names, frame->count);
+    publisher->schema_ids[layout] = schema_id;
+    return schema_id;
+}
+
+// Queues the frame for InfluxDB as a compact record; line protocol is rendered by the sender
+static bool publish_to_influxdb(DataPublisher* publisher, unsigned int layout, const MeasurementFrame* frame) {
+    int schema_id = schema_for_layout(publisher, layout, frame);
+    if (schema_id < 0) return false;
+
+    // Encode straight into a pooled buffer and hand that same buffer to the sender
+    PooledBuffer* buffer = sender_acquire_buffer(publisher->sender_ctx);
+    if (!buffer) return false;
+    buffer->length = point_record_encode(schema_id, frame, buffer->data, buffer->capacity);
+    if (buffer->length == 0) { // point_record_encode reports why
+        pooled_buffer_release(&buffer);
+        return false;
     }
+    sender_submit_buffer(publisher->sender_ctx, &buffer);
+    return true;
 }
 
 bool data_publisher_publish(DataPublisher* publisher, 
@@ -69,27 +108,11 @@ bool data_publisher_publish(DataPublisher* publisher,
                            const GPSData* gps_data) {
     if (!publisher || !channels || !gps_data) return false;
     
-    lp_builder_reset(publisher->lp_builder);
+    MeasurementFrame frame;
+    unsigned int layout = capture_frame(&frame, channels, gps_data);
     
-    // Set measurement and tags
-    if (lp_set_measurement(publisher->lp_builder, "measurements") != LP_SUCCESS ||
-        lp_add_tag(publisher->lp_builder, "source", "instrumentacao") != LP_SUCCESS) {
-        return false;
-    }
-    
-    // Add fields
-    if (!add_channel_fields(publisher->lp_builder, channels)) {
-        return false;
-    }
-    
-    add_gps_fields(publisher->lp_builder, gps_data);
-    
-    // Set timestamp and send
-    lp_set_timestamp_now(publisher->lp_builder);
-    
-    const char* lp_string = lp_view(publisher->lp_builder);
-    if (!lp_string) return false;
-    
-    sender_submit(publisher->sender_ctx, lp_string);
-    return true;
-}
\ No newline at end of file
+    // Each sink encodes the same frame into its own queue; none of them can block the others
+    bool success = publish_to_influxdb(publisher, layout, &frame);
+    fan_out_publish(publisher->fan_out, &frame);
+    return success;
+}
@@ -3,6 +3,7 @@
 
 #include "Measurement.h"
 #include "Sender.h"
+#include "FanOut.h"
 
 typedef struct {
     double latitude;
@@ -13,11 +14,11 @@ typedef struct {
 
 typedef struct DataPublisher DataPublisher;
 
-// Create/destroy publisher
-DataPublisher* data_publisher_create(SenderContext* sender_ctx);
+// Create/destroy publisher. `fan_out` (optional) receives every frame published to InfluxDB.
+DataPublisher* data_publisher_create(SenderContext* sender_ctx, FanOut* fan_out);
 void data_publisher_destroy(DataPublisher* publisher);
 
-// Publish measurements to InfluxDB
+// Publish measurements to InfluxDB and to the fan-out sinks
 bool data_publisher_publish(DataPublisher* publisher, 
                            const Channel channels[], 
                            const GPSData* gps_data);
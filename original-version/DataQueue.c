@@ -3,27 +3,64 @@
 #include <string.h>
 #include <stdio.h>
 #include <pthread.h>
-
-// Node for the linked list queue
-typedef struct DataNode {
-    char* data;
-    struct DataNode* next;
-} DataNode;
+#include <time.h>
 
 // Thread-safe queue structure
 struct DataQueue {
-    DataNode* head;
-    DataNode* tail;
+    PooledBuffer* head;
+    PooledBuffer* tail;
+    BufferPool* pool;  // Source of buffers for copied strings
+    size_t count;      // Number of items currently queued
+    size_t bytes;      // Sum of string lengths currently queued
     pthread_mutex_t mutex;
     pthread_cond_t cond;
+    pthread_cond_t not_full; // Signalled when the consumer frees space (BLOCK policy)
     volatile int shutdown; // Flag to signal threads to exit
+    int wakeup_pending;    // Set by data_queue_wakeup() to interrupt a batch dequeue
+
+    // Overflow handling
+    size_t max_items;
+    size_t max_bytes;
+    DataQueueOverflowPolicy policy;
+    data_queue_spill_func_t spill_func;
+    void* spill_context;
+    DataQueueStats stats;
 };
 
+// Detaches the front buffer of the queue. Must be called with the mutex held.
+static PooledBuffer* pop_front_locked(DataQueue* q) {
+    PooledBuffer* node = q->head;
+    q->head = node->next;
+    if (q->head == NULL) {
+        q->tail = NULL;
+    }
+    node->next = NULL;
+    q->count--;
+    q->bytes -= node->length;
+    return node;
+}
+
+// True if adding `length` more bytes would push the queue past a high-water mark.
+static int is_over_limit_locked(const DataQueue* q, size_t length) {
+    if (q->count == 0) return 0; // An empty queue always accepts one item
+    if (q->max_items > 0 && q->count + 1 > q->max_items) return 1;
+    if (q->max_bytes > 0 && q->bytes + length > q->max_bytes) return 1;
+    return 0;
+}
+
+// True while the queue is above the low-water mark (half of each high-water mark).
+static int is_above_low_water_locked(const DataQueue* q) {
+    if (q->count == 0) return 0;
+    if (q->max_items > 0 && q->count > q->max_items / 2) return 1;
+    if (q->max_bytes > 0 && q->bytes > q->max_bytes / 2) return 1;
+    return 0;
+}
+
 /**
  * @brief Creates and initializes a new thread-safe data queue.
  * @return A pointer to the new DataQueue, or NULL on failure.
  */
-DataQueue* data_queue_create() {
+DataQueue* data_queue_create(BufferPool* pool) {
     DataQueue* q = (DataQueue*)malloc(sizeof(DataQueue));
     if (!q) {
         perror("Failed to allocate DataQueue");
@@ -31,9 +68,27 @@ DataQueue* data_queue_create() {
     }
     q->head = NULL;
     q->tail = NULL;
+    q->pool = pool;
+    q->count = 0;
+    q->bytes = 0;
     q->shutdown = 0;
+    q->wakeup_pending = 0;
+    q->max_items = 0;
+    q->max_bytes = 0;
+    q->policy = DATA_QUEUE_OVERFLOW_BLOCK;
+    q->spill_func = NULL;
+    q->spill_context = NULL;
+    memset(&q->stats, 0, sizeof(q->stats));
     pthread_mutex_init(&q->mutex, NULL);
-    pthread_cond_init(&q->cond, NULL);
+
+    // Use the monotonic clock for timed waits so wall-clock jumps (NTP, GPS time sync)
+    // don't stretch or cut short a batch deadline.
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&q->cond, &cond_attr);
+    pthread_cond_init(&q->not_full, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
     return q;
 }
 
@@ -43,42 +98,130 @@ DataQueue* data_queue_create() {
  */
 void data_queue_destroy(DataQueue* q) {
     if (!q) return;
-    // Free any remaining nodes in the list
-    DataNode* current = q->head;
+    // Return any remaining buffers to their pool
+    PooledBuffer* current = q->head;
     while (current != NULL) {
-        DataNode* next = current->next;
-        free(current->data); // Free the string copy
-        free(current);       // Free the node itself
+        PooledBuffer* next = current->next;
+        pooled_buffer_release(&current);
         current = next;
     }
     pthread_mutex_destroy(&q->mutex);
     pthread_cond_destroy(&q->cond);
+    pthread_cond_destroy(&q->not_full);
     free(q);
 }
 
+void data_queue_set_overflow_policy(DataQueue* q, size_t max_items, size_t max_bytes,
+                                    DataQueueOverflowPolicy policy,
+                                    data_queue_spill_func_t spill_func, void* spill_context) {
+    if (!q) return;
+    if (policy == DATA_QUEUE_OVERFLOW_SPILL && !spill_func) {
+        fprintf(stderr, "DataQueue: spill policy requires a spill callback, falling back to drop-oldest\n");
+        policy = DATA_QUEUE_OVERFLOW_DROP_OLDEST;
+    }
+
+    pthread_mutex_lock(&q->mutex);
+    q->max_items = max_items;
+    q->max_bytes = max_bytes;
+    q->policy = policy;
+    q->spill_func = spill_func;
+    q->spill_context = spill_context;
+    // Limits may have been relaxed, let blocked producers re-check
+    pthread_cond_broadcast(&q->not_full);
+    pthread_mutex_unlock(&q->mutex);
+}
+
+void data_queue_get_stats(DataQueue* q, DataQueueStats* stats) {
+    if (!q || !stats) return;
+    pthread_mutex_lock(&q->mutex);
+    *stats = q->stats;
+    stats->current_items = q->count;
+    stats->current_bytes = q->bytes;
+    pthread_mutex_unlock(&q->mutex);
+}
+
+size_t data_queue_size(DataQueue* q) {
+    if (!q) return 0;
+    pthread_mutex_lock(&q->mutex);
+    size_t count = q->count;
+    pthread_mutex_unlock(&q->mutex);
+    return count;
+}
+
 /**
  * @brief Enqueues a data item.
  *
- * Makes a copy of the data string and adds it to the tail of the queue.
+ * Copies the data string into a pooled buffer and queues it.
  * @param q The queue.
  * @param data The null-terminated string data to enqueue.
  */
 void data_queue_enqueue(DataQueue* q, const char* data) {
-    DataNode* new_node = (DataNode*)malloc(sizeof(DataNode));
-    if (!new_node) {
-        perror("Failed to allocate DataNode");
-        return;
-    }
-    // strdup allocates memory for the copy and copies the string
-    new_node->data = strdup(data);
-    if (!new_node->data) {
-        perror("Failed to duplicate string for queue");
-        free(new_node);
+    size_t length = strlen(data);
+    PooledBuffer* buffer = buffer_pool_acquire_sized(q->pool, length + 1);
+    if (!buffer) {
+        fprintf(stderr, "Failed to acquire buffer for queue\n");
         return;
     }
+    memcpy(buffer->data, data, length + 1);
+    buffer->length = length;
+    data_queue_enqueue_buffer(q, &buffer);
+}
+
+/**
+ * @brief Enqueues a filled buffer, taking ownership of it.
+ *
+ * Applies the overflow policy first if the queue is at its high-water mark.
+ * @param q The queue.
+ * @param buffer Address of the caller's buffer pointer, cleared on return.
+ */
+void data_queue_enqueue_buffer(DataQueue* q, PooledBuffer** buffer) {
+    if (!q || !buffer || !*buffer) return;
+    PooledBuffer* new_node = *buffer;
+    *buffer = NULL;
     new_node->next = NULL;
 
+    // Buffers removed by the overflow policy are released after the lock is dropped
+    PooledBuffer* evicted_head = NULL;
+    PooledBuffer* evicted_tail = NULL;
+    size_t evicted_count = 0;
+
     pthread_mutex_lock(&q->mutex);
+    if (is_over_limit_locked(q, new_node->length)) {
+        switch (q->policy) {
+            case DATA_QUEUE_OVERFLOW_BLOCK:
+                q->stats.blocked++;
+                while (!q->shutdown && is_over_limit_locked(q, new_node->length)) {
+                    pthread_cond_wait(&q->not_full, &q->mutex);
+                }
+                break;
+            case DATA_QUEUE_OVERFLOW_DROP_NEWEST:
+                q->stats.dropped_newest++;
+                pthread_mutex_unlock(&q->mutex);
+                pooled_buffer_release(&new_node);
+                return;
+            case DATA_QUEUE_OVERFLOW_DROP_OLDEST:
+            case DATA_QUEUE_OVERFLOW_SPILL:
+                // Trim a contiguous chunk from the front down to the low-water mark
+                while (is_above_low_water_locked(q) || is_over_limit_locked(q, new_node->length)) {
+                    PooledBuffer* node = pop_front_locked(q);
+                    if (evicted_tail) {
+                        evicted_tail->next = node;
+                    } else {
+                        evicted_head = node;
+                    }
+                    evicted_tail = node;
+                    evicted_count++;
+                }
+                if (q->policy == DATA_QUEUE_OVERFLOW_SPILL) {
+                    q->stats.spilled += evicted_count;
+                    q->stats.spill_events++;
+                } else {
+                    q->stats.dropped_oldest += evicted_count;
+                }
+                break;
+        }
+    }
+
     if (q->tail != NULL) {
         q->tail->next = new_node;
     }
@@ -86,20 +229,50 @@ void data_queue_enqueue(DataQueue* q, const char* data) {
     if (q->head == NULL) {
         q->head = new_node;
     }
+    q->count++;
+    q->bytes += new_node->length;
+    q->stats.enqueued++;
+
+    data_queue_spill_func_t spill_func = (q->policy == DATA_QUEUE_OVERFLOW_SPILL) ? q->spill_func : NULL;
+    void* spill_context = q->spill_context;
+
     // Signal the condition variable in case the dequeue thread is waiting
     pthread_cond_signal(&q->cond);
     pthread_mutex_unlock(&q->mutex);
+
+    if (evicted_count == 0) return;
+
+    // Hand the whole chunk to the spill callback at once so it can be written in a single I/O
+    PooledBuffer** items = spill_func ? malloc(evicted_count * sizeof(*items)) : NULL;
+    if (spill_func && !items) {
+        perror("Failed to allocate spill array, dropping chunk");
+    }
+    size_t i = 0;
+    for (PooledBuffer* node = evicted_head; node != NULL; node = node->next) {
+        if (items) items[i++] = node;
+    }
+    if (items) {
+        spill_func(items, evicted_count, spill_context);
+        free(items);
+    }
+
+    PooledBuffer* current = evicted_head;
+    while (current != NULL) {
+        PooledBuffer* next = current->next;
+        pooled_buffer_release(&current);
+        current = next;
+    }
 }
 
 /**
  * @brief Dequeues a data item.
  *
  * Blocks until an item is available or the queue is shut down.
- * The caller is responsible for freeing the returned string.
+ * The caller is responsible for releasing the returned buffer.
  * @param q The queue.
- * @return A pointer to the data string, or NULL if the queue is empty and has been shut down.
+ * @return A buffer, or NULL if the queue is empty and has been shut down.
  */
-char* data_queue_dequeue(DataQueue* q) {
+PooledBuffer* data_queue_dequeue(DataQueue* q) {
     pthread_mutex_lock(&q->mutex);
     // Wait while the queue is empty and not in shutdown mode
     while (q->head == NULL && !q->shutdown) {
@@ -113,16 +286,101 @@ char* data_queue_dequeue(DataQueue* q) {
     }
 
     // Dequeue the head item
-    DataNode* temp = q->head;
-    char* data = temp->data;
-    q->head = q->head->next;
-    if (q->head == NULL) {
-        q->tail = NULL; // The queue is now empty
+    PooledBuffer* buffer = pop_front_locked(q);
+
+    pthread_cond_signal(&q->not_full);
+    pthread_mutex_unlock(&q->mutex);
+    return buffer;
+}
+
+// Pops items from the front until a limit is hit; caller holds the mutex
+static size_t take_batch_locked(DataQueue* q, PooledBuffer* items[], size_t max_items, size_t max_bytes) {
+    size_t taken = 0;
+    size_t taken_bytes = 0;
+    while (q->head != NULL && taken < max_items) {
+        // Always hand out at least one item so an oversized string cannot stall the queue
+        if (taken > 0 && max_bytes > 0 && taken_bytes + q->head->length > max_bytes) {
+            break;
+        }
+        taken_bytes += q->head->length;
+        items[taken++] = pop_front_locked(q);
+    }
+
+    if (taken > 0) {
+        pthread_cond_broadcast(&q->not_full);
+    }
+    return taken;
+}
+
+/**
+ * @brief Dequeues up to `max_items` data items under a single lock acquisition.
+ *
+ * Blocks until an item is available or the queue is shut down, then optionally
+ * lingers until `max_wait_ms` has elapsed or the item/byte limits are reached.
+ * The caller is responsible for releasing each returned buffer.
+ * @return The number of items stored in `items`, or 0 on shutdown with an empty queue.
+ */
+size_t data_queue_dequeue_batch(DataQueue* q, PooledBuffer* items[], size_t max_items,
+                                size_t max_bytes, unsigned int max_wait_ms) {
+    if (!q || !items || max_items == 0) return 0;
+
+    pthread_mutex_lock(&q->mutex);
+    while (q->head == NULL && !q->shutdown && !q->wakeup_pending) {
+        pthread_cond_wait(&q->cond, &q->mutex);
+    }
+
+    if (q->head != NULL && max_wait_ms > 0 && !q->shutdown && !q->wakeup_pending) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += max_wait_ms / 1000;
+        deadline.tv_nsec += (long)(max_wait_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        // Linger for more data until a limit is reached, the deadline passes or we shut down
+        while (!q->shutdown && !q->wakeup_pending && q->count < max_items &&
+               (max_bytes == 0 || q->bytes < max_bytes)) {
+            if (pthread_cond_timedwait(&q->cond, &q->mutex, &deadline) != 0) {
+                break; // ETIMEDOUT
+            }
+        }
     }
-    free(temp); // Free the node, but not the data it points to
 
+    q->wakeup_pending = 0;
+
+    size_t taken = take_batch_locked(q, items, max_items, max_bytes);
+    pthread_mutex_unlock(&q->mutex);
+    return taken;
+}
+
+/**
+ * @brief Removes up to `max_items` buffers without waiting.
+ * @param q The queue.
+ * @param items Output array.
+ * @param max_items Maximum number of items to return.
+ * @param max_bytes Maximum total string length to return, or 0 for no limit.
+ * @return The number of items written to `items`, possibly 0.
+ */
+size_t data_queue_try_dequeue_batch(DataQueue* q, PooledBuffer* items[], size_t max_items, size_t max_bytes) {
+    if (!q || !items || max_items == 0) return 0;
+
+    pthread_mutex_lock(&q->mutex);
+    size_t taken = take_batch_locked(q, items, max_items, max_bytes);
+    pthread_mutex_unlock(&q->mutex);
+    return taken;
+}
+
+/**
+ * @brief Interrupts a consumer blocked in a batch dequeue.
+ * @param q The queue.
+ */
+void data_queue_wakeup(DataQueue* q) {
+    pthread_mutex_lock(&q->mutex);
+    q->wakeup_pending = 1;
+    pthread_cond_broadcast(&q->cond);
     pthread_mutex_unlock(&q->mutex);
-    return data;
 }
 
 /**
@@ -134,7 +392,8 @@ char* data_queue_dequeue(DataQueue* q) {
 void data_queue_shutdown(DataQueue* q) {
     pthread_mutex_lock(&q->mutex);
     q->shutdown = 1;
-    // Broadcast to wake up all waiting threads
+    // Broadcast to wake up all waiting threads, including blocked producers
     pthread_cond_broadcast(&q->cond);
+    pthread_cond_broadcast(&q->not_full);
     pthread_mutex_unlock(&q->mutex);
 }
@@ -3,47 +3,165 @@
 
 /**
  * @file DataQueue.h
- * @brief A simple thread-safe queue for passing string data between threads.
+ * @brief A simple thread-safe queue for passing buffers between threads.
  *
- * This implementation uses a linked list with a mutex for thread safety and
- * a condition variable to allow the consumer thread to wait efficiently
- * for new data.
+ * Items are PooledBuffers linked through their intrusive `next` pointer, so
+ * queuing a buffer never allocates. The queue only looks at their `length`,
+ * so an item may hold text or a binary record (see PointRecord.h). A mutex provides thread safety and a
+ * condition variable lets the consumer thread wait efficiently for new data.
  */
 
+#include <stddef.h>
+#include "BufferPool.h"
+
 typedef struct DataQueue DataQueue; // Opaque data queue type
 
+// What to do when an enqueue would push the queue past its high-water mark
+typedef enum {
+    DATA_QUEUE_OVERFLOW_BLOCK,       // Wait until the consumer makes room
+    DATA_QUEUE_OVERFLOW_DROP_OLDEST, // Discard items from the front of the queue
+    DATA_QUEUE_OVERFLOW_DROP_NEWEST, // Discard the item being enqueued
+    DATA_QUEUE_OVERFLOW_SPILL        // Hand the oldest chunk to a spill callback (e.g. the offline log)
+} DataQueueOverflowPolicy;
+
+// Callback receiving a contiguous chunk of the oldest items when the queue spills.
+// It is called without the queue lock held; the queue releases the items afterwards.
+typedef void (*data_queue_spill_func_t)(PooledBuffer* const items[], size_t count, void* user_context);
+
+// Counters describing queue occupancy and the overflow actions taken so far
+typedef struct {
+    unsigned long long enqueued;        // Items accepted into the queue
+    unsigned long long blocked;         // Enqueue calls that had to wait for space
+    unsigned long long dropped_oldest;  // Items discarded from the front
+    unsigned long long dropped_newest;  // Incoming items discarded
+    unsigned long long spilled;         // Items handed to the spill callback
+    unsigned long long spill_events;    // Number of spill callback invocations
+    size_t current_items;
+    size_t current_bytes;
+} DataQueueStats;
+
 /**
  * @brief Creates and initializes a new thread-safe data queue.
+ * @param pool Pool used for the buffers of copied strings (data_queue_enqueue).
  * @return A pointer to the new DataQueue, or NULL on failure.
  */
-DataQueue* data_queue_create();
+DataQueue* data_queue_create(BufferPool* pool);
 
 /**
- * @brief Destroys a data queue, freeing all nodes and their data.
+ * @brief Destroys a data queue, releasing all queued buffers to their pools.
  * @param q The queue to destroy.
  */
 void data_queue_destroy(DataQueue* q);
 
+/**
+ * @brief Bounds the queue and selects what happens when the bound is hit.
+ *
+ * A limit of 0 disables that dimension. When the limit would be exceeded, the
+ * DROP_OLDEST and SPILL policies trim the queue down to half of the high-water
+ * mark so that spills happen in large chunks rather than one item at a time.
+ *
+ * @param q The queue.
+ * @param max_items High-water mark in number of items (0 = unbounded).
+ * @param max_bytes High-water mark in total string bytes (0 = unbounded).
+ * @param policy The overflow policy to apply.
+ * @param spill_func Required for DATA_QUEUE_OVERFLOW_SPILL, ignored otherwise.
+ * @param spill_context Passed through to `spill_func`.
+ */
+void data_queue_set_overflow_policy(DataQueue* q, size_t max_items, size_t max_bytes,
+                                    DataQueueOverflowPolicy policy,
+                                    data_queue_spill_func_t spill_func, void* spill_context);
+
+/**
+ * @brief Takes a consistent snapshot of the queue counters.
+ * @param q The queue.
+ * @param stats Output structure.
+ */
+void data_queue_get_stats(DataQueue* q, DataQueueStats* stats);
+
+/**
+ * @brief Returns the number of items currently queued.
+ * @param q The queue.
+ */
+size_t data_queue_size(DataQueue* q);
+
 /**
  * @brief Adds a string to the end of the queue.
  *
- * This function is thread-safe. It creates a copy of the input string.
+ * This function is thread-safe. It copies the input string into a buffer
+ * from the queue's pool; prefer data_queue_enqueue_buffer() to avoid the copy.
+ * If the queue is bounded, the configured overflow policy is applied first,
+ * which may block the caller (DATA_QUEUE_OVERFLOW_BLOCK).
  * @param q The queue.
  * @param data The null-terminated string to add to the queue.
  */
 void data_queue_enqueue(DataQueue* q, const char* data);
 
 /**
- * @brief Removes and returns a string from the front of the queue.
+ * @brief Moves a filled buffer to the end of the queue without copying it.
+ *
+ * The queue takes ownership of the buffer and sets `*buffer` to NULL. The
+ * overflow policy applies exactly as for data_queue_enqueue().
+ * @param q The queue.
+ * @param buffer Address of the caller's buffer pointer.
+ */
+void data_queue_enqueue_buffer(DataQueue* q, PooledBuffer** buffer);
+
+/**
+ * @brief Removes and returns a buffer from the front of the queue.
  *
  * This function is thread-safe and will block until an item becomes available
- * or the queue is shut down. The caller is responsible for freeing the
- * memory of the returned string.
+ * or the queue is shut down. The caller owns the returned buffer and must
+ * release it with pooled_buffer_release().
+ *
+ * @param q The queue.
+ * @return A buffer, or NULL if the queue is shutting down and empty.
+ */
+PooledBuffer* data_queue_dequeue(DataQueue* q);
+
+/**
+ * @brief Removes up to `max_items` buffers from the front of the queue in one go.
+ *
+ * Blocks until at least one item is available or the queue is shut down. Once
+ * data is present, waits up to `max_wait_ms` for more items to accumulate,
+ * returning early as soon as `max_items` or `max_bytes` is reached. All items
+ * are taken under a single lock acquisition. The first item is always returned,
+ * even if it alone exceeds `max_bytes`. The caller owns the returned buffers.
+ *
+ * @param q The queue.
+ * @param items Output array receiving at least `max_items` buffer pointers.
+ * @param max_items Maximum number of items to return (must be > 0).
+ * @param max_bytes Maximum total string length to return, or 0 for no limit.
+ * @param max_wait_ms How long to wait for more data once the first item is available (0 = don't wait).
+ * @return The number of items written to `items`, or 0 if the queue is shutting down and empty
+ *         or the wait was interrupted by data_queue_wakeup().
+ */
+size_t data_queue_dequeue_batch(DataQueue* q, PooledBuffer* items[], size_t max_items,
+                                size_t max_bytes, unsigned int max_wait_ms);
+
+/**
+ * @brief Non-blocking variant of data_queue_dequeue_batch().
+ *
+ * Takes whatever is queued right now, up to the same limits, and returns
+ * immediately. Used by consumers that wait on another event source.
+ *
+ * @param q The queue.
+ * @param items Output array receiving at least `max_items` buffer pointers.
+ * @param max_items Maximum number of items to return (must be > 0).
+ * @param max_bytes Maximum total string length to return, or 0 for no limit.
+ * @return The number of items written to `items`, possibly 0.
+ */
+size_t data_queue_try_dequeue_batch(DataQueue* q, PooledBuffer* items[], size_t max_items, size_t max_bytes);
+
+/**
+ * @brief Interrupts a consumer blocked in data_queue_dequeue_batch().
  *
+ * Lets the consumer attend to other work (e.g. a second input) without
+ * shutting the queue down. The blocked call returns whatever is available,
+ * possibly 0 items. A wakeup issued while nobody waits is remembered and
+ * consumed by the next call.
  * @param q The queue.
- * @return A dynamically allocated string, or NULL if the queue is shutting down and empty.
  */
-char* data_queue_dequeue(DataQueue* q);
+void data_queue_wakeup(DataQueue* q);
 
 /**
  * @brief Signals the queue to shut down, unblocking any waiting consumer threads.
@@ -0,0 +1,445 @@
+#include "Downsampler.h"
+#include "FloatFormat.h"
+#include <math.h>     // For isfinite
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DOWNSAMPLER_MAX_FIELDS 64       // Lines with more fields are passed through
+#define DOWNSAMPLER_INITIAL_SLOTS 256   // Hash slots; doubled whenever half of them are used
+
+typedef enum {
+    FIELD_KIND_FLOAT,
+    FIELD_KIND_INTEGER,   // 'i' suffix
+    FIELD_KIND_UNSIGNED,  // 'u' suffix
+    FIELD_KIND_OTHER      // Strings and booleans: only the last value is kept
+} FieldKind;
+
+// One field of a parsed line; all text points into the input
+typedef struct {
+    const char* key;
+    size_t key_length;
+    const char* value;
+    size_t value_length;
+    FieldKind kind;
+    double number;
+} ParsedField;
+
+typedef struct {
+    char* key;            // Escaped, as it appeared in the input
+    FieldKind kind;
+    unsigned long count;
+    double sum;
+    double min;
+    double max;
+    char* last;           // Raw value of FIELD_KIND_OTHER fields
+} AggregateField;
+
+typedef struct {
+    char* series;         // Measurement and tag set, escaped
+    size_t series_length;
+    long long start;      // Bucket start, in seconds
+    AggregateField* fields;
+    size_t field_count;
+    size_t field_capacity;
+} Bucket;
+
+typedef struct {
+    char* data;
+    size_t size;
+    size_t capacity;
+} TextBuffer;
+
+struct Downsampler {
+    unsigned int bucket_s;
+
+    Bucket* buckets;      // In order of first appearance, which is the order they are rendered in
+    size_t bucket_count;
+    size_t bucket_capacity;
+    size_t* slots;        // Open-addressing index into `buckets`, SIZE_MAX when empty
+    size_t slot_count;
+
+    TextBuffer passthrough; // Lines that could not be parsed, kept as they were
+    size_t passthrough_lines;
+    TextBuffer partial;     // Incomplete last line of the previous add
+};
+
+// --- Text Helpers ---
+
+static bool text_reserve(TextBuffer* text, size_t extra) {
+    if (text->capacity - text->size >= extra) return true;
+    size_t new_capacity = text->capacity ? text->capacity : 4096;
+    while (new_capacity - text->size < extra) new_capacity *= 2;
+    char* new_data = realloc(text->data, new_capacity);
+    if (!new_data) {
+        perror("Failed to grow downsampler buffer");
+        return false;
+    }
+    text->data = new_data;
+    text->capacity = new_capacity;
+    return true;
+}
+
+static bool text_append_bytes(TextBuffer* text, const char* data, size_t size) {
+    if (size == 0) return true;
+    if (!text_reserve(text, size)) return false;
+    memcpy(text->data + text->size, data, size);
+    text->size += size;
+    return true;
+}
+
+static bool text_append_format(TextBuffer* text, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int needed = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    if (needed < 0 || !text_reserve(text, (size_t)needed + 1)) return false;
+
+    va_start(args, format);
+    vsnprintf(text->data + text->size, (size_t)needed + 1, format, args);
+    va_end(args);
+    text->size += (size_t)needed;
+    return true;
+}
+
+static char* copy_text(const char* text, size_t length) {
+    char* copy = malloc(length + 1);
+    if (copy) {
+        memcpy(copy, text, length);
+        copy[length] = '\0';
+    }
+    return copy;
+}
+
+// --- Parsing ---
+
+// Returns the first occurrence of `stop` at or after `position` that is not escaped with a backslash
+static const char* find_unescaped(const char* position, const char* end, char stop) {
+    while (position < end && *position != stop) {
+        if (*position == '\\' && position + 1 < end) position++;
+        position++;
+    }
+    return position;
+}
+
+static bool classify_value(ParsedField* field) {
+    const char* value = field->value;
+    size_t length = field->value_length;
+    if (length == 0) return false;
+
+    if (value[0] == '"') {
+        field->kind = FIELD_KIND_OTHER;
+        return length >= 2 && value[length - 1] == '"';
+    }
+    static const char* const booleans[] = { "t", "T", "true", "True", "TRUE", "f", "F", "false", "False", "FALSE" };
+    for (size_t i = 0; i < sizeof(booleans) / sizeof(booleans[0]); i++) {
+        if (strlen(booleans[i]) == length && memcmp(value, booleans[i], length) == 0) {
+            field->kind = FIELD_KIND_OTHER;
+            return true;
+        }
+    }
+
+    char number[64];
+    size_t digits = length;
+    field->kind = FIELD_KIND_FLOAT;
+    if (value[length - 1] == 'i' || value[length - 1] == 'u') {
+        field->kind = value[length - 1] == 'i' ? FIELD_KIND_INTEGER : FIELD_KIND_UNSIGNED;
+        digits--;
+    }
+    if (digits == 0 || digits >= sizeof(number)) return false;
+    memcpy(number, value, digits);
+    number[digits] = '\0';
+
+    char* end;
+    field->number = field->kind == FIELD_KIND_FLOAT ? strtod(number, &end) : (double)strtoll(number, &end, 10);
+    return *end == '\0' && isfinite(field->number);
+}
+
+// Splits one line into series, fields and timestamp without modifying it
+static bool parse_line(const char* line, const char* end, const char** series_end, ParsedField* fields,
+                       size_t* field_count, long long* timestamp) {
+    *series_end = find_unescaped(line, end, ' ');
+    if (*series_end == line || *series_end >= end) return false;
+
+    const char* position = *series_end + 1;
+    *field_count = 0;
+    for (;;) {
+        if (*field_count == DOWNSAMPLER_MAX_FIELDS) return false;
+        ParsedField* field = &fields[(*field_count)++];
+        field->key = position;
+        position = find_unescaped(position, end, '=');
+        if (position >= end || position == field->key) return false;
+        field->key_length = (size_t)(position - field->key);
+
+        field->value = ++position;
+        if (position < end && *position == '"') {
+            position = find_unescaped(position + 1, end, '"');
+            if (position >= end) return false;
+            position++;
+        } else {
+            while (position < end && *position != ',' && *position != ' ') position++;
+        }
+        field->value_length = (size_t)(position - field->value);
+        if (!classify_value(field)) return false;
+
+        if (position >= end) return false; // No timestamp, so no bucket
+        if (*position == ' ') break;
+        position++; // ','
+    }
+
+    char* timestamp_end;
+    char digits[32];
+    size_t length = (size_t)(end - position - 1);
+    if (length == 0 || length >= sizeof(digits)) return false;
+    memcpy(digits, position + 1, length);
+    digits[length] = '\0';
+    *timestamp = strtoll(digits, &timestamp_end, 10);
+    return *timestamp_end == '\0';
+}
+
+// --- Buckets ---
+
+static size_t bucket_hash(const char* series, size_t length, long long start) {
+    uint64_t hash = 1469598103934665603ULL; // FNV-1a
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (unsigned char)series[i]) * 1099511628211ULL;
+    }
+    hash = (hash ^ (uint64_t)start) * 1099511628211ULL;
+    return (size_t)(hash ^ (hash >> 32));
+}
+
+static bool rebuild_slots(Downsampler* downsampler, size_t slot_count) {
+    size_t* slots = malloc(slot_count * sizeof(*slots));
+    if (!slots) {
+        perror("Failed to grow downsampler index");
+        return false;
+    }
+    for (size_t i = 0; i < slot_count; i++) slots[i] = SIZE_MAX;
+    for (size_t i = 0; i < downsampler->bucket_count; i++) {
+        Bucket* bucket = &downsampler->buckets[i];
+        size_t slot = bucket_hash(bucket->series, bucket->series_length, bucket->start) & (slot_count - 1);
+        while (slots[slot] != SIZE_MAX) slot = (slot + 1) & (slot_count - 1);
+        slots[slot] = i;
+    }
+    free(downsampler->slots);
+    downsampler->slots = slots;
+    downsampler->slot_count = slot_count;
+    return true;
+}
+
+static Bucket* find_or_add_bucket(Downsampler* downsampler, const char* series, size_t length, long long start) {
+    size_t mask = downsampler->slot_count - 1;
+    size_t slot = bucket_hash(series, length, start) & mask;
+    for (; downsampler->slots[slot] != SIZE_MAX; slot = (slot + 1) & mask) {
+        Bucket* bucket = &downsampler->buckets[downsampler->slots[slot]];
+        if (bucket->start == start && bucket->series_length == length && memcmp(bucket->series, series, length) == 0) {
+            return bucket;
+        }
+    }
+
+    if (downsampler->bucket_count == downsampler->bucket_capacity) {
+        size_t new_capacity = downsampler->bucket_capacity ? downsampler->bucket_capacity * 2 : 64;
+        Bucket* buckets = realloc(downsampler->buckets, new_capacity * sizeof(*buckets));
+        if (!buckets) {
+            perror("Failed to grow downsampler buckets");
+            return NULL;
+        }
+        downsampler->buckets = buckets;
+        downsampler->bucket_capacity = new_capacity;
+    }
+    Bucket* bucket = &downsampler->buckets[downsampler->bucket_count];
+    memset(bucket, 0, sizeof(*bucket));
+    bucket->series = copy_text(series, length);
+    if (!bucket->series) return NULL;
+    bucket->series_length = length;
+    bucket->start = start;
+    downsampler->slots[slot] = downsampler->bucket_count++;
+
+    if (downsampler->bucket_count * 2 > downsampler->slot_count &&
+        !rebuild_slots(downsampler, downsampler->slot_count * 2)) {
+        return NULL;
+    }
+    return bucket;
+}
+
+static AggregateField* find_or_add_field(Bucket* bucket, const ParsedField* parsed) {
+    for (size_t i = 0; i < bucket->field_count; i++) {
+        AggregateField* field = &bucket->fields[i];
+        if (strlen(field->key) == parsed->key_length && memcmp(field->key, parsed->key, parsed->key_length) == 0) {
+            return field;
+        }
+    }
+
+    if (bucket->field_count == bucket->field_capacity) {
+        size_t new_capacity = bucket->field_capacity ? bucket->field_capacity * 2 : 8;
+        AggregateField* fields = realloc(bucket->fields, new_capacity * sizeof(*fields));
+        if (!fields) return NULL;
+        bucket->fields = fields;
+        bucket->field_capacity = new_capacity;
+    }
+    AggregateField* field = &bucket->fields[bucket->field_count];
+    memset(field, 0, sizeof(*field));
+    field->key = copy_text(parsed->key, parsed->key_length);
+    if (!field->key) return NULL;
+    field->kind = parsed->kind;
+    bucket->field_count++;
+    return field;
+}
+
+static bool accumulate(AggregateField* field, const ParsedField* parsed) {
+    if (parsed->kind == FIELD_KIND_OTHER || field->kind == FIELD_KIND_OTHER) {
+        char* last = copy_text(parsed->value, parsed->value_length);
+        if (!last) return false;
+        free(field->last);
+        field->last = last;
+        field->kind = FIELD_KIND_OTHER;
+        return true;
+    }
+
+    if (field->kind != parsed->kind) {
+        field->kind = FIELD_KIND_FLOAT; // Mixed numeric types within one bucket
+    }
+    if (field->count == 0 || parsed->number < field->min) field->min = parsed->number;
+    if (field->count == 0 || parsed->number > field->max) field->max = parsed->number;
+    field->sum += parsed->number;
+    field->count++;
+    return true;
+}
+
+static bool add_line(Downsampler* downsampler, const char* line, const char* end) {
+    if (line == end) return true;
+
+    const char* series_end;
+    ParsedField fields[DOWNSAMPLER_MAX_FIELDS];
+    size_t field_count;
+    long long timestamp;
+    if (!parse_line(line, end, &series_end, fields, &field_count, &timestamp)) {
+        downsampler->passthrough_lines++;
+        return text_append_bytes(&downsampler->passthrough, line, (size_t)(end - line)) &&
+               text_append_bytes(&downsampler->passthrough, "\n", 1);
+    }
+
+    long long bucket_s = downsampler->bucket_s;
+    long long start = timestamp - ((timestamp % bucket_s) + bucket_s) % bucket_s;
+    Bucket* bucket = find_or_add_bucket(downsampler, line, (size_t)(series_end - line), start);
+    if (!bucket) return false;
+    for (size_t i = 0; i < field_count; i++) {
+        AggregateField* field = find_or_add_field(bucket, &fields[i]);
+        if (!field || !accumulate(field, &fields[i])) return false;
+    }
+    return true;
+}
+
+// --- Public Functions ---
+
+Downsampler* downsampler_create(unsigned int bucket_s) {
+    Downsampler* downsampler = calloc(1, sizeof(Downsampler));
+    if (!downsampler) {
+        perror("Failed to allocate downsampler");
+        return NULL;
+    }
+    downsampler->bucket_s = bucket_s > 0 ? bucket_s : 1;
+    if (!rebuild_slots(downsampler, DOWNSAMPLER_INITIAL_SLOTS)) {
+        free(downsampler);
+        return NULL;
+    }
+    return downsampler;
+}
+
+void downsampler_destroy(Downsampler* downsampler) {
+    if (!downsampler) return;
+    for (size_t i = 0; i < downsampler->bucket_count; i++) {
+        Bucket* bucket = &downsampler->buckets[i];
+        for (size_t j = 0; j < bucket->field_count; j++) {
+            free(bucket->fields[j].key);
+            free(bucket->fields[j].last);
+        }
+        free(bucket->fields);
+        free(bucket->series);
+    }
+    free(downsampler->buckets);
+    free(downsampler->slots);
+    free(downsampler->passthrough.data);
+    free(downsampler->partial.data);
+    free(downsampler);
+}
+
+bool downsampler_add(Downsampler* downsampler, const char* text, size_t size) {
+    if (!downsampler || !text) return false;
+    const char* end = text + size;
+    const char* line = text;
+
+    // Complete the line left over from the previous call first
+    if (downsampler->partial.size > 0) {
+        const char* newline = memchr(text, '\n', size);
+        if (!newline) return text_append_bytes(&downsampler->partial, text, size);
+        if (!text_append_bytes(&downsampler->partial, text, (size_t)(newline - text))) return false;
+        const char* joined = downsampler->partial.data;
+        bool added = add_line(downsampler, joined, joined + downsampler->partial.size);
+        downsampler->partial.size = 0;
+        if (!added) return false;
+        line = newline + 1;
+    }
+
+    const char* newline;
+    while ((newline = memchr(line, '\n', (size_t)(end - line))) != NULL) {
+        const char* line_end = newline > line && newline[-1] == '\r' ? newline - 1 : newline;
+        if (!add_line(downsampler, line, line_end)) return false;
+        line = newline + 1;
+    }
+    return text_append_bytes(&downsampler->partial, line, (size_t)(end - line));
+}
+
+bool downsampler_render(Downsampler* downsampler, char** output, size_t* output_size, size_t* point_count) {
+    if (!downsampler || !output || !output_size || !point_count) return false;
+    if (downsampler->partial.size > 0) { // Final line without a newline
+        bool added = add_line(downsampler, downsampler->partial.data,
+                              downsampler->partial.data + downsampler->partial.size);
+        downsampler->partial.size = 0;
+        if (!added) return false;
+    }
+
+    TextBuffer text = { 0 };
+    bool success = true;
+    for (size_t i = 0; success && i < downsampler->bucket_count; i++) {
+        const Bucket* bucket = &downsampler->buckets[i];
+        success = text_append_bytes(&text, bucket->series, bucket->series_length) &&
+                  text_append_format(&text, ",resolution=%us ", downsampler->bucket_s);
+        for (size_t j = 0; success && j < bucket->field_count; j++) {
+            const AggregateField* field = &bucket->fields[j];
+            const char* separator = j > 0 ? "," : "";
+            if (field->kind == FIELD_KIND_OTHER) {
+                success = text_append_format(&text, "%s%s=%s", separator, field->key, field->last);
+            } else if (field->kind == FIELD_KIND_FLOAT) {
+                char mean[FLOAT_FORMAT_MAX_LENGTH];
+                char min[FLOAT_FORMAT_MAX_LENGTH];
+                char max[FLOAT_FORMAT_MAX_LENGTH];
+                float_format(field->sum / (double)field->count, FLOAT_FORMAT_SHORTEST, mean);
+                float_format(field->min, FLOAT_FORMAT_SHORTEST, min);
+                float_format(field->max, FLOAT_FORMAT_SHORTEST, max);
+                success = text_append_format(&text, "%s%s=%s,%s_min=%s,%s_max=%s", separator, field->key, mean,
+                                             field->key, min, field->key, max);
+            } else {
+                char suffix = field->kind == FIELD_KIND_INTEGER ? 'i' : 'u';
+                double mean = field->sum / (double)field->count;
+                long long rounded_mean = (long long)(mean < 0 ? mean - 0.5 : mean + 0.5);
+                success = text_append_format(&text, "%s%s=%lld%c,%s_min=%.0f%c,%s_max=%.0f%c", separator,
+                                             field->key, rounded_mean, suffix, field->key, field->min, suffix,
+                                             field->key, field->max, suffix);
+            }
+        }
+        success = success && text_append_format(&text, " %lld\n", bucket->start);
+    }
+    success = success && text_append_bytes(&text, downsampler->passthrough.data, downsampler->passthrough.size);
+
+    if (!success) {
+        free(text.data);
+        return false;
+    }
+    *output = text.data;
+    *output_size = text.size;
+    *point_count = downsampler->bucket_count + downsampler->passthrough_lines;
+    return true;
+}
@@ -0,0 +1,58 @@
+#ifndef DOWNSAMPLER_H
+#define DOWNSAMPLER_H
+
+/**
+ * @file Downsampler.h
+ * @brief Reduces line protocol to one aggregate point per series and time bucket.
+ *
+ * Used to shrink old offline data instead of throwing it away. For every
+ * series (measurement plus tag set) and bucket, each numeric field keeps its
+ * mean under the original name plus `<field>_min` and `<field>_max`. String
+ * and boolean fields keep their last value. Aggregate points carry an extra
+ * `resolution` tag (e.g. `resolution=60s`), so they never overwrite raw
+ * points, and are timestamped at the start of their bucket.
+ *
+ * Timestamps are expected in seconds, as written by this application. Lines
+ * that cannot be parsed are passed through unchanged.
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef struct Downsampler Downsampler; // Opaque downsampler type
+
+/**
+ * @brief Creates an empty downsampler.
+ * @param bucket_s Bucket length in seconds.
+ * @return A pointer to the downsampler, or NULL on allocation failure.
+ */
+Downsampler* downsampler_create(unsigned int bucket_s);
+
+/**
+ * @brief Frees the downsampler and everything it accumulated.
+ * @param downsampler The downsampler to destroy.
+ */
+void downsampler_destroy(Downsampler* downsampler);
+
+/**
+ * @brief Accumulates lines into the aggregates.
+ *
+ * @param downsampler The downsampler.
+ * @param text Newline-separated lines. A trailing partial line is kept and completed by the next call.
+ * @param size Number of bytes in `text`.
+ * @return false on allocation failure.
+ */
+bool downsampler_add(Downsampler* downsampler, const char* text, size_t size);
+
+/**
+ * @brief Renders the aggregates, and any passed-through lines, as newline-terminated line protocol.
+ *
+ * @param downsampler The downsampler.
+ * @param output Out: the rendered text, allocated with malloc(). Caller frees.
+ * @param output_size Out: number of bytes in `*output`.
+ * @param point_count Out: number of lines rendered.
+ * @return false on allocation failure.
+ */
+bool downsampler_render(Downsampler* downsampler, char** output, size_t* output_size, size_t* point_count);
+
+#endif // DOWNSAMPLER_H
@@ -0,0 +1,262 @@
+#include "EncodePipeline.h"
+#include "OfflineFormat.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define ENCODE_PIPELINE_MAX_WORKERS 8
+
+typedef enum {
+    SLOT_FREE,
+    SLOT_QUEUED,    // Holds text waiting for a worker
+    SLOT_ENCODING,
+    SLOT_DONE,      // Holds a member waiting for its turn to be output
+    SLOT_FAILED
+} SlotState;
+
+typedef struct {
+    SlotState state;
+    char* text;
+    size_t text_size;
+    size_t text_capacity;
+    unsigned char* member;
+    size_t member_size;
+    size_t member_capacity;
+} PipelineSlot;
+
+typedef struct {
+    EncodePipeline* pipeline;
+    GzipCompressor* compressor;
+    pthread_t thread;
+} PipelineWorker;
+
+// The slots form a ring: [head, tail) are in use, in submission order. Workers
+// take queued slots from `next_job` on, so the oldest chunks are encoded first.
+struct EncodePipeline {
+    PipelineSlot* slots;
+    size_t depth;
+    size_t head;           // Oldest slot not yet output
+    size_t tail;           // Next slot to fill
+    size_t used;           // Slots in [head, tail)
+    size_t next_job;       // Oldest queued slot no worker has taken
+    size_t queued;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t work_cond;  // Signalled when a slot is queued, or to stop
+    pthread_cond_t done_cond;  // Signalled when a slot is encoded
+    PipelineWorker* workers;
+    size_t worker_count;
+    bool stop;
+
+    GzipCompressor* compressor; // Encodes on the submitting thread when there are no workers
+    encode_output_func_t output;
+    void* user_context;
+    bool failed;
+};
+
+// --- Private Helpers ---
+
+static bool encode_slot(GzipCompressor* compressor, PipelineSlot* slot) {
+    struct iovec iov = { .iov_base = slot->text, .iov_len = slot->text_size };
+    return offline_format_encode(compressor, &iov, 1, &slot->member, &slot->member_capacity, &slot->member_size);
+}
+
+static void* worker_thread_function(void* arg) {
+    PipelineWorker* worker = arg;
+    EncodePipeline* pipeline = worker->pipeline;
+
+    pthread_mutex_lock(&pipeline->mutex);
+    for (;;) {
+        while (!pipeline->stop && pipeline->queued == 0) {
+            pthread_cond_wait(&pipeline->work_cond, &pipeline->mutex);
+        }
+        if (pipeline->stop) break;
+
+        PipelineSlot* slot = &pipeline->slots[pipeline->next_job];
+        pipeline->next_job = (pipeline->next_job + 1) % pipeline->depth;
+        pipeline->queued--;
+        slot->state = SLOT_ENCODING;
+        pthread_mutex_unlock(&pipeline->mutex);
+
+        // The slot belongs to this worker until it is marked done
+        bool encoded = encode_slot(worker->compressor, slot);
+
+        pthread_mutex_lock(&pipeline->mutex);
+        slot->state = encoded ? SLOT_DONE : SLOT_FAILED;
+        pthread_cond_broadcast(&pipeline->done_cond);
+    }
+    pthread_mutex_unlock(&pipeline->mutex);
+    return NULL;
+}
+
+// Waits for the oldest slot and hands its member to the output. Caller holds the mutex.
+static void output_head_locked(EncodePipeline* pipeline) {
+    PipelineSlot* slot = &pipeline->slots[pipeline->head];
+    while (slot->state == SLOT_QUEUED || slot->state == SLOT_ENCODING) {
+        pthread_cond_wait(&pipeline->done_cond, &pipeline->mutex);
+    }
+
+    if (slot->state == SLOT_FAILED) {
+        fprintf(stderr, "Encode pipeline: failed to compress a chunk.\n");
+        pipeline->failed = true;
+    } else if (!pipeline->failed) {
+        // No worker touches a done slot, so the output runs without the lock
+        pthread_mutex_unlock(&pipeline->mutex);
+        bool accepted = pipeline->output(slot->member, slot->member_size, slot->text_size, pipeline->user_context);
+        pthread_mutex_lock(&pipeline->mutex);
+        pipeline->failed = !accepted;
+    }
+    slot->state = SLOT_FREE;
+    pipeline->head = (pipeline->head + 1) % pipeline->depth;
+    pipeline->used--;
+}
+
+static void free_slots(EncodePipeline* pipeline) {
+    for (size_t i = 0; pipeline->slots && i < pipeline->depth; i++) {
+        free(pipeline->slots[i].text);
+        free(pipeline->slots[i].member);
+    }
+    free(pipeline->slots);
+}
+
+// --- Public Functions ---
+
+EncodePipeline* encode_pipeline_create(size_t workers, size_t depth, int gzip_level, encode_output_func_t output,
+                                       void* user_context) {
+    if (!output) return NULL;
+    if (workers > ENCODE_PIPELINE_MAX_WORKERS) workers = ENCODE_PIPELINE_MAX_WORKERS;
+    if (depth == 0) depth = 1;
+
+    EncodePipeline* pipeline = calloc(1, sizeof(EncodePipeline));
+    if (!pipeline) {
+        perror("Failed to allocate encode pipeline");
+        return NULL;
+    }
+    pipeline->depth = depth;
+    pipeline->output = output;
+    pipeline->user_context = user_context;
+    pipeline->slots = calloc(depth, sizeof(PipelineSlot));
+    pipeline->workers = workers > 0 ? calloc(workers, sizeof(PipelineWorker)) : NULL;
+    pipeline->compressor = workers == 0 ? gzip_compressor_create(gzip_level) : NULL;
+    if (!pipeline->slots || (workers > 0 ? !pipeline->workers : !pipeline->compressor)) {
+        perror("Failed to allocate encode pipeline");
+        gzip_compressor_destroy(pipeline->compressor);
+        free(pipeline->workers);
+        free_slots(pipeline);
+        free(pipeline);
+        return NULL;
+    }
+
+    pthread_mutex_init(&pipeline->mutex, NULL);
+    pthread_cond_init(&pipeline->work_cond, NULL);
+    pthread_cond_init(&pipeline->done_cond, NULL);
+
+    // Fewer workers than asked for still work; none at all falls back to encoding inline
+    for (size_t i = 0; i < workers; i++) {
+        PipelineWorker* worker = &pipeline->workers[pipeline->worker_count];
+        worker->pipeline = pipeline;
+        worker->compressor = gzip_compressor_create(gzip_level);
+        if (!worker->compressor) break;
+        if (pthread_create(&worker->thread, NULL, worker_thread_function, worker) != 0) {
+            perror("Failed to create encode pipeline worker");
+            gzip_compressor_destroy(worker->compressor);
+            break;
+        }
+        pipeline->worker_count++;
+    }
+    if (pipeline->worker_count == 0 && !pipeline->compressor) {
+        pipeline->compressor = gzip_compressor_create(gzip_level);
+        if (!pipeline->compressor) {
+            encode_pipeline_destroy(pipeline);
+            return NULL;
+        }
+    }
+    return pipeline;
+}
+
+void encode_pipeline_destroy(EncodePipeline* pipeline) {
+    if (!pipeline) return;
+
+    pthread_mutex_lock(&pipeline->mutex);
+    pipeline->stop = true;
+    pthread_cond_broadcast(&pipeline->work_cond);
+    pthread_mutex_unlock(&pipeline->mutex);
+    for (size_t i = 0; i < pipeline->worker_count; i++) {
+        pthread_join(pipeline->workers[i].thread, NULL);
+        gzip_compressor_destroy(pipeline->workers[i].compressor);
+    }
+
+    pthread_cond_destroy(&pipeline->done_cond);
+    pthread_cond_destroy(&pipeline->work_cond);
+    pthread_mutex_destroy(&pipeline->mutex);
+    gzip_compressor_destroy(pipeline->compressor);
+    free(pipeline->workers);
+    free_slots(pipeline);
+    free(pipeline);
+}
+
+bool encode_pipeline_submit(EncodePipeline* pipeline, const char* text, size_t size) {
+    if (!pipeline || !text) return false;
+
+    pthread_mutex_lock(&pipeline->mutex);
+    while (pipeline->used == pipeline->depth && !pipeline->failed) {
+        output_head_locked(pipeline);
+    }
+    bool failed = pipeline->failed;
+    pthread_mutex_unlock(&pipeline->mutex);
+    if (failed) return false;
+
+    // A free slot is only touched by the submitting thread
+    PipelineSlot* slot = &pipeline->slots[pipeline->tail];
+    if (size > slot->text_capacity) {
+        char* new_text = realloc(slot->text, size);
+        if (!new_text) {
+            perror("Failed to allocate encode pipeline chunk");
+            return false;
+        }
+        slot->text = new_text;
+        slot->text_capacity = size;
+    }
+    memcpy(slot->text, text, size);
+    slot->text_size = size;
+
+    if (pipeline->worker_count == 0) {
+        bool encoded = encode_slot(pipeline->compressor, slot);
+        if (!encoded) {
+            fprintf(stderr, "Encode pipeline: failed to compress a chunk.\n");
+        }
+        bool written = encoded && pipeline->output(slot->member, slot->member_size, slot->text_size, pipeline->user_context);
+        pthread_mutex_lock(&pipeline->mutex);
+        pipeline->failed = !written;
+        pthread_mutex_unlock(&pipeline->mutex);
+        return written;
+    }
+
+    pthread_mutex_lock(&pipeline->mutex);
+    slot->state = SLOT_QUEUED;
+    pipeline->tail = (pipeline->tail + 1) % pipeline->depth;
+    pipeline->used++;
+    pipeline->queued++;
+    pthread_cond_signal(&pipeline->work_cond);
+    pthread_mutex_unlock(&pipeline->mutex);
+    return true;
+}
+
+bool encode_pipeline_finish(EncodePipeline* pipeline) {
+    if (!pipeline) return false;
+    pthread_mutex_lock(&pipeline->mutex);
+    while (pipeline->used > 0) {
+        output_head_locked(pipeline);
+    }
+    bool success = !pipeline->failed;
+    pthread_mutex_unlock(&pipeline->mutex);
+    return success;
+}
+
+size_t encode_pipeline_default_workers(void) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cores <= 1) return 0;
+    return (size_t)cores - 1 < ENCODE_PIPELINE_MAX_WORKERS ? (size_t)cores - 1 : ENCODE_PIPELINE_MAX_WORKERS;
+}
@@ -0,0 +1,67 @@
+#ifndef ENCODE_PIPELINE_H
+#define ENCODE_PIPELINE_H
+
+/**
+ * @file EncodePipeline.h
+ * @brief Compresses chunks of text into offline members on several cores, in order.
+ *
+ * The submitting thread hands over newline-terminated chunks; worker threads
+ * turn each one into a framed gzip member (OfflineFormat.h) and the members
+ * are passed to the output callback on the submitting thread, in the order
+ * the chunks were submitted. At most `depth` chunks are in the pipeline at
+ * once, which bounds its memory; a submit blocks while it is full.
+ *
+ * One pipeline is used by one submitting thread.
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef struct EncodePipeline EncodePipeline; // Opaque pipeline type
+
+// Receives each member, and the size of the text it holds, on the submitting thread.
+// Returning false fails the pipeline.
+typedef bool (*encode_output_func_t)(const unsigned char* member, size_t size, size_t text_size, void* user_context);
+
+/**
+ * @brief Creates a pipeline and starts its workers.
+ *
+ * @param workers Worker threads; 0 encodes on the submitting thread instead.
+ * @param depth Chunks that may be queued, encoding or waiting for output at once (at least 1).
+ * @param gzip_level Compression level of the members.
+ * @param output Called with every member, in submission order.
+ * @param user_context Passed to `output`.
+ * @return A pointer to the new pipeline, or NULL on failure.
+ */
+EncodePipeline* encode_pipeline_create(size_t workers, size_t depth, int gzip_level, encode_output_func_t output,
+                                       void* user_context);
+
+/**
+ * @brief Stops the workers and frees the pipeline. Chunks not yet output are discarded.
+ * @param pipeline The pipeline to destroy.
+ */
+void encode_pipeline_destroy(EncodePipeline* pipeline);
+
+/**
+ * @brief Copies a chunk into the pipeline, first passing finished members on while it is full.
+ *
+ * @param pipeline The pipeline.
+ * @param text Newline-terminated lines.
+ * @param size Number of bytes.
+ * @return false once a chunk failed to encode or the output refused a member.
+ */
+bool encode_pipeline_submit(EncodePipeline* pipeline, const char* text, size_t size);
+
+/**
+ * @brief Waits for every submitted chunk and passes the remaining members on.
+ * @param pipeline The pipeline.
+ * @return true if every chunk was encoded and accepted by the output.
+ */
+bool encode_pipeline_finish(EncodePipeline* pipeline);
+
+/**
+ * @brief Returns a worker count that leaves one core for the rest of the application.
+ */
+size_t encode_pipeline_default_workers(void);
+
+#endif // ENCODE_PIPELINE_H
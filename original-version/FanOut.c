@@ -0,0 +1,124 @@
+#include "FanOut.h"
+#include "ScadaBrSink.h"
+#include "SocketSink.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <curl/curl.h>
+
+#define FAN_OUT_MAX_SINKS 4
+#define SOCKET_SINK_DEFAULT_PORT "5555"
+
+struct FanOut {
+    SinkWorker* sinks[FAN_OUT_MAX_SINKS];
+    size_t sink_count;
+};
+
+// Live views only care about recent values: short queues, no lingering, brief retries
+static const SinkWorkerConfig SCADABR_DEFAULTS = {
+    .queue_max_items = 600,
+    .batch_max_items = 10,
+    .batch_max_delay_ms = 0,
+    .max_retries = 2,
+    .retry_base_ms = 500,
+    .retry_max_ms = 30000,
+};
+
+static const SinkWorkerConfig SOCKET_SINK_DEFAULTS = {
+    .queue_max_items = 600,
+    .batch_max_items = 50,
+    .batch_max_delay_ms = 0,
+    .max_retries = 1,
+    .retry_base_ms = 200,
+    .retry_max_ms = 10000,
+};
+
+static unsigned long env_get_ulong(const char* prefix, const char* suffix, unsigned long default_value) {
+    char name[64];
+    snprintf(name, sizeof(name), "%s_%s", prefix, suffix);
+    const char* value = getenv(name);
+    if (!value || *value == '\0') return default_value;
+
+    char* endptr;
+    unsigned long parsed = strtoul(value, &endptr, 10);
+    if (*endptr != '\0') {
+        fprintf(stderr, "Ignoring invalid %s='%s', using %lu\n", name, value, default_value);
+        return default_value;
+    }
+    return parsed;
+}
+
+// Every sink can override its own limits, e.g. SCADABR_BATCH_MAX_ITEMS
+static SinkWorkerConfig sink_config_from_env(const char* prefix, const SinkWorkerConfig* defaults) {
+    SinkWorkerConfig config;
+    config.queue_max_items = env_get_ulong(prefix, "QUEUE_MAX_ITEMS", defaults->queue_max_items);
+    config.batch_max_items = env_get_ulong(prefix, "BATCH_MAX_ITEMS", defaults->batch_max_items);
+    config.batch_max_delay_ms = (unsigned int)env_get_ulong(prefix, "BATCH_MAX_DELAY_MS", defaults->batch_max_delay_ms);
+    config.max_retries = (unsigned int)env_get_ulong(prefix, "MAX_RETRIES", defaults->max_retries);
+    config.retry_base_ms = (unsigned int)env_get_ulong(prefix, "RETRY_BASE_MS", defaults->retry_base_ms);
+    config.retry_max_ms = (unsigned int)env_get_ulong(prefix, "RETRY_MAX_MS", defaults->retry_max_ms);
+    return config;
+}
+
+static void add_sink(FanOut* fan_out, const SinkOps* ops, void* state, const char* prefix,
+                     const SinkWorkerConfig* defaults) {
+    if (!state) {
+        fprintf(stderr, "Fan-out: failed to create %s sink.\n", ops->name);
+        return;
+    }
+    if (fan_out->sink_count >= FAN_OUT_MAX_SINKS) {
+        ops->destroy(state);
+        return;
+    }
+    SinkWorkerConfig config = sink_config_from_env(prefix, defaults);
+    SinkWorker* worker = sink_worker_create(ops, state, &config);
+    if (worker) {
+        fan_out->sinks[fan_out->sink_count++] = worker;
+    }
+}
+
+FanOut* fan_out_create_from_env(void) {
+    FanOut* fan_out = calloc(1, sizeof(FanOut));
+    if (!fan_out) {
+        perror("Failed to allocate FanOut");
+        return NULL;
+    }
+
+    // Balanced by the cleanup in fan_out_destroy(); curl counts these calls
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    const char* scadabr_url = getenv("SCADABR_URL");
+    if (scadabr_url && *scadabr_url) {
+        add_sink(fan_out, &SCADABR_SINK_OPS, scadabr_sink_create(scadabr_url), "SCADABR", &SCADABR_DEFAULTS);
+    }
+
+    const char* socket_host = getenv("SOCKET_SINK_HOST");
+    if (socket_host && *socket_host) {
+        const char* socket_port = getenv("SOCKET_SINK_PORT");
+        if (!socket_port || !*socket_port) socket_port = SOCKET_SINK_DEFAULT_PORT;
+        add_sink(fan_out, &SOCKET_SINK_OPS, socket_sink_create(socket_host, socket_port), "SOCKET_SINK",
+                 &SOCKET_SINK_DEFAULTS);
+    }
+
+    printf("Fan-out: %zu additional sinks.\n", fan_out->sink_count);
+    return fan_out;
+}
+
+void fan_out_destroy(FanOut* fan_out) {
+    if (!fan_out) return;
+    for (size_t i = 0; i < fan_out->sink_count; i++) {
+        sink_worker_destroy(fan_out->sinks[i]);
+    }
+    curl_global_cleanup();
+    free(fan_out);
+}
+
+void fan_out_publish(FanOut* fan_out, const MeasurementFrame* frame) {
+    if (!fan_out || !frame) return;
+    for (size_t i = 0; i < fan_out->sink_count; i++) {
+        sink_worker_submit(fan_out->sinks[i], frame);
+    }
+}
+
+size_t fan_out_sink_count(const FanOut* fan_out) {
+    return fan_out ? fan_out->sink_count : 0;
+}
@@ -0,0 +1,44 @@
+#ifndef FAN_OUT_H
+#define FAN_OUT_H
+
+/**
+ * @file FanOut.h
+ * @brief Hands every published frame to the additional output sinks.
+ *
+ * InfluxDB is served by the Sender; the fan-out adds any of the sinks below
+ * that are configured through environment variables, each behind its own
+ * SinkWorker:
+ *   - SCADABR_URL                        ScadaBR HTTP data source (GET tag=value)
+ *   - SOCKET_SINK_HOST / SOCKET_SINK_PORT  `tag,value` lines over TCP
+ */
+
+#include "MeasurementFrame.h"
+#include "Sink.h"
+
+typedef struct FanOut FanOut; // Opaque fan-out type
+
+/**
+ * @brief Creates the fan-out and starts a worker for every configured sink.
+ * @return A pointer to the fan-out (possibly with no sinks), or NULL on allocation failure.
+ */
+FanOut* fan_out_create_from_env(void);
+
+/**
+ * @brief Stops all sink workers and frees the fan-out.
+ * @param fan_out The fan-out to destroy.
+ */
+void fan_out_destroy(FanOut* fan_out);
+
+/**
+ * @brief Encodes a frame once per sink and queues it to every sink. Never blocks.
+ * @param fan_out The fan-out.
+ * @param frame The frame to publish.
+ */
+void fan_out_publish(FanOut* fan_out, const MeasurementFrame* frame);
+
+/**
+ * @brief Returns the number of running sinks.
+ */
+size_t fan_out_sink_count(const FanOut* fan_out);
+
+#endif // FAN_OUT_H
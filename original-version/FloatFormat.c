@@ -0,0 +1,389 @@
+#include "FloatFormat.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FIELD_DIGITS_MAX_ENTRIES 32
+#define FIELD_DIGITS_NAME_SIZE 64
+
+// Grisu2 (Loitsch, "Printing Floating-Point Numbers Quickly and Accurately with
+// Integers", 2010). A double is scaled by a cached power of ten into 64-bit
+// fixed point and its digits are generated from the interval of values that
+// still round to it. The digits always read back as the same double and are
+// the shortest such digits for all but a fraction of a percent of inputs.
+
+#define DP_SIGNIFICAND_MASK 0x000FFFFFFFFFFFFFULL
+#define DP_EXPONENT_MASK 0x7FF0000000000000ULL
+#define DP_HIDDEN_BIT 0x0010000000000000ULL
+#define DP_EXPONENT_BIAS (0x3FF + 52)
+#define DP_MIN_EXPONENT (-DP_EXPONENT_BIAS)
+
+// A number f * 2^e with a 64-bit significand
+typedef struct {
+    uint64_t f;
+    int e;
+} DiyFp;
+
+typedef struct {
+    char digits[FLOAT_FORMAT_MAX_DIGITS + 1];
+    int length;
+    int exponent; // The value is digits * 10^exponent
+} DecimalDigits;
+
+// Normalized 10^k for k = -348, -340, ..., 340
+static const DiyFp CACHED_POWERS[] = {
+    { 0xfa8fd5a0081c0288ULL, -1220 }, { 0xbaaee17fa23ebf76ULL, -1193 }, { 0x8b16fb203055ac76ULL, -1166 },
+    { 0xcf42894a5dce35eaULL, -1140 }, { 0x9a6bb0aa55653b2dULL, -1113 }, { 0xe61acf033d1a45dfULL, -1087 },
+    { 0xab70fe17c79ac6caULL, -1060 }, { 0xff77b1fcbebcdc4fULL, -1034 }, { 0xbe5691ef416bd60cULL, -1007 },
+    { 0x8dd01fad907ffc3cULL, -980 }, { 0xd3515c2831559a83ULL, -954 }, { 0x9d71ac8fada6c9b5ULL, -927 },
+    { 0xea9c227723ee8bcbULL, -901 }, { 0xaecc49914078536dULL, -874 }, { 0x823c12795db6ce57ULL, -847 },
+    { 0xc21094364dfb5637ULL, -821 }, { 0x9096ea6f3848984fULL, -794 }, { 0xd77485cb25823ac7ULL, -768 },
+    { 0xa086cfcd97bf97f4ULL, -741 }, { 0xef340a98172aace5ULL, -715 }, { 0xb23867fb2a35b28eULL, -688 },
+    { 0x84c8d4dfd2c63f3bULL, -661 }, { 0xc5dd44271ad3cdbaULL, -635 }, { 0x936b9fcebb25c996ULL, -608 },
+    { 0xdbac6c247d62a584ULL, -582 }, { 0xa3ab66580d5fdaf6ULL, -555 }, { 0xf3e2f893dec3f126ULL, -529 },
+    { 0xb5b5ada8aaff80b8ULL, -502 }, { 0x87625f056c7c4a8bULL, -475 }, { 0xc9bcff6034c13053ULL, -449 },
+    { 0x964e858c91ba2655ULL, -422 }, { 0xdff9772470297ebdULL, -396 }, { 0xa6dfbd9fb8e5b88fULL, -369 },
+    { 0xf8a95fcf88747d94ULL, -343 }, { 0xb94470938fa89bcfULL, -316 }, { 0x8a08f0f8bf0f156bULL, -289 },
+    { 0xcdb02555653131b6ULL, -263 }, { 0x993fe2c6d07b7facULL, -236 }, { 0xe45c10c42a2b3b06ULL, -210 },
+    { 0xaa242499697392d3ULL, -183 }, { 0xfd87b5f28300ca0eULL, -157 }, { 0xbce5086492111aebULL, -130 },
+    { 0x8cbccc096f5088ccULL, -103 }, { 0xd1b71758e219652cULL, -77 }, { 0x9c40000000000000ULL, -50 },
+    { 0xe8d4a51000000000ULL, -24 }, { 0xad78ebc5ac620000ULL, 3 }, { 0x813f3978f8940984ULL, 30 },
+    { 0xc097ce7bc90715b3ULL, 56 }, { 0x8f7e32ce7bea5c70ULL, 83 }, { 0xd5d238a4abe98068ULL, 109 },
+    { 0x9f4f2726179a2245ULL, 136 }, { 0xed63a231d4c4fb27ULL, 162 }, { 0xb0de65388cc8ada8ULL, 189 },
+    { 0x83c7088e1aab65dbULL, 216 }, { 0xc45d1df942711d9aULL, 242 }, { 0x924d692ca61be758ULL, 269 },
+    { 0xda01ee641a708deaULL, 295 }, { 0xa26da3999aef774aULL, 322 }, { 0xf209787bb47d6b85ULL, 348 },
+    { 0xb454e4a179dd1877ULL, 375 }, { 0x865b86925b9bc5c2ULL, 402 }, { 0xc83553c5c8965d3dULL, 428 },
+    { 0x952ab45cfa97a0b3ULL, 455 }, { 0xde469fbd99a05fe3ULL, 481 }, { 0xa59bc234db398c25ULL, 508 },
+    { 0xf6c69a72a3989f5cULL, 534 }, { 0xb7dcbf5354e9beceULL, 561 }, { 0x88fcf317f22241e2ULL, 588 },
+    { 0xcc20ce9bd35c78a5ULL, 614 }, { 0x98165af37b2153dfULL, 641 }, { 0xe2a0b5dc971f303aULL, 667 },
+    { 0xa8d9d1535ce3b396ULL, 694 }, { 0xfb9b7cd9a4a7443cULL, 720 }, { 0xbb764c4ca7a44410ULL, 747 },
+    { 0x8bab8eefb6409c1aULL, 774 }, { 0xd01fef10a657842cULL, 800 }, { 0x9b10a4e5e9913129ULL, 827 },
+    { 0xe7109bfba19c0c9dULL, 853 }, { 0xac2820d9623bf429ULL, 880 }, { 0x80444b5e7aa7cf85ULL, 907 },
+    { 0xbf21e44003acdd2dULL, 933 }, { 0x8e679c2f5e44ff8fULL, 960 }, { 0xd433179d9c8cb841ULL, 986 },
+    { 0x9e19db92b4e31ba9ULL, 1013 }, { 0xeb96bf6ebadf77d9ULL, 1039 }, { 0xaf87023b9bf0ee6bULL, 1066 },
+};
+
+static const uint64_t POWERS_OF_TEN[] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL,
+    1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+    100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL,
+    1000000000000000000ULL, 10000000000000000000ULL
+};
+
+typedef struct {
+    char name[FIELD_DIGITS_NAME_SIZE];
+    int digits;
+} FieldDigits;
+
+static FieldDigits g_field_digits[FIELD_DIGITS_MAX_ENTRIES];
+static size_t g_field_digits_count;
+static pthread_once_t g_field_digits_once = PTHREAD_ONCE_INIT;
+
+// --- Grisu2 ---
+
+static DiyFp diy_fp_from_double(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    int biased_exponent = (int)((bits & DP_EXPONENT_MASK) >> 52);
+    uint64_t significand = bits & DP_SIGNIFICAND_MASK;
+    DiyFp result;
+    if (biased_exponent != 0) {
+        result.f = significand + DP_HIDDEN_BIT;
+        result.e = biased_exponent - DP_EXPONENT_BIAS;
+    } else { // Subnormal
+        result.f = significand;
+        result.e = DP_MIN_EXPONENT + 1;
+    }
+    return result;
+}
+
+// Product rounded to the upper 64 bits; written with 32-bit halves so it also builds on 32-bit ARM
+static DiyFp diy_fp_multiply(DiyFp left, DiyFp right) {
+    const uint64_t mask = 0xFFFFFFFFULL;
+    uint64_t a = left.f >> 32, b = left.f & mask;
+    uint64_t c = right.f >> 32, d = right.f & mask;
+    uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    uint64_t middle = (bd >> 32) + (ad & mask) + (bc & mask) + (1ULL << 31);
+    DiyFp result = { ac + (ad >> 32) + (bc >> 32) + (middle >> 32), left.e + right.e + 64 };
+    return result;
+}
+
+static DiyFp diy_fp_normalize(DiyFp value) {
+    int shift = __builtin_clzll(value.f);
+    DiyFp result = { value.f << shift, value.e - shift };
+    return result;
+}
+
+// The halfway points to the neighbouring doubles, sharing the exponent of the upper one
+static void normalized_boundaries(DiyFp value, DiyFp* minus, DiyFp* plus) {
+    DiyFp upper = { (value.f << 1) + 1, value.e - 1 };
+    while (!(upper.f & (DP_HIDDEN_BIT << 1))) {
+        upper.f <<= 1;
+        upper.e--;
+    }
+    upper.f <<= 64 - 52 - 2;
+    upper.e -= 64 - 52 - 2;
+
+    // The gap below a power of two is half the gap above it
+    DiyFp lower = value.f == DP_HIDDEN_BIT ? (DiyFp){ (value.f << 2) - 1, value.e - 2 }
+                                           : (DiyFp){ (value.f << 1) - 1, value.e - 1 };
+    lower.f <<= lower.e - upper.e;
+    lower.e = upper.e;
+    *minus = lower;
+    *plus = upper;
+}
+
+// Picks the power of ten that brings a number with binary exponent `e` into [2^-60, 2^-32) * 2^64
+static DiyFp cached_power(int e, int* decimal_exponent) {
+    double dk = (-61 - e) * 0.30102999566398114 + 347; // Always positive, so the cast truncates
+    int k = (int)dk;
+    if (dk - k > 0.0) k++;
+    unsigned index = (unsigned)((k >> 3) + 1);
+    *decimal_exponent = -(-348 + (int)(index << 3));
+    return CACHED_POWERS[index];
+}
+
+// Moves the last digit towards the exact value while it stays inside the interval
+static void round_weed(char* digits, int length, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t distance) {
+    while (rest < distance && delta - rest >= ten_kappa &&
+           (rest + ten_kappa < distance || distance - rest > rest + ten_kappa - distance)) {
+        digits[length - 1]--;
+        rest += ten_kappa;
+    }
+}
+
+static int count_digits(uint32_t value) {
+    int count = 1;
+    while (count < 10 && value >= (uint32_t)POWERS_OF_TEN[count]) count++;
+    return count;
+}
+
+static void generate_digits(DiyFp scaled, DiyFp upper, uint64_t delta, DecimalDigits* out) {
+    DiyFp one = { 1ULL << -upper.e, upper.e };
+    uint64_t distance = upper.f - scaled.f;
+    uint32_t integral = (uint32_t)(upper.f >> -one.e);
+    uint64_t fraction = upper.f & (one.f - 1);
+    int kappa = count_digits(integral);
+    out->length = 0;
+
+    while (kappa > 0) {
+        uint32_t divisor = (uint32_t)POWERS_OF_TEN[kappa - 1];
+        uint32_t digit = integral / divisor;
+        integral %= divisor;
+        if (digit || out->length) out->digits[out->length++] = (char)('0' + digit);
+        kappa--;
+        uint64_t rest = ((uint64_t)integral << -one.e) + fraction;
+        if (rest <= delta) {
+            out->exponent += kappa;
+            round_weed(out->digits, out->length, delta, rest, POWERS_OF_TEN[kappa] << -one.e, distance);
+            return;
+        }
+    }
+
+    for (;;) {
+        fraction *= 10;
+        delta *= 10;
+        char digit = (char)(fraction >> -one.e);
+        if (digit || out->length) out->digits[out->length++] = (char)('0' + digit);
+        fraction &= one.f - 1;
+        kappa--;
+        if (fraction < delta) {
+            out->exponent += kappa;
+            int index = -kappa;
+            round_weed(out->digits, out->length, delta, fraction, one.f, distance * (index < 20 ? POWERS_OF_TEN[index] : 0));
+            return;
+        }
+    }
+}
+
+// Shortest digits of a positive, finite value
+static void grisu2(double value, DecimalDigits* out) {
+    DiyFp v = diy_fp_from_double(value);
+    DiyFp minus, plus;
+    normalized_boundaries(v, &minus, &plus);
+
+    int decimal_exponent;
+    DiyFp power = cached_power(plus.e, &decimal_exponent);
+    DiyFp scaled = diy_fp_multiply(diy_fp_normalize(v), power);
+    DiyFp upper = diy_fp_multiply(plus, power);
+    DiyFp lower = diy_fp_multiply(minus, power);
+    // Shrink the interval by the error of the multiplications so every digit string in it is safe
+    lower.f++;
+    upper.f--;
+
+    out->exponent = decimal_exponent;
+    generate_digits(scaled, upper, upper.f - lower.f, out);
+}
+
+// --- Rounding To Significant Digits ---
+
+// Correctly rounded digits from printf, for the cases the shortest digits cannot decide
+static void printf_digits(double value, int significant_digits, DecimalDigits* out) {
+    char text[FLOAT_FORMAT_MAX_DIGITS + 16];
+    snprintf(text, sizeof(text), "%.*e", significant_digits - 1, value);
+    out->length = 0;
+    const char* p = text;
+    for (; *p != 'e'; p++) {
+        if (*p != '.') out->digits[out->length++] = *p;
+    }
+    out->exponent = atoi(p + 1) - (out->length - 1);
+}
+
+static void round_to_significant(double value, int significant_digits, DecimalDigits* digits) {
+    if (digits->length <= significant_digits) return;
+
+    // A cut-off part starting with 5 may be a tie, or just below one in the exact value
+    if (digits->digits[significant_digits] == '5') {
+        printf_digits(value, significant_digits, digits);
+    } else {
+        bool round_up = digits->digits[significant_digits] > '5';
+        digits->exponent += digits->length - significant_digits;
+        digits->length = significant_digits;
+        for (int i = digits->length - 1; round_up && i >= 0; i--) {
+            if (digits->digits[i] == '9') {
+                digits->digits[i] = '0';
+            } else {
+                digits->digits[i]++;
+                round_up = false;
+            }
+        }
+        if (round_up) { // 9.99 became 10.0
+            digits->digits[0] = '1';
+            digits->exponent++;
+        }
+    }
+    while (digits->length > 1 && digits->digits[digits->length - 1] == '0') {
+        digits->length--;
+        digits->exponent++;
+    }
+}
+
+// --- Layout ---
+
+static char* write_exponent(char* out, int exponent) {
+    if (exponent < 0) {
+        *out++ = '-';
+        exponent = -exponent;
+    }
+    if (exponent >= 100) {
+        *out++ = (char)('0' + exponent / 100);
+        exponent %= 100;
+        *out++ = (char)('0' + exponent / 10);
+    } else if (exponent >= 10) {
+        *out++ = (char)('0' + exponent / 10);
+    }
+    *out++ = (char)('0' + exponent % 10);
+    return out;
+}
+
+// Lays the digits out as plain decimals, or with an exponent when that would need too many zeros
+static char* write_decimal(char* out, const DecimalDigits* digits) {
+    int length = digits->length;
+    int point = length + digits->exponent; // Digits before the decimal point
+
+    if (digits->exponent >= 0 && point <= 21) { // Integer: 1234e2 -> 123400
+        memcpy(out, digits->digits, (size_t)length);
+        memset(out + length, '0', (size_t)digits->exponent);
+        return out + point;
+    }
+    if (point > 0 && point <= 21) { // 1234e-2 -> 12.34
+        memcpy(out, digits->digits, (size_t)point);
+        out[point] = '.';
+        memcpy(out + point + 1, digits->digits + point, (size_t)(length - point));
+        return out + length + 1;
+    }
+    if (point > -6 && point <= 0) { // 1234e-6 -> 0.001234
+        int zeros = -point;
+        memcpy(out, "0.", 2);
+        memset(out + 2, '0', (size_t)zeros);
+        memcpy(out + 2 + zeros, digits->digits, (size_t)length);
+        return out + 2 + zeros + length;
+    }
+    *out++ = digits->digits[0]; // 1234e-10 -> 1.234e-7
+    if (length > 1) {
+        *out++ = '.';
+        memcpy(out, digits->digits + 1, (size_t)(length - 1));
+        out += length - 1;
+    }
+    *out++ = 'e';
+    return write_exponent(out, point - 1);
+}
+
+// --- Field Configuration ---
+
+// Parses FIELD_SIGNIFICANT_DIGITS: comma-separated name=digits pairs
+static void load_field_digits(void) {
+    const char* env = getenv("FIELD_SIGNIFICANT_DIGITS");
+    if (!env || *env == '\0') return;
+
+    const char* entry = env;
+    while (*entry) {
+        size_t entry_length = strcspn(entry, ",");
+        const char* equals = memchr(entry, '=', entry_length);
+        size_t name_length = equals ? (size_t)(equals - entry) : 0;
+        char* end = NULL;
+        long digits = equals ? strtol(equals + 1, &end, 10) : 0;
+
+        if (!equals || name_length == 0 || name_length >= FIELD_DIGITS_NAME_SIZE || end != entry + entry_length ||
+            digits < 1 || digits > FLOAT_FORMAT_MAX_DIGITS) {
+            fprintf(stderr, "FIELD_SIGNIFICANT_DIGITS: ignoring '%.*s' (expected name=1..%d).\n", (int)entry_length,
+                    entry, FLOAT_FORMAT_MAX_DIGITS);
+        } else if (g_field_digits_count == FIELD_DIGITS_MAX_ENTRIES) {
+            fprintf(stderr, "FIELD_SIGNIFICANT_DIGITS: more than %d fields, ignoring the rest.\n", FIELD_DIGITS_MAX_ENTRIES);
+            return;
+        } else {
+            FieldDigits* field = &g_field_digits[g_field_digits_count++];
+            memcpy(field->name, entry, name_length);
+            field->name[name_length] = '\0';
+            field->digits = (int)digits;
+        }
+
+        entry += entry_length;
+        if (*entry == ',') entry++;
+    }
+}
+
+// --- Public Functions ---
+
+size_t float_format(double value, int significant_digits, char* out) {
+    char* start = out;
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    if (bits >> 63) {
+        *out++ = '-';
+        value = -value;
+    }
+
+    if ((bits & DP_EXPONENT_MASK) == DP_EXPONENT_MASK) {
+        const char* text = (bits & DP_SIGNIFICAND_MASK) ? "nan" : "inf";
+        if (bits & DP_SIGNIFICAND_MASK) out = start; // printf does not sign NaN either
+        memcpy(out, text, 4);
+        return (size_t)(out - start) + 3;
+    }
+    if (value == 0.0) {
+        memcpy(out, "0", 2);
+        return (size_t)(out - start) + 1;
+    }
+
+    DecimalDigits digits;
+    grisu2(value, &digits);
+    if (significant_digits > 0) {
+        round_to_significant(value, significant_digits < FLOAT_FORMAT_MAX_DIGITS ? significant_digits : FLOAT_FORMAT_MAX_DIGITS,
+                             &digits);
+    }
+    out = write_decimal(out, &digits);
+    *out = '\0';
+    return (size_t)(out - start);
+}
+
+int float_format_field_digits(const char* name) {
+    pthread_once(&g_field_digits_once, load_field_digits);
+    if (!name) return FLOAT_FORMAT_SHORTEST;
+    for (size_t i = 0; i < g_field_digits_count; i++) {
+        if (strcmp(g_field_digits[i].name, name) == 0) return g_field_digits[i].digits;
+    }
+    return FLOAT_FORMAT_SHORTEST;
+}
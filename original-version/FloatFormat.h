@@ -0,0 +1,46 @@
+#ifndef FLOAT_FORMAT_H
+#define FLOAT_FORMAT_H
+
+/**
+ * @file FloatFormat.h
+ * @brief Writes doubles as the shortest decimal text that reads back as the same value.
+ *
+ * Every measured value written as line protocol, CSV or JSON goes through
+ * here. By default a value gets the fewest digits that still round-trip
+ * (Grisu2), so 3.3 is written as "3.3" rather than "3.300000" and a latitude
+ * keeps all of its precision. A field can instead be limited to a fixed number
+ * of significant digits with the FIELD_SIGNIFICANT_DIGITS environment variable,
+ * e.g. "corrente_bateria_principal=4,altitude=5".
+ *
+ * Values from 1e-6 up to 1e21 are written in plain decimal notation, others
+ * with an exponent ("1.5e-9"); both forms are valid line protocol, CSV and JSON.
+ */
+
+#include <stddef.h>
+
+#define FLOAT_FORMAT_MAX_LENGTH 32 // Longest output, including the terminator
+#define FLOAT_FORMAT_SHORTEST 0    // Significant digits meaning "as many as needed to round-trip"
+#define FLOAT_FORMAT_MAX_DIGITS 17 // Enough for any double to round-trip
+
+/**
+ * @brief Formats a double into `out`, which must hold FLOAT_FORMAT_MAX_LENGTH bytes.
+ *
+ * @param value The value. NaN and infinities are written as "nan", "inf" and "-inf".
+ * @param significant_digits FLOAT_FORMAT_SHORTEST, or 1 to FLOAT_FORMAT_MAX_DIGITS
+ *        to round to that many significant digits (trailing zeros are dropped).
+ * @param out Output buffer; the text is null-terminated.
+ * @return Length of the text, without the terminator.
+ */
+size_t float_format(double value, int significant_digits, char* out);
+
+/**
+ * @brief Returns the significant digits configured for a field, or FLOAT_FORMAT_SHORTEST.
+ *
+ * FIELD_SIGNIFICANT_DIGITS is read on the first call. Look the result up once
+ * per field rather than once per value. Thread-safe.
+ *
+ * @param name Field name: a channel id, "latitude", "longitude", "altitude" or "speed".
+ */
+int float_format_field_digits(const char* name);
+
+#endif // FLOAT_FORMAT_H
@@ -0,0 +1,210 @@
+#include "HttpTransport.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct {
+    CURL* handle;
+    bool active;
+    unsigned long long sequence;
+    void* request_context;
+} TransportSlot;
+
+struct HttpTransport {
+    CURLM* multi;
+    TransportSlot* slots;
+    size_t slot_count;
+    size_t in_flight;
+    unsigned long long next_sequence;
+    http_completion_func_t on_complete;
+    void* user_context;
+};
+
+// Response bodies from the write endpoint are not needed; swallow them instead
+// of letting curl print them to stdout.
+static size_t discard_response_callback(char* ptr, size_t size, size_t nmemb, void* userdata) {
+    (void)ptr;
+    (void)userdata;
+    return size * nmemb;
+}
+
+// Configures everything that stays constant for the lifetime of a slot's handle
+static CURL* create_slot_handle(const HttpTransportConfig* config, TransportSlot* slot) {
+    CURL* handle = curl_easy_init();
+    if (!handle) return NULL;
+
+    curl_easy_setopt(handle, CURLOPT_URL, config->url);
+    curl_easy_setopt(handle, CURLOPT_POST, 1L);
+    curl_easy_setopt(handle, CURLOPT_HTTPHEADER, config->headers);
+    curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, discard_response_callback);
+    curl_easy_setopt(handle, CURLOPT_CONNECTTIMEOUT_MS, config->connect_timeout_ms);
+    curl_easy_setopt(handle, CURLOPT_TIMEOUT_MS, config->request_timeout_ms);
+    curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(handle, CURLOPT_DNS_CACHE_TIMEOUT, config->dns_cache_timeout_s);
+    curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(handle, CURLOPT_PRIVATE, slot);
+    if (config->share) {
+        curl_easy_setopt(handle, CURLOPT_SHARE, config->share);
+    }
+    return handle;
+}
+
+HttpTransport* http_transport_create(const HttpTransportConfig* config,
+                                     http_completion_func_t on_complete, void* user_context) {
+    if (!config || !config->url || config->max_in_flight == 0 || !on_complete) return NULL;
+
+    HttpTransport* transport = calloc(1, sizeof(HttpTransport));
+    if (!transport) {
+        perror("Failed to allocate HttpTransport");
+        return NULL;
+    }
+    transport->slots = calloc(config->max_in_flight, sizeof(TransportSlot));
+    transport->multi = curl_multi_init();
+    if (!transport->slots || !transport->multi) {
+        fprintf(stderr, "HttpTransport: failed to initialize curl multi handle\n");
+        http_transport_destroy(transport);
+        return NULL;
+    }
+
+    transport->slot_count = config->max_in_flight;
+    transport->next_sequence = 1;
+    transport->on_complete = on_complete;
+    transport->user_context = user_context;
+
+    // One connection per slot, multiplexed over HTTP/2 when the server offers it
+    curl_multi_setopt(transport->multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long)config->max_in_flight);
+    curl_multi_setopt(transport->multi, CURLMOPT_PIPELINING, (long)CURLPIPE_MULTIPLEX);
+
+    for (size_t i = 0; i < transport->slot_count; i++) {
+        transport->slots[i].handle = create_slot_handle(config, &transport->slots[i]);
+        if (!transport->slots[i].handle) {
+            fprintf(stderr, "HttpTransport: failed to create request handle\n");
+            http_transport_destroy(transport);
+            return NULL;
+        }
+    }
+    return transport;
+}
+
+void http_transport_destroy(HttpTransport* transport) {
+    if (!transport) return;
+    if (transport->multi) {
+        http_transport_abort_all(transport);
+    }
+    for (size_t i = 0; transport->slots && i < transport->slot_count; i++) {
+        if (transport->slots[i].handle) {
+            curl_easy_cleanup(transport->slots[i].handle);
+        }
+    }
+    if (transport->multi) {
+        curl_multi_cleanup(transport->multi);
+    }
+    free(transport->slots);
+    free(transport);
+}
+
+bool http_transport_post(HttpTransport* transport, const void* body, size_t size, void* request_context) {
+    if (!transport || !body) return false;
+
+    TransportSlot* slot = NULL;
+    for (size_t i = 0; i < transport->slot_count; i++) {
+        if (!transport->slots[i].active) {
+            slot = &transport->slots[i];
+            break;
+        }
+    }
+    if (!slot) return false;
+
+    curl_easy_setopt(slot->handle, CURLOPT_POSTFIELDS, body);
+    curl_easy_setopt(slot->handle, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t)size);
+
+    CURLMcode mc = curl_multi_add_handle(transport->multi, slot->handle);
+    if (mc != CURLM_OK) {
+        fprintf(stderr, "HttpTransport: failed to start request: %s\n", curl_multi_strerror(mc));
+        return false;
+    }
+
+    slot->active = true;
+    slot->sequence = transport->next_sequence++;
+    slot->request_context = request_context;
+    transport->in_flight++;
+    return true;
+}
+
+// Detaches a slot from the multi handle and reports its outcome
+static void complete_slot(HttpTransport* transport, TransportSlot* slot, CURLcode curl_code) {
+    HttpResult result = {
+        .sequence = slot->sequence,
+        .curl_code = curl_code,
+    };
+    curl_easy_getinfo(slot->handle, CURLINFO_RESPONSE_CODE, &result.http_status);
+    curl_easy_getinfo(slot->handle, CURLINFO_TOTAL_TIME, &result.total_time_s);
+    curl_off_t retry_after = 0;
+    if (curl_easy_getinfo(slot->handle, CURLINFO_RETRY_AFTER, &retry_after) == CURLE_OK && retry_after > 0) {
+        result.retry_after_s = (long)retry_after;
+    }
+    curl_multi_remove_handle(transport->multi, slot->handle);
+
+    void* request_context = slot->request_context;
+    slot->active = false;
+    slot->request_context = NULL;
+    transport->in_flight--;
+
+    transport->on_complete(request_context, &result, transport->user_context);
+}
+
+static void perform_and_dispatch(HttpTransport* transport) {
+    int running = 0;
+    CURLMcode mc = curl_multi_perform(transport->multi, &running);
+    if (mc != CURLM_OK) {
+        fprintf(stderr, "HttpTransport: curl_multi_perform failed: %s\n", curl_multi_strerror(mc));
+    }
+
+    CURLMsg* message;
+    int remaining = 0;
+    while ((message = curl_multi_info_read(transport->multi, &remaining))) {
+        if (message->msg != CURLMSG_DONE) continue;
+        TransportSlot* slot = NULL;
+        curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, (char**)&slot);
+        if (slot && slot->active) {
+            complete_slot(transport, slot, message->data.result);
+        }
+    }
+}
+
+void http_transport_run(HttpTransport* transport, int timeout_ms) {
+    if (!transport) return;
+
+    perform_and_dispatch(transport);
+
+    // curl_multi_poll() also honours curl's own internal timers, so a newly
+    // added request or an expiring deadline shortens the wait as needed.
+    CURLMcode mc = curl_multi_poll(transport->multi, NULL, 0, timeout_ms, NULL);
+    if (mc != CURLM_OK) {
+        fprintf(stderr, "HttpTransport: curl_multi_poll failed: %s\n", curl_multi_strerror(mc));
+    }
+
+    perform_and_dispatch(transport);
+}
+
+void http_transport_wakeup(HttpTransport* transport) {
+    if (transport && transport->multi) {
+        curl_multi_wakeup(transport->multi);
+    }
+}
+
+void http_transport_abort_all(HttpTransport* transport) {
+    if (!transport) return;
+    for (size_t i = 0; i < transport->slot_count; i++) {
+        if (transport->slots[i].active) {
+            complete_slot(transport, &transport->slots[i], CURLE_ABORTED_BY_CALLBACK);
+        }
+    }
+}
+
+bool http_transport_has_capacity(const HttpTransport* transport) {
+    return transport && transport->in_flight < transport->slot_count;
+}
+
+size_t http_transport_in_flight(const HttpTransport* transport) {
+    return transport ? transport->in_flight : 0;
+}
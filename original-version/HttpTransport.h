@@ -0,0 +1,100 @@
+#ifndef HTTP_TRANSPORT_H
+#define HTTP_TRANSPORT_H
+
+/**
+ * @file HttpTransport.h
+ * @brief Asynchronous HTTP POST client built on curl_multi.
+ *
+ * Keeps up to `max_in_flight` requests to one endpoint in flight at once over
+ * a shared connection pool, each with its own deadline. All functions except
+ * http_transport_wakeup() must be called from a single thread (the owner),
+ * and completion callbacks are invoked on that thread from within
+ * http_transport_run().
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <curl/curl.h>
+
+typedef struct HttpTransport HttpTransport; // Opaque transport type
+
+typedef struct {
+    unsigned long long sequence; // Issue order of the request, starting at 1
+    CURLcode curl_code;          // Transport-level outcome
+    long http_status;            // HTTP status, or 0 if no response was received
+    long retry_after_s;          // Retry-After header in seconds, or 0 if absent
+    double total_time_s;         // Time from start to completion
+} HttpResult;
+
+// Called on the owner thread when a request completes, fails or is aborted.
+// The request body may be reused or freed as soon as this returns.
+typedef void (*http_completion_func_t)(void* request_context, const HttpResult* result, void* user_context);
+
+typedef struct {
+    const char* url;
+    struct curl_slist* headers;  // Sent with every request; must outlive the transport
+    size_t max_in_flight;
+    long connect_timeout_ms;
+    long request_timeout_ms;     // Per-request deadline
+    long dns_cache_timeout_s;
+    CURLSH* share;               // Optional shared DNS/connection/TLS caches
+} HttpTransportConfig;
+
+/**
+ * @brief Creates a transport and its pool of reusable request handles.
+ * @param config Endpoint, headers and limits.
+ * @param on_complete Completion callback.
+ * @param user_context Passed to every completion callback.
+ * @return A pointer to the new transport, or NULL on failure.
+ */
+HttpTransport* http_transport_create(const HttpTransportConfig* config,
+                                     http_completion_func_t on_complete, void* user_context);
+
+/**
+ * @brief Aborts any requests still in flight and frees the transport.
+ * @param transport The transport to destroy.
+ */
+void http_transport_destroy(HttpTransport* transport);
+
+/**
+ * @brief Starts a POST. The body must stay valid until its completion callback.
+ * @param transport The transport.
+ * @param body Request body.
+ * @param size Size of `body` in bytes.
+ * @param request_context Handed back to the completion callback.
+ * @return true if the request was started, false if no slot is free or curl failed.
+ */
+bool http_transport_post(HttpTransport* transport, const void* body, size_t size, void* request_context);
+
+/**
+ * @brief Drives transfers and dispatches completions, waiting up to `timeout_ms` for activity.
+ *
+ * Returns early when a transfer needs attention or http_transport_wakeup() is called.
+ * @param transport The transport.
+ * @param timeout_ms Maximum time to wait.
+ */
+void http_transport_run(HttpTransport* transport, int timeout_ms);
+
+/**
+ * @brief Interrupts a concurrent http_transport_run(). Safe to call from any thread.
+ * @param transport The transport.
+ */
+void http_transport_wakeup(HttpTransport* transport);
+
+/**
+ * @brief Cancels every request in flight, reporting each as CURLE_ABORTED_BY_CALLBACK.
+ * @param transport The transport.
+ */
+void http_transport_abort_all(HttpTransport* transport);
+
+/**
+ * @brief Returns true if another request can be started right now.
+ */
+bool http_transport_has_capacity(const HttpTransport* transport);
+
+/**
+ * @brief Returns the number of requests currently in flight.
+ */
+size_t http_transport_in_flight(const HttpTransport* transport);
+
+#endif // HTTP_TRANSPORT_H
@@ -1,10 +1,10 @@
 #include "LineProtocol.h"
+#include "FloatFormat.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include <ctype.h>
-#include <stdarg.h>
 
 // Default buffer size
 #define LP_DEFAULT_CAPACITY 1024
@@ -15,6 +15,9 @@
 struct LineProtocolBuilder {
     char* buffer;
     size_t capacity;
+    char* owned_buffer;         // Builder's own buffer, parked while an external one is bound
+    size_t owned_capacity;
+    bool external_buffer;       // buffer belongs to the caller and must not be reallocated
     size_t position;
     size_t measurement_end;     // Track end of measurement part
     size_t tags_end;            // Track end of tags part
@@ -25,41 +28,22 @@ struct LineProtocolBuilder {
     bool finalized;
 };
 
-// Helper function to escape special characters (quotes and backslashes) in strings.
-static char* escape_string(const char* input) {
-    if (!input) return NULL;
-    
-    size_t input_len = strlen(input);
-    size_t escaped_len = 0;
-    
-    // First pass: calculate required length
-    for (size_t i = 0; i < input_len; i++) {
-        char c = input[i];
-        if (c == '"' || c == '\\') {
-            escaped_len += 2;  // Need to escape with backslash
-        } else {
-            escaped_len += 1;
-        }
-    }
-    
-    char* escaped = malloc(escaped_len + 1);
-    if (!escaped) return NULL;
-    
-    // Second pass: build escaped string
-    size_t pos = 0;
-    for (size_t i = 0; i < input_len; i++) {
-        char c = input[i];
-        if (c == '"' || c == '\\') {
-            escaped[pos++] = '\\';
-            escaped[pos++] = c;
-        } else {
-            escaped[pos++] = c;
-        }
-    }
-    escaped[pos] = '\0';
-    
-    return escaped;
-}
+typedef struct {
+    size_t offset;              // Of " key=" (first field) or ",key=" in the template text
+    size_t length;
+    int significant_digits;
+} TemplateField;
+
+// Internal template structure
+struct LineProtocolTemplate {
+    char* text;                 // "measurement,tags" followed by every field's key fragment
+    size_t measurement_length;
+    size_t tags_length;         // Measurement plus tags
+    size_t field_count;
+    TemplateField fields[];
+};
+
+#define LP_INTEGER_DIGITS 20        // Digits of the largest 64-bit magnitude
 
 // Helper function to ensure buffer capacity
 static LineProtocolError ensure_capacity(LineProtocolBuilder* builder, size_t needed_space) {
@@ -70,6 +54,10 @@ static LineProtocolError ensure_capacity(LineProtocolBuilder* builder, size_t ne
     if (required_capacity <= builder->capacity) {
         return LP_SUCCESS;
     }
+
+    if (builder->external_buffer) {
+        return LP_ERROR_BUFFER_FULL;
+    }
     
     // Calculate new capacity
     size_t new_capacity = builder->capacity * LP_GROWTH_FACTOR;
@@ -91,54 +79,138 @@ static LineProtocolError ensure_capacity(LineProtocolBuilder* builder, size_t ne
     return LP_SUCCESS;
 }
 
-// Helper function to append string to buffer
-static LineProtocolError append_string(LineProtocolBuilder* builder, const char* str) {
-    if (!builder || !str) return LP_ERROR_INVALID_PARAM;
-    
-    size_t str_len = strlen(str);
-    LineProtocolError err = ensure_capacity(builder, str_len);
+// Drops everything written after `mark`, so a failed add leaves the line as it was
+static void rollback(LineProtocolBuilder* builder, size_t mark) {
+    builder->position = mark;
+    builder->buffer[mark] = '\0';
+}
+
+// Helper function to append raw bytes to buffer
+static LineProtocolError append_bytes(LineProtocolBuilder* builder, const char* data, size_t length) {
+    LineProtocolError err = ensure_capacity(builder, length);
     if (err != LP_SUCCESS) return err;
     
-    memcpy(builder->buffer + builder->position, str, str_len);
-    builder->position += str_len;
+    memcpy(builder->buffer + builder->position, data, length);
+    builder->position += length;
     builder->buffer[builder->position] = '\0';
     
     return LP_SUCCESS;
 }
 
-// Helper function to append formatted string to buffer
-static LineProtocolError append_formatted(LineProtocolBuilder* builder, const char* format, ...) {
-    if (!builder || !format) return LP_ERROR_INVALID_PARAM;
+static LineProtocolError append_char(LineProtocolBuilder* builder, char c) {
+    LineProtocolError err = ensure_capacity(builder, 1);
+    if (err != LP_SUCCESS) return err;
     
-    va_list args1, args2;
-    va_start(args1, format);
-    va_copy(args2, args1);
+    builder->buffer[builder->position++] = c;
+    builder->buffer[builder->position] = '\0';
+    return LP_SUCCESS;
+}
+
+static bool is_name_char(unsigned char c, bool measurement) {
+    return isalnum(c) || c == '_' || (measurement && (c == '-' || c == '.'));
+}
+
+// Copies a measurement name or key, validating each character as it is written
+static LineProtocolError append_name(LineProtocolBuilder* builder, const char* name, bool measurement,
+                                     LineProtocolError invalid) {
+    size_t length = strlen(name);
+    if (length == 0 || (measurement && name[0] == '_')) return invalid;
     
-    // Calculate required space
-    int needed = vsnprintf(NULL, 0, format, args1);
-    va_end(args1);
+    LineProtocolError err = ensure_capacity(builder, length);
+    if (err != LP_SUCCESS) return err;
     
-    if (needed < 0) {
-        va_end(args2);
-        return LP_ERROR_INVALID_PARAM;
+    char* out = builder->buffer + builder->position;
+    for (size_t i = 0; i < length; i++) {
+        if (!is_name_char((unsigned char)name[i], measurement)) {
+            builder->buffer[builder->position] = '\0';
+            return invalid;
+        }
+        out[i] = name[i];
     }
+    builder->position += length;
+    builder->buffer[builder->position] = '\0';
+    return LP_SUCCESS;
+}
+
+// Writes a string field value between quotes, escaping quotes and backslashes in place
+static LineProtocolError append_quoted(LineProtocolBuilder* builder, const char* value) {
+    size_t length = strlen(value);
+    size_t plain = strcspn(value, "\"\\");
     
-    LineProtocolError err = ensure_capacity(builder, needed);
-    if (err != LP_SUCCESS) {
-        va_end(args2);
-        return err;
+    // Only a value that needs escaping pays for the worst case
+    LineProtocolError err = ensure_capacity(builder, (plain == length ? length : 2 * length) + 2);
+    if (err != LP_SUCCESS) return err;
+    
+    char* out = builder->buffer + builder->position;
+    *out++ = '"';
+    memcpy(out, value, plain);
+    out += plain;
+    for (size_t i = plain; i < length; i++) {
+        if (value[i] == '"' || value[i] == '\\') {
+            *out++ = '\\';
+        }
+        *out++ = value[i];
+    }
+    *out++ = '"';
+    *out = '\0';
+    builder->position = (size_t)(out - builder->buffer);
+    return LP_SUCCESS;
+}
+
+// Formats an integer without printf, optionally followed by a type suffix
+static LineProtocolError append_integer(LineProtocolBuilder* builder, int64_t value, char suffix) {
+    char digits[LP_INTEGER_DIGITS + 2];
+    char* end = digits + sizeof(digits);
+    char* start = end;
+    
+    if (suffix) *--start = suffix;
+    // Negated as unsigned so INT64_MIN does not overflow
+    uint64_t magnitude = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+    do {
+        *--start = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+    if (value < 0) *--start = '-';
+    
+    return append_bytes(builder, start, (size_t)(end - start));
+}
+
+// Formats a double straight into the buffer when the longest output fits
+static LineProtocolError append_double(LineProtocolBuilder* builder, double value, int significant_digits) {
+    if (ensure_capacity(builder, FLOAT_FORMAT_MAX_LENGTH - 1) == LP_SUCCESS) {
+        builder->position += float_format(value, significant_digits, builder->buffer + builder->position);
+        return LP_SUCCESS;
     }
     
-    int written = vsnprintf(builder->buffer + builder->position, 
-                           builder->capacity - builder->position, 
-                           format, args2);
-    va_end(args2);
+    // A nearly full bound buffer may still have room for this particular value
+    char text[FLOAT_FORMAT_MAX_LENGTH];
+    size_t length = float_format(value, significant_digits, text);
+    return append_bytes(builder, text, length);
+}
+
+// Checks that a field may be added and writes its separator and key
+static LineProtocolError begin_field(LineProtocolBuilder* builder, const char* key) {
+    if (builder->finalized) return LP_ERROR_INVALID_STATE;
+    if (!builder->has_measurement) return LP_ERROR_INVALID_STATE;
     
-    if (written < 0 || written != needed) {
-        return LP_ERROR_INVALID_STATE;
+    size_t mark = builder->position;
+    LineProtocolError err = append_char(builder, builder->has_fields ? ',' : ' ');
+    if (err == LP_SUCCESS) err = append_name(builder, key, false, LP_ERROR_INVALID_FIELD_KEY);
+    if (err == LP_SUCCESS) err = append_char(builder, '=');
+    if (err != LP_SUCCESS) rollback(builder, mark);
+    return err;
+}
+
+// Completes a field started at `mark`, or removes it if its value could not be written
+static LineProtocolError end_field(LineProtocolBuilder* builder, size_t mark, LineProtocolError err) {
+    if (err != LP_SUCCESS) {
+        rollback(builder, mark);
+        return err;
+    }
+    if (!builder->has_fields) {
+        builder->fields_start = mark;
+        builder->has_fields = true;
     }
-    
-    builder->position += written;
     return LP_SUCCESS;
 }
 
@@ -170,11 +242,38 @@ LineProtocolBuilder* lp_builder_create_default(void) {
 
 void lp_builder_destroy(LineProtocolBuilder* builder) {
     if (builder) {
-        free(builder->buffer);
+        free(builder->external_buffer ? builder->owned_buffer : builder->buffer);
         free(builder);
     }
 }
 
+LineProtocolError lp_builder_bind_buffer(LineProtocolBuilder* builder, char* buffer, size_t capacity) {
+    if (!builder || !buffer || capacity == 0) return LP_ERROR_INVALID_PARAM;
+
+    if (!builder->external_buffer) {
+        builder->owned_buffer = builder->buffer;
+        builder->owned_capacity = builder->capacity;
+    }
+    builder->buffer = buffer;
+    builder->capacity = capacity;
+    builder->external_buffer = true;
+
+    return lp_builder_reset(builder);
+}
+
+LineProtocolError lp_builder_unbind_buffer(LineProtocolBuilder* builder) {
+    if (!builder) return LP_ERROR_INVALID_PARAM;
+    if (!builder->external_buffer) return LP_SUCCESS;
+
+    builder->buffer = builder->owned_buffer;
+    builder->capacity = builder->owned_capacity;
+    builder->owned_buffer = NULL;
+    builder->owned_capacity = 0;
+    builder->external_buffer = false;
+
+    return lp_builder_reset(builder);
+}
+
 LineProtocolError lp_builder_reset(LineProtocolBuilder* builder) {
     if (!builder) return LP_ERROR_INVALID_PARAM;
     
@@ -202,7 +301,7 @@ LineProtocolError lp_set_measurement(LineProtocolBuilder* builder, const char* m
     // Reset builder if measurement is being changed
     lp_builder_reset(builder);
     
-    LineProtocolError err = append_string(builder, measurement);
+    LineProtocolError err = append_bytes(builder, measurement, strlen(measurement));
     if (err != LP_SUCCESS) return err;
     
     builder->has_measurement = true;
@@ -217,89 +316,61 @@ LineProtocolError lp_add_tag(LineProtocolBuilder* builder, const char* key, cons
     if (builder->finalized) return LP_ERROR_INVALID_STATE;
     if (!builder->has_measurement) return LP_ERROR_INVALID_STATE;
     if (builder->has_fields) return LP_ERROR_INVALID_STATE; // Tags must come before fields
-    if (!lp_is_valid_tag_key(key)) return LP_ERROR_INVALID_TAG_KEY;
     
-    LineProtocolError err = append_formatted(builder, ",%s=%s", key, value);
-    if (err != LP_SUCCESS) return err;
+    size_t mark = builder->position;
+    LineProtocolError err = append_char(builder, ',');
+    if (err == LP_SUCCESS) err = append_name(builder, key, false, LP_ERROR_INVALID_TAG_KEY);
+    if (err == LP_SUCCESS) err = append_char(builder, '=');
+    if (err == LP_SUCCESS) err = append_bytes(builder, value, strlen(value));
+    if (err != LP_SUCCESS) {
+        rollback(builder, mark);
+        return err;
+    }
     
     builder->tags_end = builder->position;
     return LP_SUCCESS;
 }
 
 LineProtocolError lp_add_field_double(LineProtocolBuilder* builder, const char* key, double value) {
+    return lp_add_field_double_digits(builder, key, value, FLOAT_FORMAT_SHORTEST);
+}
+
+LineProtocolError lp_add_field_double_digits(LineProtocolBuilder* builder, const char* key, double value,
+                                             int significant_digits) {
     if (!builder || !key) return LP_ERROR_INVALID_PARAM;
-    if (builder->finalized) return LP_ERROR_INVALID_STATE;
-    if (!builder->has_measurement) return LP_ERROR_INVALID_STATE;
-    if (!lp_is_valid_field_key(key)) return LP_ERROR_INVALID_FIELD_KEY;
     if (isnan(value) || isinf(value)) return LP_ERROR_INVALID_PARAM;
     
-    const char* separator = builder->has_fields ? "," : " ";
-    LineProtocolError err = append_formatted(builder, "%s%s=%.6f", separator, key, value);
+    size_t mark = builder->position;
+    LineProtocolError err = begin_field(builder, key);
     if (err != LP_SUCCESS) return err;
-    
-    if (!builder->has_fields) {
-        builder->fields_start = builder->position - strlen(key) - 8; // Approximate
-        builder->has_fields = true;
-    }
-    
-    return LP_SUCCESS;
+    return end_field(builder, mark, append_double(builder, value, significant_digits));
 }
 
 LineProtocolError lp_add_field_integer(LineProtocolBuilder* builder, const char* key, int64_t value) {
     if (!builder || !key) return LP_ERROR_INVALID_PARAM;
-    if (builder->finalized) return LP_ERROR_INVALID_STATE;
-    if (!builder->has_measurement) return LP_ERROR_INVALID_STATE;
-    if (!lp_is_valid_field_key(key)) return LP_ERROR_INVALID_FIELD_KEY;
     
-    const char* separator = builder->has_fields ? "," : " ";
-    LineProtocolError err = append_formatted(builder, "%s%s=%ldi", separator, key, (long long)value);
+    size_t mark = builder->position;
+    LineProtocolError err = begin_field(builder, key);
     if (err != LP_SUCCESS) return err;
-    
-    if (!builder->has_fields) {
-        builder->has_fields = true;
-    }
-    
-    return LP_SUCCESS;
+    return end_field(builder, mark, append_integer(builder, value, 'i'));
 }
 
 LineProtocolError lp_add_field_string(LineProtocolBuilder* builder, const char* key, const char* value) {
     if (!builder || !key || !value) return LP_ERROR_INVALID_PARAM;
-    if (builder->finalized) return LP_ERROR_INVALID_STATE;
-    if (!builder->has_measurement) return LP_ERROR_INVALID_STATE;
-    if (!lp_is_valid_field_key(key)) return LP_ERROR_INVALID_FIELD_KEY;
-    
-    char* escaped_value = escape_string(value);
-    if (!escaped_value) return LP_ERROR_MEMORY_ALLOC;
     
-    const char* separator = builder->has_fields ? "," : " ";
-    LineProtocolError err = append_formatted(builder, "%s%s=\"%s\"", separator, key, escaped_value);
-    
-    free(escaped_value);
+    size_t mark = builder->position;
+    LineProtocolError err = begin_field(builder, key);
     if (err != LP_SUCCESS) return err;
-    
-    if (!builder->has_fields) {
-        builder->has_fields = true;
-    }
-    
-    return LP_SUCCESS;
+    return end_field(builder, mark, append_quoted(builder, value));
 }
 
 LineProtocolError lp_add_field_boolean(LineProtocolBuilder* builder, const char* key, bool value) {
     if (!builder || !key) return LP_ERROR_INVALID_PARAM;
-    if (builder->finalized) return LP_ERROR_INVALID_STATE;
-    if (!builder->has_measurement) return LP_ERROR_INVALID_STATE;
-    if (!lp_is_valid_field_key(key)) return LP_ERROR_INVALID_FIELD_KEY;
     
-    const char* separator = builder->has_fields ? "," : " ";
-    const char* bool_str = value ? "true" : "false";
-    LineProtocolError err = append_formatted(builder, "%s%s=%s", separator, key, bool_str);
+    size_t mark = builder->position;
+    LineProtocolError err = begin_field(builder, key);
     if (err != LP_SUCCESS) return err;
-    
-    if (!builder->has_fields) {
-        builder->has_fields = true;
-    }
-    
-    return LP_SUCCESS;
+    return end_field(builder, mark, value ? append_bytes(builder, "true", 4) : append_bytes(builder, "false", 5));
 }
 
 LineProtocolError lp_add_field(LineProtocolBuilder* builder, const LineProtocolField* field) {
@@ -324,8 +395,13 @@ LineProtocolError lp_set_timestamp(LineProtocolBuilder* builder, int64_t timesta
     if (builder->finalized) return LP_ERROR_INVALID_STATE;
     if (!builder->has_measurement || !builder->has_fields) return LP_ERROR_INVALID_STATE;
     
-    LineProtocolError err = append_formatted(builder, " %lld", (long long)timestamp);
-    if (err != LP_SUCCESS) return err;
+    size_t mark = builder->position;
+    LineProtocolError err = append_char(builder, ' ');
+    if (err == LP_SUCCESS) err = append_integer(builder, timestamp, '\0');
+    if (err != LP_SUCCESS) {
+        rollback(builder, mark);
+        return err;
+    }
     
     builder->has_timestamp = true;
     return LP_SUCCESS;
@@ -335,6 +411,91 @@ LineProtocolError lp_set_timestamp_now(LineProtocolBuilder* builder) {
     return lp_set_timestamp(builder, lp_get_current_timestamp());
 }
 
+LineProtocolTemplate* lp_template_create(const char* measurement, const char* const tag_keys[],
+                                         const char* const tag_values[], size_t tag_count,
+                                         const char* const field_keys[], const int field_digits[], size_t field_count) {
+    if (!measurement || (tag_count > 0 && (!tag_keys || !tag_values)) || !field_keys || field_count == 0) return NULL;
+    
+    LineProtocolTemplate* point_template = calloc(1, sizeof(LineProtocolTemplate) + field_count * sizeof(TemplateField));
+    LineProtocolBuilder* builder = lp_builder_create_default();
+    if (!point_template || !builder) {
+        free(point_template);
+        lp_builder_destroy(builder);
+        return NULL;
+    }
+    
+    // The builder validates every name while rendering the fixed text once
+    LineProtocolError err = lp_set_measurement(builder, measurement);
+    for (size_t i = 0; err == LP_SUCCESS && i < tag_count; i++) {
+        err = lp_add_tag(builder, tag_keys[i], tag_values[i]);
+    }
+    point_template->measurement_length = builder->measurement_end;
+    point_template->tags_length = builder->position;
+    for (size_t i = 0; err == LP_SUCCESS && i < field_count; i++) {
+        TemplateField* field = &point_template->fields[i];
+        field->offset = builder->position;
+        field->significant_digits = field_digits ? field_digits[i] : FLOAT_FORMAT_SHORTEST;
+        err = field_keys[i] ? append_char(builder, i > 0 ? ',' : ' ') : LP_ERROR_INVALID_PARAM;
+        if (err == LP_SUCCESS) err = append_name(builder, field_keys[i], false, LP_ERROR_INVALID_FIELD_KEY);
+        if (err == LP_SUCCESS) err = append_char(builder, '=');
+        field->length = builder->position - field->offset;
+    }
+    if (err != LP_SUCCESS) {
+        free(point_template);
+        lp_builder_destroy(builder);
+        return NULL;
+    }
+    
+    // Keep the rendered text and drop the rest of the builder
+    point_template->text = builder->buffer;
+    point_template->field_count = field_count;
+    builder->buffer = NULL;
+    lp_builder_destroy(builder);
+    return point_template;
+}
+
+void lp_template_destroy(LineProtocolTemplate* point_template) {
+    if (point_template) {
+        free(point_template->text);
+        free(point_template);
+    }
+}
+
+size_t lp_template_field_count(const LineProtocolTemplate* point_template) {
+    return point_template ? point_template->field_count : 0;
+}
+
+LineProtocolError lp_render_template(LineProtocolBuilder* builder, const LineProtocolTemplate* point_template,
+                                     const double values[], int64_t timestamp) {
+    if (!builder || !point_template || !values) return LP_ERROR_INVALID_PARAM;
+    
+    lp_builder_reset(builder);
+    LineProtocolError err = append_bytes(builder, point_template->text, point_template->tags_length);
+    for (size_t i = 0; err == LP_SUCCESS && i < point_template->field_count; i++) {
+        const TemplateField* field = &point_template->fields[i];
+        if (isnan(values[i]) || isinf(values[i])) {
+            err = LP_ERROR_INVALID_PARAM;
+            break;
+        }
+        err = append_bytes(builder, point_template->text + field->offset, field->length);
+        if (err == LP_SUCCESS) err = append_double(builder, values[i], field->significant_digits);
+    }
+    if (err == LP_SUCCESS) err = append_char(builder, ' ');
+    if (err == LP_SUCCESS) err = append_integer(builder, timestamp, '\0');
+    if (err != LP_SUCCESS) {
+        lp_builder_reset(builder);
+        return err;
+    }
+    
+    builder->has_measurement = true;
+    builder->measurement_end = point_template->measurement_length;
+    builder->tags_end = point_template->tags_length;
+    builder->fields_start = point_template->tags_length;
+    builder->has_fields = true;
+    builder->has_timestamp = true;
+    return LP_SUCCESS;
+}
+
 char* lp_copy(LineProtocolBuilder* builder) {
     if (!builder || !builder->has_measurement || !builder->has_fields) {
         return NULL;
@@ -376,7 +537,7 @@ bool lp_is_valid_measurement_name(const char* name) {
     
     // Check for invalid characters
     for (const char* p = name; *p; p++) {
-        if (!isalnum(*p) && *p != '_' && *p != '-' && *p != '.') {
+        if (!is_name_char((unsigned char)*p, true)) {
             return false;
         }
     }
@@ -389,7 +550,7 @@ bool lp_is_valid_tag_key(const char* key) {
     
     // Similar to measurement name but more restrictive
     for (const char* p = key; *p; p++) {
-        if (!isalnum(*p) && *p != '_') {
+        if (!is_name_char((unsigned char)*p, false)) {
             return false;
         }
     }
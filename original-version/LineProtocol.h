@@ -51,16 +51,28 @@ typedef struct {
 // Opaque builder structure
 typedef struct LineProtocolBuilder LineProtocolBuilder;
 
+// Opaque point template structure
+typedef struct LineProtocolTemplate LineProtocolTemplate;
+
 // Builder lifecycle
 LineProtocolBuilder* lp_builder_create(size_t initial_capacity);
 LineProtocolBuilder* lp_builder_create_default(void);
 void lp_builder_destroy(LineProtocolBuilder* builder);
 LineProtocolError lp_builder_reset(LineProtocolBuilder* builder);
 
+// Build directly into caller-owned memory (e.g. a pooled buffer) instead of the
+// builder's own growable buffer. The bound buffer never grows: appends that do
+// not fit fail with LP_ERROR_BUFFER_FULL. Binding and unbinding reset the builder.
+LineProtocolError lp_builder_bind_buffer(LineProtocolBuilder* builder, char* buffer, size_t capacity);
+LineProtocolError lp_builder_unbind_buffer(LineProtocolBuilder* builder);
+
 // Core building operations
 LineProtocolError lp_set_measurement(LineProtocolBuilder* builder, const char* measurement);
 LineProtocolError lp_add_tag(LineProtocolBuilder* builder, const char* key, const char* value);
 LineProtocolError lp_add_field_double(LineProtocolBuilder* builder, const char* key, double value);
+// Rounds to a number of significant digits; 0 writes the shortest digits that round-trip, as lp_add_field_double does
+LineProtocolError lp_add_field_double_digits(LineProtocolBuilder* builder, const char* key, double value,
+                                             int significant_digits);
 LineProtocolError lp_add_field_integer(LineProtocolBuilder* builder, const char* key, int64_t value);
 LineProtocolError lp_add_field_string(LineProtocolBuilder* builder, const char* key, const char* value);
 LineProtocolError lp_add_field_boolean(LineProtocolBuilder* builder, const char* key, bool value);
@@ -68,8 +80,23 @@ LineProtocolError lp_add_field(LineProtocolBuilder* builder, const LineProtocolF
 LineProtocolError lp_set_timestamp(LineProtocolBuilder* builder, int64_t timestamp);
 LineProtocolError lp_set_timestamp_now(LineProtocolBuilder* builder);
 
+// Point templates: a fixed measurement, tag set and ordered double fields,
+// validated and rendered once. Rendering a point then only copies that text
+// and formats the values and the timestamp, so its cost grows with the digits
+// written. lp_template_create returns NULL if a name is invalid. field_digits
+// holds the significant digits of each field (see lp_add_field_double_digits)
+// and may be NULL for the shortest round-trip form everywhere.
+LineProtocolTemplate* lp_template_create(const char* measurement, const char* const tag_keys[],
+                                         const char* const tag_values[], size_t tag_count,
+                                         const char* const field_keys[], const int field_digits[], size_t field_count);
+void lp_template_destroy(LineProtocolTemplate* point_template);
+size_t lp_template_field_count(const LineProtocolTemplate* point_template);
+// Replaces the builder's line with one point; `values` holds one finite value per field
+LineProtocolError lp_render_template(LineProtocolBuilder* builder, const LineProtocolTemplate* point_template,
+                                     const double values[], int64_t timestamp);
+
 // Output operations
-char* lp_copy(LineProtocolBuilder* builder);  // Caller owns returned string
+char* lp_copy(LineProtocolBuilder* builder);  // Caller owns returned string; allocates on every call
 const char* lp_view(const LineProtocolBuilder* builder);  // Read-only view
 size_t lp_get_length(const LineProtocolBuilder* builder);
 
@@ -0,0 +1,31 @@
+#ifndef MEASUREMENT_FRAME_H
+#define MEASUREMENT_FRAME_H
+
+/**
+ * @file MeasurementFrame.h
+ * @brief One snapshot of every published value, independent of any wire format.
+ *
+ * The publisher captures a frame once per send interval and each sink encodes
+ * it into its own format. Names point into the caller's storage (channel ids,
+ * string literals) and are only valid while the frame is being published;
+ * sinks encode synchronously and never keep the frame.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "Measurement.h"
+
+#define FRAME_MAX_VALUES (NUM_CHANNELS + 4) // Active channels plus the GPS fields
+
+typedef struct {
+    const char* name;
+    double value;
+} FrameValue;
+
+typedef struct {
+    int64_t timestamp;                    // Seconds since the epoch
+    size_t count;
+    FrameValue values[FRAME_MAX_VALUES];
+} MeasurementFrame;
+
+#endif // MEASUREMENT_FRAME_H
@@ -0,0 +1,85 @@
+#include "Metrics.h"
+#include <stdio.h>
+
+static unsigned int bucket_index(unsigned long long value) {
+    if (value == 0) return 0;
+    unsigned int index = 64U - (unsigned int)__builtin_clzll(value);
+    return index < METRICS_HISTOGRAM_BUCKETS ? index : METRICS_HISTOGRAM_BUCKETS - 1;
+}
+
+// Largest value that lands in the bucket
+static unsigned long long bucket_upper_bound(unsigned int index) {
+    if (index == 0) return 0;
+    if (index >= 64) return ~0ULL;
+    return (1ULL << index) - 1;
+}
+
+void metrics_histogram_record(MetricsHistogram* histogram, unsigned long long value) {
+    metrics_counter_add(&histogram->buckets[bucket_index(value)], 1);
+    metrics_counter_add(&histogram->count, 1);
+    metrics_counter_add(&histogram->sum, value);
+
+    // Each histogram has a single writer, so a plain compare is enough for the maximum
+    if (value > metrics_counter_read(&histogram->max)) {
+        atomic_store_explicit(&histogram->max, value, memory_order_relaxed);
+    }
+}
+
+void metrics_histogram_collect(const MetricsHistogram* histogram, MetricsHistogramSnapshot* snapshot) {
+    for (unsigned int i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++) {
+        snapshot->buckets[i] += metrics_counter_read(&histogram->buckets[i]);
+    }
+    snapshot->count += metrics_counter_read(&histogram->count);
+    snapshot->sum += metrics_counter_read(&histogram->sum);
+
+    unsigned long long max = metrics_counter_read(&histogram->max);
+    if (max > snapshot->max) snapshot->max = max;
+}
+
+unsigned long long metrics_histogram_percentile(const MetricsHistogramSnapshot* snapshot, double percentile) {
+    // The buckets are read one by one while writers go on, so use their own total
+    unsigned long long total = 0;
+    for (unsigned int i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++) {
+        total += snapshot->buckets[i];
+    }
+    if (total == 0) return 0;
+
+    unsigned long long rank = (unsigned long long)((percentile / 100.0) * (double)total + 0.5);
+    if (rank == 0) rank = 1;
+
+    unsigned long long seen = 0;
+    for (unsigned int i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++) {
+        seen += snapshot->buckets[i];
+        if (seen >= rank) {
+            unsigned long long bound = bucket_upper_bound(i);
+            return bound < snapshot->max ? bound : snapshot->max;
+        }
+    }
+    return snapshot->max;
+}
+
+int metrics_histogram_format_json(const MetricsHistogramSnapshot* snapshot, char* out, size_t capacity) {
+    size_t length = 0;
+    int written = snprintf(out, capacity,
+                           "{\"count\":%llu,\"sum\":%llu,\"max\":%llu,\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,\"buckets\":[",
+                           snapshot->count, snapshot->sum, snapshot->max,
+                           metrics_histogram_percentile(snapshot, 50.0),
+                           metrics_histogram_percentile(snapshot, 90.0),
+                           metrics_histogram_percentile(snapshot, 99.0));
+    if (written < 0 || (size_t)written >= capacity) return -1;
+    length = (size_t)written;
+
+    const char* separator = "";
+    for (unsigned int i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++) {
+        if (snapshot->buckets[i] == 0) continue;
+        written = snprintf(out + length, capacity - length, "%s[%llu,%llu]",
+                           separator, bucket_upper_bound(i), snapshot->buckets[i]);
+        if (written < 0 || (size_t)written >= capacity - length) return -1;
+        length += (size_t)written;
+        separator = ",";
+    }
+
+    written = snprintf(out + length, capacity - length, "]}");
+    if (written < 0 || (size_t)written >= capacity - length) return -1;
+    return (int)(length + (size_t)written);
+}
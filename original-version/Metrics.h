@@ -0,0 +1,95 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+/**
+ * @file Metrics.h
+ * @brief Lock-free counters, gauges and histograms for hot paths.
+ *
+ * Every metric is a relaxed atomic, so recording one costs a single
+ * uncontended atomic add and never takes a lock. Modules keep one block of
+ * metrics per writing thread (a shard, aligned to its own cache line) and add
+ * the shards together only when a snapshot is taken.
+ */
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define METRICS_CACHE_LINE 64
+
+// Bucket 0 holds the value 0, bucket i holds values in [2^(i-1), 2^i)
+#define METRICS_HISTOGRAM_BUCKETS 40
+
+typedef atomic_ullong MetricsCounter;
+typedef atomic_llong MetricsGauge;
+
+typedef struct {
+    MetricsCounter buckets[METRICS_HISTOGRAM_BUCKETS];
+    MetricsCounter count;
+    MetricsCounter sum;
+    MetricsCounter max;
+} MetricsHistogram;
+
+// Plain copy of one or more histograms, taken for reporting
+typedef struct {
+    unsigned long long buckets[METRICS_HISTOGRAM_BUCKETS];
+    unsigned long long count;
+    unsigned long long sum;
+    unsigned long long max;
+} MetricsHistogramSnapshot;
+
+static inline void metrics_counter_add(MetricsCounter* counter, unsigned long long amount) {
+    atomic_fetch_add_explicit(counter, amount, memory_order_relaxed);
+}
+
+static inline unsigned long long metrics_counter_read(const MetricsCounter* counter) {
+    return atomic_load_explicit((MetricsCounter*)counter, memory_order_relaxed);
+}
+
+static inline void metrics_gauge_set(MetricsGauge* gauge, long long value) {
+    atomic_store_explicit(gauge, value, memory_order_relaxed);
+}
+
+static inline long long metrics_gauge_read(const MetricsGauge* gauge) {
+    return atomic_load_explicit((MetricsGauge*)gauge, memory_order_relaxed);
+}
+
+/**
+ * @brief Records one observation.
+ * @param histogram The histogram, written by the calling thread only.
+ * @param value The observed value (milliseconds, bytes, items...).
+ */
+void metrics_histogram_record(MetricsHistogram* histogram, unsigned long long value);
+
+/**
+ * @brief Adds a histogram's current contents to a snapshot.
+ *
+ * Call it once per shard on a zeroed snapshot to get the combined histogram.
+ *
+ * @param histogram The histogram to read.
+ * @param snapshot In/out: the snapshot to add to.
+ */
+void metrics_histogram_collect(const MetricsHistogram* histogram, MetricsHistogramSnapshot* snapshot);
+
+/**
+ * @brief Estimates a percentile as the upper bound of the bucket that contains it.
+ * @param snapshot The snapshot.
+ * @param percentile Percentile in the range 0-100.
+ * @return The estimate (capped at the observed maximum), or 0 for an empty histogram.
+ */
+unsigned long long metrics_histogram_percentile(const MetricsHistogramSnapshot* snapshot, double percentile);
+
+/**
+ * @brief Formats a snapshot as a JSON object.
+ *
+ * Produces {"count":..,"sum":..,"max":..,"p50":..,"p90":..,"p99":..,"buckets":[[le,count],...]},
+ * listing only non-empty buckets by their inclusive upper bound.
+ *
+ * @param snapshot The snapshot.
+ * @param out Output buffer.
+ * @param capacity Size of `out`.
+ * @return Number of characters written (excluding the terminator), or -1 if it did not fit.
+ */
+int metrics_histogram_format_json(const MetricsHistogramSnapshot* snapshot, char* out, size_t capacity);
+
+#endif // METRICS_H
@@ -0,0 +1,132 @@
+#include "NetworkMonitor.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+#define NETWORK_MONITOR_MAX_LINKS 32
+#define NETWORK_MONITOR_BUFFER_SIZE 8192
+
+typedef struct {
+    int index;
+    bool running;
+} LinkState;
+
+struct NetworkMonitor {
+    int fd;
+    // Link notifications also report address and statistics changes, so only a
+    // transition to running counts as the link coming up
+    LinkState links[NETWORK_MONITOR_MAX_LINKS];
+    size_t link_count;
+};
+
+// --- Private Helpers ---
+
+// Records the new state of a link and returns true if it just started running
+static bool update_link(NetworkMonitor* monitor, int index, bool running) {
+    for (size_t i = 0; i < monitor->link_count; i++) {
+        if (monitor->links[i].index == index) {
+            bool came_up = running && !monitor->links[i].running;
+            monitor->links[i].running = running;
+            return came_up;
+        }
+    }
+    if (monitor->link_count < NETWORK_MONITOR_MAX_LINKS) {
+        monitor->links[monitor->link_count].index = index;
+        monitor->links[monitor->link_count].running = running;
+        monitor->link_count++;
+    }
+    return running; // A link not seen before, e.g. ppp0 being created
+}
+
+static bool is_connectivity_event(NetworkMonitor* monitor, const struct nlmsghdr* header) {
+    if (header->nlmsg_type == RTM_NEWLINK && header->nlmsg_len >= NLMSG_LENGTH(sizeof(struct ifinfomsg))) {
+        const struct ifinfomsg* link = NLMSG_DATA(header);
+        if (link->ifi_flags & IFF_LOOPBACK) return false;
+        return update_link(monitor, link->ifi_index, (link->ifi_flags & (IFF_UP | IFF_RUNNING)) == (IFF_UP | IFF_RUNNING));
+    }
+    if (header->nlmsg_type == RTM_DELLINK && header->nlmsg_len >= NLMSG_LENGTH(sizeof(struct ifinfomsg))) {
+        const struct ifinfomsg* link = NLMSG_DATA(header);
+        update_link(monitor, link->ifi_index, false);
+        return false;
+    }
+    if (header->nlmsg_type == RTM_NEWROUTE && header->nlmsg_len >= NLMSG_LENGTH(sizeof(struct rtmsg))) {
+        const struct rtmsg* route = NLMSG_DATA(header);
+        return route->rtm_dst_len == 0 && route->rtm_table == RT_TABLE_MAIN && route->rtm_type == RTN_UNICAST;
+    }
+    return false;
+}
+
+// --- Public Functions ---
+
+NetworkMonitor* network_monitor_create(void) {
+    NetworkMonitor* monitor = calloc(1, sizeof(NetworkMonitor));
+    if (!monitor) {
+        perror("Failed to allocate memory for NetworkMonitor");
+        return NULL;
+    }
+
+    monitor->fd = socket(AF_NETLINK, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (monitor->fd < 0) {
+        perror("Network monitor: failed to open netlink socket");
+        free(monitor);
+        return NULL;
+    }
+
+    struct sockaddr_nl address;
+    memset(&address, 0, sizeof(address));
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_ROUTE | RTMGRP_IPV6_ROUTE;
+    if (bind(monitor->fd, (struct sockaddr*)&address, sizeof(address)) != 0) {
+        perror("Network monitor: failed to subscribe to route changes");
+        close(monitor->fd);
+        free(monitor);
+        return NULL;
+    }
+    return monitor;
+}
+
+void network_monitor_destroy(NetworkMonitor* monitor) {
+    if (!monitor) return;
+    close(monitor->fd);
+    free(monitor);
+}
+
+int network_monitor_fd(const NetworkMonitor* monitor) {
+    return monitor ? monitor->fd : -1;
+}
+
+bool network_monitor_read(NetworkMonitor* monitor) {
+    if (!monitor) return false;
+
+    // Aligned for struct nlmsghdr
+    long buffer[NETWORK_MONITOR_BUFFER_SIZE / sizeof(long)];
+    bool changed = false;
+    for (;;) {
+        ssize_t received = recv(monitor->fd, buffer, sizeof(buffer), 0);
+        if (received < 0) {
+            if (errno == EINTR) continue;
+            if (errno == ENOBUFS) {
+                changed = true; // Notifications were lost; the link may well have come up
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror("Network monitor: failed to read route changes");
+            }
+            return changed;
+        }
+
+        size_t remaining = (size_t)received;
+        for (const struct nlmsghdr* header = (const struct nlmsghdr*)buffer; NLMSG_OK(header, remaining);
+             header = NLMSG_NEXT(header, remaining)) {
+            if (is_connectivity_event(monitor, header)) {
+                changed = true;
+            }
+        }
+    }
+}
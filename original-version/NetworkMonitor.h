@@ -0,0 +1,48 @@
+#ifndef NETWORK_MONITOR_H
+#define NETWORK_MONITOR_H
+
+/**
+ * @file NetworkMonitor.h
+ * @brief Notices when the uplink comes back, from kernel routing notifications.
+ *
+ * Listens on a netlink route socket for interfaces that start running and for
+ * new default routes, which is what a modem or Wi-Fi reconnect looks like to
+ * the kernel. The owner polls the descriptor alongside its other events and
+ * calls network_monitor_read() when it becomes readable. Not thread-safe; one
+ * thread owns the monitor.
+ */
+
+#include <stdbool.h>
+
+typedef struct NetworkMonitor NetworkMonitor; // Opaque monitor type
+
+/**
+ * @brief Opens the netlink socket and subscribes to link and route changes.
+ * @return A pointer to the new monitor, or NULL if netlink is not available.
+ */
+NetworkMonitor* network_monitor_create(void);
+
+/**
+ * @brief Closes the socket and frees the monitor.
+ * @param monitor The monitor to destroy.
+ */
+void network_monitor_destroy(NetworkMonitor* monitor);
+
+/**
+ * @brief Returns the descriptor to poll for readability.
+ */
+int network_monitor_fd(const NetworkMonitor* monitor);
+
+/**
+ * @brief Reads every pending notification without blocking.
+ *
+ * Loopback, links going down and routes other than a default route are ignored.
+ * If the kernel dropped notifications because they were not read in time, a
+ * change is assumed.
+ *
+ * @param monitor The monitor.
+ * @return true if an interface started running or a default route was added.
+ */
+bool network_monitor_read(NetworkMonitor* monitor);
+
+#endif // NETWORK_MONITOR_H
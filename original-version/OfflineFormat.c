@@ -0,0 +1,110 @@
+#include "OfflineFormat.h"
+#include "Crc32c.h"
+#include <stdio.h>
+#include <string.h>
+
+#define GZIP_FLAG_EXTRA 0x04
+#define GZIP_TRAILER_SIZE 8
+#define GZIP_XLEN_OFFSET 10
+
+// "OL" subfield: member size, line count and checksum, little-endian, patched in after compression
+#define FRAME_EXTRA_OFFSET 12
+#define FRAME_SIZE_OFFSET 16
+#define FRAME_LINES_OFFSET 20
+#define FRAME_CRC_OFFSET 24
+#define FRAME_SUBFIELD_LENGTH 12
+
+static const unsigned char frame_extra_template[OFFLINE_FRAME_HEADER_SIZE - FRAME_EXTRA_OFFSET] = {
+    'O', 'L', FRAME_SUBFIELD_LENGTH, 0, // Subfield id and length
+    0, 0, 0, 0,                         // Member size
+    0, 0, 0, 0,                         // Line count
+    0, 0, 0, 0,                         // CRC-32C of the member, this field left out
+};
+
+static void put_le32(unsigned char* out, unsigned long value) {
+    out[0] = (unsigned char)value;
+    out[1] = (unsigned char)(value >> 8);
+    out[2] = (unsigned char)(value >> 16);
+    out[3] = (unsigned char)(value >> 24);
+}
+
+static unsigned long get_le32(const unsigned char* in) {
+    return (unsigned long)in[0] | (unsigned long)in[1] << 8 | (unsigned long)in[2] << 16 |
+           (unsigned long)in[3] << 24;
+}
+
+// Covers everything but the checksum field, so the size and line count are protected too
+static uint32_t frame_checksum(const unsigned char* member, size_t size) {
+    uint32_t crc = crc32c_update(0, member, FRAME_CRC_OFFSET);
+    return crc32c_update(crc, member + OFFLINE_FRAME_HEADER_SIZE, size - OFFLINE_FRAME_HEADER_SIZE);
+}
+
+bool offline_format_encode(GzipCompressor* compressor, const struct iovec* iov, int iov_count,
+                           unsigned char** output, size_t* output_capacity, size_t* output_size) {
+    gzip_compressor_begin_extra(compressor, output, output_capacity, frame_extra_template,
+                                sizeof(frame_extra_template));
+
+    unsigned long line_count = 0;
+    for (int i = 0; i < iov_count; i++) {
+        const char* data = iov[i].iov_base;
+        const char* end = data + iov[i].iov_len;
+        while ((data = memchr(data, '\n', (size_t)(end - data))) != NULL) {
+            line_count++;
+            data++;
+        }
+        gzip_compressor_append(compressor, iov[i].iov_base, iov[i].iov_len);
+    }
+
+    size_t size = 0;
+    if (!gzip_compressor_finish(compressor, &size)) {
+        return false;
+    }
+    if (size > 0xFFFFFFFFUL) {
+        fprintf(stderr, "Offline format: member of %zu bytes is too large to frame.\n", size);
+        return false;
+    }
+    put_le32(*output + FRAME_SIZE_OFFSET, (unsigned long)size);
+    put_le32(*output + FRAME_LINES_OFFSET, line_count);
+    put_le32(*output + FRAME_CRC_OFFSET, frame_checksum(*output, size));
+    *output_size = size;
+    return true;
+}
+
+// Compares the part of `expected` (which belongs at `offset`) that lies within the first `available` bytes
+static bool matches_prefix(const unsigned char* data, size_t available, size_t offset,
+                           const unsigned char* expected, size_t size) {
+    if (available <= offset) return true;
+    size_t compared = available - offset < size ? available - offset : size;
+    return memcmp(data + offset, expected, compared) == 0;
+}
+
+OfflineFrameStatus offline_format_parse(const unsigned char* data, size_t available, OfflineFrame* frame) {
+    // Everything that is there must look like our header, however little of it was written
+    static const unsigned char magic[] = { 0x1f, 0x8b, 8, GZIP_FLAG_EXTRA }; // ID1, ID2, deflate, FEXTRA only
+    if (!matches_prefix(data, available, 0, magic, sizeof(magic))) {
+        return OFFLINE_FRAME_INVALID;
+    }
+    if (available <= GZIP_XLEN_OFFSET) {
+        return OFFLINE_FRAME_TRUNCATED;
+    }
+    const unsigned char extra_prefix[] = { FRAME_SUBFIELD_LENGTH + 4, 0, 'O', 'L', FRAME_SUBFIELD_LENGTH, 0 };
+    if (!matches_prefix(data, available, GZIP_XLEN_OFFSET, extra_prefix, sizeof(extra_prefix))) {
+        return OFFLINE_FRAME_INVALID;
+    }
+    if (available < OFFLINE_FRAME_HEADER_SIZE) {
+        return OFFLINE_FRAME_TRUNCATED;
+    }
+
+    frame->size = get_le32(data + FRAME_SIZE_OFFSET);
+    frame->line_count = (unsigned int)get_le32(data + FRAME_LINES_OFFSET);
+    if (frame->size < OFFLINE_FRAME_HEADER_SIZE + GZIP_TRAILER_SIZE) {
+        return OFFLINE_FRAME_INVALID;
+    }
+    if (frame->size > available) {
+        return OFFLINE_FRAME_TRUNCATED;
+    }
+    if (get_le32(data + FRAME_CRC_OFFSET) != frame_checksum(data, frame->size)) {
+        return OFFLINE_FRAME_CORRUPT;
+    }
+    return OFFLINE_FRAME_OK;
+}
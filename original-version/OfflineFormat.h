@@ -0,0 +1,63 @@
+#ifndef OFFLINE_FORMAT_H
+#define OFFLINE_FORMAT_H
+
+/**
+ * @file OfflineFormat.h
+ * @brief On-disk format of the offline log: a sequence of self-describing gzip members.
+ *
+ * Each flush group of line protocol is stored as one complete gzip member
+ * (RFC 1952). Its FEXTRA header field holds an "OL" subfield with the size of
+ * the whole member, the number of lines in it and a CRC-32C of the member, so
+ * a reader can step from member to member, and tell a torn or damaged one from
+ * a good one, without inflating anything.
+ *
+ * Any run of consecutive members is itself a valid multi-member gzip stream,
+ * so replay sends stored bytes as a `Content-Encoding: gzip` body as they are.
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <sys/uio.h>
+#include "Compression.h"
+
+#define OFFLINE_FRAME_HEADER_SIZE 28 // Fixed gzip header (10) + XLEN (2) + "OL" subfield (16)
+
+typedef struct {
+    size_t size;              // Whole member, header and trailer included
+    unsigned int line_count;
+} OfflineFrame;
+
+typedef enum {
+    OFFLINE_FRAME_OK,
+    OFFLINE_FRAME_TRUNCATED,  // Header or body cut short, e.g. by a power loss during the write
+    OFFLINE_FRAME_CORRUPT,    // Complete, but the checksum does not match its contents
+    OFFLINE_FRAME_INVALID     // Not a member written by offline_format_encode()
+} OfflineFrameStatus;
+
+/**
+ * @brief Compresses newline-terminated lines into one framed gzip member.
+ *
+ * @param compressor The calling thread's compressor.
+ * @param iov Pieces of input, concatenated in order.
+ * @param iov_count Number of pieces.
+ * @param output In/out: the output buffer, grown as needed (may point to NULL initially). Caller frees.
+ * @param output_capacity In/out: the allocated size of `*output`.
+ * @param output_size Out: size of the member.
+ * @return true on success.
+ */
+bool offline_format_encode(GzipCompressor* compressor, const struct iovec* iov, int iov_count,
+                           unsigned char** output, size_t* output_capacity, size_t* output_size);
+
+/**
+ * @brief Reads the frame header of the member starting at `data` and verifies its checksum.
+ *
+ * A member without the full "OL" subfield, checksum included, is invalid.
+ *
+ * @param data Start of the member.
+ * @param available Bytes readable from `data` on, at least up to the end of the member.
+ * @param frame Out: size and line count of the member (valid for OFFLINE_FRAME_OK only).
+ * @return OFFLINE_FRAME_OK if the whole member is available.
+ */
+OfflineFrameStatus offline_format_parse(const unsigned char* data, size_t available, OfflineFrame* frame);
+
+#endif // OFFLINE_FORMAT_H
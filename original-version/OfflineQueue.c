@@ -1,191 +1,893 @@
 #include "OfflineQueue.h"
+#include "OfflineWriter.h"
+#include "OfflineFormat.h"
+#include "Downsampler.h"
+#include "EncodePipeline.h"
+#include "Crc32c.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
-#include <zlib.h> // For gzip compression
 
-#define MAX_BATCH_SIZE 5000
-#define MAX_LINE_LENGTH 2048
-#define BATCH_BUFFER_SIZE (MAX_BATCH_SIZE * MAX_LINE_LENGTH)
+#define MAX_BATCH_SIZE 5000                    // Lines per replay request, reached in whole members
+#define MAX_BATCH_BYTES (1024 * 1024)           // Compressed bytes per replay request
+#define MEMBER_CHUNK_SIZE (64 * 1024)           // Text stored without the writer goes into members of about this size
+#define IMPORT_CHUNKS_PER_WORKER 2              // Import pipeline depth: one chunk compressing, one waiting
+
+#define COMPACT_START_PERCENT 80                // Share of the disk budget at which old segments are downsampled
+#define DECOMPRESS_CHUNK_SIZE (64 * 1024)
+#define BISECT_MAX_DEPTH 8                      // Halvings before a refused range is quarantined whole: at most 511 requests
+
+#define SEGMENT_SUFFIX ".seg"
+#define AGGREGATE_SUFFIX ".agg"                 // A downsampled segment, never compacted again
+#define CURSOR_SUFFIX ".cursor"                 // Replay position in the segment with the same id
+#define QUARANTINE_FILE_NAME "quarantine.txt"  // Lines the server refused, kept for inspection
+
+// The offline log is a directory of append-only segments named by a growing id.
+// Only the active (highest) segment is ever written; replay reads the sealed
+// ones, records how far it got in each one's cursor file after every
+// acknowledged batch, and unlinks each segment once it has been sent
+// completely. Every segment keeps its own cursor, so replaying newer data first
+// never loses the position in an older, partly sent segment. Under disk
+// pressure the oldest sealed segments are replaced by per-bucket aggregates
+// with the same id, and past the budget the oldest segments are evicted.
+static char g_directory[256];
+static char g_quarantine_path[300];
+static pthread_mutex_t g_segment_mutex = PTHREAD_MUTEX_INITIALIZER; // Guards rotation
+static unsigned long long g_active_segment;
+static size_t g_segment_bytes;
+static int g_gzip_level;
+static unsigned long long g_max_bytes;
+static unsigned int g_downsample_interval_s;
+static size_t g_compress_workers;
+static OfflineReplayOrder g_replay_order = OFFLINE_REPLAY_OLDEST_FIRST;
+static OfflineWriter* g_writer;       // NULL before init and after shutdown
+
+typedef struct {
+    unsigned long long id;
+    bool aggregated;
+    unsigned long long size;
+} SegmentEntry;
+
+// A sealed segment mapped read-only. Batches are slices of the mapping and go to the
+// transport as they are, so replay needs no buffer however large the backlog gets.
+typedef struct {
+    const unsigned char* data;
+    size_t size;
+} SegmentMap;
+
+// --- Segment Helpers ---
+
+static void segment_path(unsigned long long id, bool aggregated, char* out, size_t capacity) {
+    snprintf(out, capacity, "%s/%016llu%s", g_directory, id, aggregated ? AGGREGATE_SUFFIX : SEGMENT_SUFFIX);
+}
+
+static int compare_entries(const void* a, const void* b) {
+    const SegmentEntry* left = a;
+    const SegmentEntry* right = b;
+    if (left->id != right->id) return (left->id > right->id) - (left->id < right->id);
+    return (int)left->aggregated - (int)right->aggregated;
+}
+
+// Returns all segments with an id below `below`, oldest first. Caller frees. A raw
+// segment whose aggregate exists is left out, and removed too if `prune` is set;
+// only the replay thread prunes, so reading the queue size never changes the queue.
+static SegmentEntry* list_segments(unsigned long long below, bool prune, size_t* count) {
+    *count = 0;
+    DIR* dir = opendir(g_directory);
+    if (!dir) return NULL;
+
+    size_t capacity = 16;
+    SegmentEntry* entries = malloc(capacity * sizeof(*entries));
+    struct dirent* entry;
+    while (entries && (entry = readdir(dir)) != NULL) {
+        char* end;
+        unsigned long long id = strtoull(entry->d_name, &end, 10);
+        bool aggregated = strcmp(end, AGGREGATE_SUFFIX) == 0;
+        if (end == entry->d_name || (!aggregated && strcmp(end, SEGMENT_SUFFIX) != 0) || id >= below) continue;
+
+        struct stat st;
+        if (fstatat(dirfd(dir), entry->d_name, &st, 0) != 0) continue; // Removed meanwhile
+
+        if (*count == capacity) {
+            SegmentEntry* new_entries = realloc(entries, capacity * 2 * sizeof(*entries));
+            if (!new_entries) {
+                free(entries);
+                entries = NULL;
+                break;
+            }
+            entries = new_entries;
+            capacity *= 2;
+        }
+        entries[(*count)++] = (SegmentEntry){ .id = id, .aggregated = aggregated, .size = (unsigned long long)st.st_size };
+    }
+    closedir(dir);
+
+    if (!entries) {
+        perror("Failed to list offline segments");
+        *count = 0;
+        return NULL;
+    }
+    qsort(entries, *count, sizeof(*entries), compare_entries);
+
+    // Both files of one id: a compaction was interrupted after its aggregate was complete
+    size_t kept = 0;
+    for (size_t i = 0; i < *count; i++) {
+        if (i + 1 < *count && entries[i + 1].id == entries[i].id) {
+            if (prune) {
+                char path[512];
+                segment_path(entries[i].id, false, path, sizeof(path));
+                remove(path);
+            }
+            continue;
+        }
+        entries[kept++] = entries[i];
+    }
+    *count = kept;
+    return entries;
+}
+
+// Starts a new active segment; the previous one becomes eligible for replay. Caller holds g_segment_mutex.
+static void seal_active_segment_locked(void) {
+    g_active_segment++;
+    char path[512];
+    segment_path(g_active_segment, false, path, sizeof(path));
+    offline_writer_switch(g_writer, path);
+}
+
+static size_t active_segment_size(void) {
+    if (g_writer) return offline_writer_file_size(g_writer);
+
+    char path[512];
+    segment_path(g_active_segment, false, path, sizeof(path));
+    struct stat st;
+    return stat(path, &st) == 0 ? (size_t)st.st_size : 0;
+}
+
+// Keeps segments near their configured size; replay and eviction work a segment at a time
+static void rotate_if_full(void) {
+    if (active_segment_size() < g_segment_bytes) return;
 
-static char g_log_file_path[256];
-static char g_temp_log_file_path[256];
+    pthread_mutex_lock(&g_segment_mutex);
+    if (active_segment_size() >= g_segment_bytes) { // Another thread may have rotated meanwhile
+        seal_active_segment_locked();
+    }
+    pthread_mutex_unlock(&g_segment_mutex);
+}
+
+static bool map_segment(const char* path, SegmentMap* map) {
+    map->data = NULL;
+    map->size = 0;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        perror("Could not open offline segment");
+        if (fd >= 0) close(fd);
+        return false;
+    }
+    if (st.st_size == 0) { // Nothing to map
+        close(fd);
+        return true;
+    }
+
+    void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping keeps the file referenced
+    if (data == MAP_FAILED) {
+        perror("Could not map offline segment");
+        return false;
+    }
+    madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+    map->data = data;
+    map->size = (size_t)st.st_size;
+    return true;
+}
+
+static void unmap_segment(SegmentMap* map) {
+    if (map->data) munmap((void*)map->data, map->size);
+    map->data = NULL;
+    map->size = 0;
+}
+
+static void cursor_path(unsigned long long id, char* out, size_t capacity) {
+    snprintf(out, capacity, "%s/%016llu%s", g_directory, id, CURSOR_SUFFIX);
+}
+
+// Returns how many bytes at the start of segment `id` have been acknowledged
+static long load_cursor(unsigned long long id) {
+    char path[512];
+    cursor_path(id, path, sizeof(path));
+    FILE* file = fopen(path, "r");
+    if (!file) return 0;
+    long offset = 0;
+    if (fscanf(file, "%ld", &offset) != 1 || offset < 0) {
+        offset = 0;
+    }
+    fclose(file);
+    return offset;
+}
+
+// Replaces the cursor file atomically and makes it durable before the next batch is sent
+static void save_cursor(unsigned long long id, long offset) {
+    char path[512];
+    char temp_path[520];
+    cursor_path(id, path, sizeof(path));
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+    FILE* file = fopen(temp_path, "w");
+    if (!file) {
+        perror("Failed to write offline replay cursor");
+        return;
+    }
+    fprintf(file, "%ld\n", offset);
+    fflush(file);
+    fdatasync(fileno(file));
+    fclose(file);
+    if (rename(temp_path, path) != 0) {
+        perror("Failed to update offline replay cursor");
+    }
+}
+
+static void remove_cursor(unsigned long long id) {
+    char path[512];
+    cursor_path(id, path, sizeof(path));
+    remove(path);
+}
+
+// --- Recovery ---
+
+// Cuts a segment left by a previous run back to its last intact member, so replay never
+// meets a torn write. One sequential pass over the frame headers and checksums; the line
+// protocol inside is never inflated. Returns the number of lines that remain.
+static unsigned long long recover_segment(const SegmentEntry* segment) {
+    char path[512];
+    segment_path(segment->id, segment->aggregated, path, sizeof(path));
+    SegmentMap map;
+    if (!map_segment(path, &map)) return 0;
+
+    size_t position = 0;
+    unsigned long long line_count = 0;
+    OfflineFrameStatus status = OFFLINE_FRAME_OK;
+    while (position < map.size) {
+        OfflineFrame frame;
+        status = offline_format_parse(map.data + position, map.size - position, &frame);
+        if (status != OFFLINE_FRAME_OK) break;
+        position += frame.size;
+        line_count += frame.line_count;
+    }
+    size_t size = map.size;
+    unmap_segment(&map);
+    if (position == size) return line_count;
+
+    fprintf(stderr, "Offline queue: %s frame at offset %zu of %s; dropping the last %zu bytes.\n",
+            status == OFFLINE_FRAME_TRUNCATED ? "incomplete" : status == OFFLINE_FRAME_CORRUPT ? "damaged" : "unreadable",
+            position, path, size - position);
+    if (position == 0) {
+        remove(path);
+        return 0;
+    }
+    int fd = open(path, O_WRONLY | O_CLOEXEC);
+    if (fd < 0 || ftruncate(fd, (off_t)position) != 0 || fdatasync(fd) != 0) {
+        perror("Failed to truncate offline segment"); // Replay still stops at the same frame
+    }
+    if (fd >= 0) close(fd);
+    return line_count;
+}
 
 // --- Public Functions ---
 
-void offline_queue_init(const char* log_file_path) {
+void offline_queue_init(const char* directory, const OfflineQueueConfig* config) {
     mkdir("logs", 0755); // Ensure the directory exists
-    strncpy(g_log_file_path, log_file_path, sizeof(g_log_file_path) - 1);
-    g_log_file_path[sizeof(g_log_file_path) - 1] = '\0';
+    strncpy(g_directory, directory, sizeof(g_directory) - 1);
+    g_directory[sizeof(g_directory) - 1] = '\0';
+    mkdir(g_directory, 0755);
+    snprintf(g_quarantine_path, sizeof(g_quarantine_path), "%s/" QUARANTINE_FILE_NAME, g_directory);
+    g_segment_bytes = config->segment_bytes > 0 ? config->segment_bytes : 1;
+    g_gzip_level = config->gzip_level;
+    g_max_bytes = config->max_bytes;
+    g_downsample_interval_s = config->downsample_interval_s > 0 ? config->downsample_interval_s : 60;
+    g_compress_workers = config->compress_workers;
+
+    // Segments left by a previous run are sealed; this run appends to a new one
+    size_t count = 0;
+    SegmentEntry* entries = list_segments(~0ULL, true, &count);
+    g_active_segment = count > 0 ? entries[count - 1].id + 1 : 1;
+    unsigned long long line_count = 0;
+    for (size_t i = 0; i < count; i++) {
+        line_count += recover_segment(&entries[i]);
+    }
+    free(entries);
+
+    char path[512];
+    segment_path(g_active_segment, false, path, sizeof(path));
+    OfflineWriterConfig writer_config = {
+        .commit_interval_ms = config->commit_interval_ms,
+        .commit_bytes = config->commit_bytes,
+        .buffer_capacity = config->commit_bytes * 2, // Room to keep appending while a commit is waiting for the card
+        .gzip_level = config->gzip_level,
+    };
+    g_writer = offline_writer_create(path, &writer_config);
+    if (!g_writer) {
+        fprintf(stderr, "Offline queue: buffered writer unavailable, appending line by line.\n");
+    }
+    if (count > 0) {
+        printf("Offline queue: %zu segments with %llu lines waiting for replay (CRC-32C: %s).\n", count, line_count,
+               crc32c_implementation());
+    }
+}
 
-    snprintf(g_temp_log_file_path, sizeof(g_temp_log_file_path), "%s.tmp", g_log_file_path);
+void offline_queue_shutdown(void) {
+    if (!g_writer) return;
+    offline_writer_commit(g_writer);
+    OfflineWriterStats stats;
+    offline_writer_get_stats(g_writer, &stats);
+    offline_writer_destroy(g_writer);
+    g_writer = NULL;
+    printf("Offline queue: %llu bytes stored as %llu in %llu commits, %llu bytes dropped\n",
+           stats.bytes_committed, stats.bytes_written, stats.commits, stats.bytes_dropped);
 }
 
-void offline_queue_add(const char* line_protocol) {
-    FILE* file = fopen(g_log_file_path, "a");
-    if (file) {
-        fprintf(file, "%s\n", line_protocol);
-        fclose(file);
-    } else {
+static bool append_member_unbuffered(const unsigned char* member, size_t size) {
+    char path[512];
+    segment_path(g_active_segment, false, path, sizeof(path));
+    FILE* file = fopen(path, "a");
+    if (!file) {
         perror("Failed to open offline log file");
+        return false;
+    }
+    bool written = fwrite(member, 1, size, file) == size;
+    if (!written) {
+        perror("Failed to write offline batch");
     }
+    return fclose(file) == 0 && written;
 }
 
+// Without the buffered writer (not initialized, or already shut down) every append
+// becomes its own member, with a compressor and a file opened just for it
+static void append_unbuffered(const struct iovec* iov, int iov_count) {
+    GzipCompressor* compressor = gzip_compressor_create(g_gzip_level);
+    unsigned char* member = NULL;
+    size_t member_capacity = 0;
+    size_t member_size = 0;
+    if (!compressor || !offline_format_encode(compressor, iov, iov_count, &member, &member_capacity, &member_size)) {
+        fprintf(stderr, "Offline queue: failed to compress offline lines.\n");
+        gzip_compressor_destroy(compressor);
+        free(member);
+        return;
+    }
+    gzip_compressor_destroy(compressor);
+    append_member_unbuffered(member, member_size);
+    free(member);
+}
 
-// Helper function to process a batch of lines
-static bool process_batch(send_batch_func_t send_func, void* user_context, char* line_batch[], int line_count) {
-    if (line_count == 0) {
-        return true;
+static void append_text(const char* text, size_t size) {
+    if (g_writer) {
+        offline_writer_append(g_writer, text, size);
+    } else {
+        struct iovec iov = { .iov_base = (void*)text, .iov_len = size };
+        append_unbuffered(&iov, 1);
     }
+}
+
+// Stores the compressed chunks of an import in order, sealing full segments on the way
+static bool store_imported_member(const unsigned char* member, size_t size, size_t text_size, void* user_context) {
+    (void)user_context;
+    bool stored = g_writer ? offline_writer_append_encoded(g_writer, member, size, text_size)
+                           : append_member_unbuffered(member, size);
+    rotate_if_full();
+    return stored;
+}
+
+void offline_queue_import(const char* path) {
+    FILE* legacy = path ? fopen(path, "r") : NULL;
+    if (!legacy) return;
+
+    // Read in chunks that end on a line boundary, so no line is split across members.
+    // The workers compress earlier chunks while the next ones are read and stored.
+    size_t depth = g_compress_workers > 0 ? g_compress_workers * IMPORT_CHUNKS_PER_WORKER : 1;
+    EncodePipeline* pipeline = encode_pipeline_create(g_compress_workers, depth, g_gzip_level,
+                                                      store_imported_member, NULL);
+    size_t capacity = MEMBER_CHUNK_SIZE;
+    char* chunk = malloc(capacity);
+    size_t used = 0;
+    unsigned long long imported = 0;
+    bool complete = chunk != NULL && pipeline != NULL;
+    while (complete) {
+        if (used == capacity) { // A single line longer than the chunk
+            char* new_chunk = realloc(chunk, capacity * 2);
+            if (!new_chunk) {
+                complete = false;
+                break;
+            }
+            chunk = new_chunk;
+            capacity *= 2;
+        }
+        size_t read = fread(chunk + used, 1, capacity - used, legacy);
+        used += read;
+        if (read == 0) {
+            if (used == 0) break;
+            if (used == capacity) continue; // Make room for the missing newline first
+            chunk[used++] = '\n';        // Last line without its newline
+        }
 
-    // 1. Concatenate the batch into a single buffer
-    size_t total_size = 0;
-    for (int i = 0; i < line_count; i++) {
-        total_size += strlen(line_batch[i]);
+        size_t lines_size = used;
+        while (lines_size > 0 && chunk[lines_size - 1] != '\n') lines_size--;
+        if (lines_size == 0) continue;
+        if (!encode_pipeline_submit(pipeline, chunk, lines_size)) {
+            complete = false;
+            break;
+        }
+        imported += lines_size;
+        memmove(chunk, chunk + lines_size, used - lines_size);
+        used -= lines_size;
     }
+    bool stored = pipeline && encode_pipeline_finish(pipeline);
+    complete = complete && stored && !ferror(legacy);
+    encode_pipeline_destroy(pipeline);
+    fclose(legacy);
+    free(chunk);
+
+    if (!complete) {
+        fprintf(stderr, "Offline queue: could not import %s completely; keeping it.\n", path);
+        return;
+    }
+    offline_queue_flush();
+    remove(path);
+    printf("Offline queue: imported %llu bytes from %s (%zu compression threads)\n", imported, path,
+           g_compress_workers);
+}
 
-    char* uncompressed_buffer = malloc(total_size + 1);
-    if (!uncompressed_buffer) {
-        perror("Failed to allocate memory for uncompressed batch");
-        return false;
+void offline_queue_add_lines(const char* text, size_t size) {
+    if (!text || size == 0) return;
+    append_text(text, size);
+    rotate_if_full();
+}
+
+void offline_queue_flush(void) {
+    offline_writer_commit(g_writer);
+}
+
+unsigned long long offline_queue_size_bytes(void) {
+    size_t count = 0;
+    SegmentEntry* entries = list_segments(~0ULL, false, &count);
+
+    unsigned long long total = 0;
+    for (size_t i = 0; i < count; i++) {
+        unsigned long long acknowledged = (unsigned long long)load_cursor(entries[i].id);
+        total += acknowledged <= entries[i].size ? entries[i].size - acknowledged : 0;
     }
+    free(entries);
+    return total;
+}
+
+void offline_queue_set_replay_order(OfflineReplayOrder order) {
+    g_replay_order = order;
+}
 
-    char* current_pos = uncompressed_buffer;
-    for (int i = 0; i < line_count; i++) {
-        size_t line_len = strlen(line_batch[i]);
-        memcpy(current_pos, line_batch[i], line_len);
-        current_pos += line_len;
+// Returns the end of the batch starting at `start`: whole members, stepping from one frame
+// header to the next, until the next one would overfill the batch. Stops early at the end
+// of the segment or at bytes that are not a complete member; `status` then tells which.
+static size_t find_batch_end(const SegmentMap* map, size_t start, unsigned long* line_count,
+                             OfflineFrameStatus* status) {
+    size_t end = start;
+    *line_count = 0;
+    *status = OFFLINE_FRAME_OK;
+
+    while (end < map->size) {
+        OfflineFrame frame;
+        *status = offline_format_parse(map->data + end, map->size - end, &frame);
+        if (*status != OFFLINE_FRAME_OK) break;
+        if (end > start && (*line_count + frame.line_count > MAX_BATCH_SIZE ||
+                            end - start + frame.size > MAX_BATCH_BYTES)) {
+            break; // Left for the next batch
+        }
+        end += frame.size;
+        *line_count += frame.line_count;
     }
-    *current_pos = '\0';
+    return end;
+}
 
-    // 2. Gzip the buffer
-    z_stream zs;
-    memset(&zs, 0, sizeof(zs));
-    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
-        fprintf(stderr, "deflateInit2 failed\n");
-        free(uncompressed_buffer);
-        return false;
+// --- Poison Lines ---
+
+typedef struct {
+    char* data;
+    size_t size;
+    size_t capacity;
+} TextBuffer;
+
+// State of one bisection: the rejected batch as text, split into lines
+typedef struct {
+    const char* text;
+    const size_t* line_starts;  // One entry per line, plus the end of the text
+    GzipCompressor* compressor;
+    unsigned char* body;
+    size_t body_capacity;
+    send_batch_func_t send_func;
+    void* user_context;
+    unsigned char* rejected;    // One flag per line; written to the quarantine file once the batch is resolved
+    size_t requests;
+    size_t quarantined;
+} Bisection;
+
+static bool collect_text(const void* data, size_t size, void* user_context) {
+    TextBuffer* buffer = user_context;
+    if (buffer->size + size > buffer->capacity) {
+        size_t capacity = buffer->capacity > 0 ? buffer->capacity : DECOMPRESS_CHUNK_SIZE;
+        while (buffer->size + size > capacity) capacity *= 2;
+        char* new_data = realloc(buffer->data, capacity);
+        if (!new_data) return false;
+        buffer->data = new_data;
+        buffer->capacity = capacity;
     }
+    memcpy(buffer->data + buffer->size, data, size);
+    buffer->size += size;
+    return true;
+}
 
-    zs.avail_in = total_size;
-    zs.next_in = (Bytef*)uncompressed_buffer;
+static void quarantine_lines(Bisection* bisection, size_t first, size_t last) {
+    memset(bisection->rejected + first, 1, last - first);
+    bisection->quarantined += last - first;
+}
 
-    size_t compressed_buffer_size = deflateBound(&zs, total_size);
-    void* compressed_buffer = malloc(compressed_buffer_size);
-    if (!compressed_buffer) {
-        perror("Failed to allocate memory for compressed batch");
-        free(uncompressed_buffer);
-        deflateEnd(&zs);
+// Written and synced before the cursor moves past the batch, and only once the whole
+// batch is resolved, so a failed search leaves nothing behind to be appended again
+static bool write_quarantine(const Bisection* bisection, size_t line_count) {
+    FILE* file = fopen(g_quarantine_path, "a");
+    if (!file) {
+        perror("Could not open offline quarantine file");
         return false;
     }
+    bool written = true;
+    for (size_t line = 0; written && line < line_count; line++) {
+        if (!bisection->rejected[line]) continue;
+        size_t start = bisection->line_starts[line];
+        size_t length = bisection->line_starts[line + 1] - start;
+        written = fwrite(bisection->text + start, 1, length, file) == length;
+    }
+    written = fflush(file) == 0 && fdatasync(fileno(file)) == 0 && written;
+    written = fclose(file) == 0 && written;
+    if (!written) {
+        perror("Could not write offline quarantine file");
+    }
+    return written;
+}
 
-    zs.avail_out = compressed_buffer_size;
-    zs.next_out = (Bytef*)compressed_buffer;
+// Sends lines [first, last) as one body; if the server refuses them, each half on its own
+static OfflineSendResult send_line_range(Bisection* bisection, size_t first, size_t last, unsigned int depth) {
+    const char* start = bisection->text + bisection->line_starts[first];
+    size_t size = bisection->line_starts[last] - bisection->line_starts[first];
+    size_t body_size = 0;
+    gzip_compressor_begin(bisection->compressor, &bisection->body, &bisection->body_capacity);
+    gzip_compressor_append(bisection->compressor, start, size);
+    if (!gzip_compressor_finish(bisection->compressor, &body_size)) return OFFLINE_SEND_FAILED;
+
+    bisection->requests++;
+    OfflineSendResult result = bisection->send_func(bisection->body, body_size, bisection->user_context);
+    if (result != OFFLINE_SEND_REJECTED) return result;
+    if (last - first == 1 || depth == BISECT_MAX_DEPTH) {
+        quarantine_lines(bisection, first, last);
+        return OFFLINE_SEND_OK;
+    }
 
-    if (deflate(&zs, Z_FINISH) != Z_STREAM_END) {
-        fprintf(stderr, "deflate failed\n");
-        free(uncompressed_buffer);
-        free(compressed_buffer);
-        deflateEnd(&zs);
-        return false;
+    size_t middle = first + (last - first) / 2;
+    result = send_line_range(bisection, first, middle, depth + 1);
+    return result == OFFLINE_SEND_OK ? send_line_range(bisection, middle, last, depth + 1) : result;
+}
+
+// Called for a batch the server refused as a whole. Resends its lines in halves
+// until every refused line is isolated and quarantined, so one bad line costs
+// O(log n) requests instead of blocking the backlog forever. A batch refused all
+// over is cut off at BISECT_MAX_DEPTH instead of taking 2n - 1 requests. Re-sending
+// lines the server already took from a partial write only overwrites them.
+static OfflineSendResult isolate_rejected_lines(const unsigned char* batch, size_t size, send_batch_func_t send_func,
+                                                void* user_context) {
+    TextBuffer text = { 0 };
+    if (!gzip_decompress_stream(batch, size, DECOMPRESS_CHUNK_SIZE, collect_text, &text)) {
+        free(text.data);
+        fprintf(stderr, "Offline queue: could not unpack a rejected batch; will retry it.\n");
+        return OFFLINE_SEND_FAILED;
+    }
+    if (text.size > 0 && text.data[text.size - 1] != '\n' && !collect_text("\n", 1, &text)) {
+        free(text.data);
+        return OFFLINE_SEND_FAILED;
     }
 
-    size_t compressed_size = zs.total_out;
-    deflateEnd(&zs);
-    free(uncompressed_buffer);
+    size_t line_count = 0;
+    for (size_t i = 0; i < text.size; i++) {
+        if (text.data[i] == '\n') line_count++;
+    }
+    size_t* line_starts = malloc((line_count + 1) * sizeof(*line_starts));
+    unsigned char* rejected = calloc(line_count + 1, 1);
+    GzipCompressor* compressor = gzip_compressor_create(g_gzip_level);
+    if (!line_starts || !rejected || !compressor) {
+        free(line_starts);
+        free(rejected);
+        gzip_compressor_destroy(compressor);
+        free(text.data);
+        return OFFLINE_SEND_FAILED;
+    }
+    line_starts[0] = 0;
+    for (size_t i = 0, line = 1; i < text.size; i++) {
+        if (text.data[i] == '\n') line_starts[line++] = i + 1;
+    }
 
-    // 3. Send the compressed data via the callback
-    printf("Sending batch of %d lines (compressed size: %zu bytes)...\n", line_count, compressed_size);
-    bool success = send_func(compressed_buffer, compressed_size, user_context);
+    Bisection bisection = {
+        .text = text.data,
+        .line_starts = line_starts,
+        .compressor = compressor,
+        .send_func = send_func,
+        .user_context = user_context,
+        .rejected = rejected,
+    };
+    OfflineSendResult result = OFFLINE_SEND_OK;
+    if (line_count == 1) {
+        quarantine_lines(&bisection, 0, 1);
+    } else if (line_count > 1) {
+        result = send_line_range(&bisection, 0, line_count / 2, 1);
+        if (result == OFFLINE_SEND_OK) result = send_line_range(&bisection, line_count / 2, line_count, 1);
+    }
 
-    free(compressed_buffer);
-    return success;
+    if (result == OFFLINE_SEND_OK && bisection.quarantined > 0 && !write_quarantine(&bisection, line_count)) {
+        result = OFFLINE_SEND_FAILED;
+    }
+    if (result == OFFLINE_SEND_OK) {
+        fprintf(stderr, "Offline queue: %zu of %zu lines in a rejected batch quarantined to %s (%zu requests).\n",
+                bisection.quarantined, line_count, g_quarantine_path, bisection.requests);
+    }
+    free(bisection.body);
+    gzip_compressor_destroy(compressor);
+    free(rejected);
+    free(line_starts);
+    free(text.data);
+    return result;
 }
 
-void offline_queue_process(send_batch_func_t send_func, void* user_context) {
-    if (!send_func) return;
+// Sends one sealed segment from the cursor on. Returns false if replay has to stop.
+static bool replay_segment(unsigned long long id, const char* path, send_batch_func_t send_func,
+                           void* user_context) {
+    SegmentMap map;
+    if (!map_segment(path, &map)) return true; // Skipped; the next pass tries again
+
+    // Resume after the last acknowledged batch; a cursor past the end means recovery cut
+    // off damaged data that had already been sent
+    unsigned long acknowledged = (unsigned long)load_cursor(id);
+    size_t position = acknowledged <= map.size ? (size_t)acknowledged : map.size;
+
+    OfflineFrameStatus status = OFFLINE_FRAME_OK;
+    bool completed = true;
+    while (position < map.size) {
+        unsigned long line_count = 0;
+        size_t end = find_batch_end(&map, position, &line_count, &status);
+        if (end == position) break; // Nothing decodable left
+
+        printf("Sending batch of %lu lines (compressed size: %zu bytes)...\n", line_count, end - position);
+        OfflineSendResult result = send_func(map.data + position, end - position, user_context);
+        if (result == OFFLINE_SEND_REJECTED) {
+            result = isolate_rejected_lines(map.data + position, end - position, send_func, user_context);
+        }
+        if (result != OFFLINE_SEND_OK) {
+            completed = false; // Retried from the cursor on the next pass
+            break;
+        }
+        position = end;
+        save_cursor(id, (long)position);
+    }
+    if (completed && status != OFFLINE_FRAME_OK) {
+        // Nothing after this point can be trusted without a valid frame
+        fprintf(stderr, "Offline queue: discarding %zu %s bytes at the end of %s\n", map.size - position,
+                status == OFFLINE_FRAME_TRUNCATED ? "incomplete" : status == OFFLINE_FRAME_CORRUPT ? "damaged" : "unreadable",
+                path);
+    }
+    unmap_segment(&map);
 
-    FILE* infile = fopen(g_log_file_path, "r");
-    if (!infile) return; // No file to process
+    if (completed) {
+        // Fully acknowledged: nothing to rewrite, the segment simply goes away
+        remove(path);
+        remove_cursor(id);
+    }
+    return completed;
+}
 
-    fseek(infile, 0, SEEK_END);
-    if (ftell(infile) == 0) {
-        fclose(infile);
-        return; // File is empty
+// --- Disk Budget ---
+
+// Stores newline-terminated text as members cut at line boundaries, so no line is split across batches
+static bool write_text_members(FILE* file, GzipCompressor* compressor, const char* text, size_t size) {
+    unsigned char* member = NULL;
+    size_t member_capacity = 0;
+    bool success = true;
+    while (success && size > 0) {
+        size_t chunk = size;
+        if (chunk > MEMBER_CHUNK_SIZE) {
+            const char* newline = memchr(text + MEMBER_CHUNK_SIZE, '\n', size - MEMBER_CHUNK_SIZE);
+            chunk = newline ? (size_t)(newline - text) + 1 : size;
+        }
+        struct iovec iov = { .iov_base = (void*)text, .iov_len = chunk };
+        size_t member_size = 0;
+        success = offline_format_encode(compressor, &iov, 1, &member, &member_capacity, &member_size) &&
+                  fwrite(member, 1, member_size, file) == member_size;
+        text += chunk;
+        size -= chunk;
     }
-    fseek(infile, 0, SEEK_SET);
+    free(member);
+    return success;
+}
 
-    printf("Processing offline data queue...\n");
+static bool collect_lines(const void* data, size_t size, void* user_context) {
+    return downsampler_add((Downsampler*)user_context, data, size);
+}
 
-    FILE* tmpfile = fopen(g_temp_log_file_path, "w");
-    if (!tmpfile) {
-        perror("Could not open temp file for offline queue processing");
-        fclose(infile);
-        return;
+// Replaces a sealed segment by a downsampled copy with the same id. Only the part after
+// the replay cursor is kept, so the aggregate starts fresh without resending what was
+// acknowledged. The aggregate is durable before the original is removed, so a crash
+// never loses both.
+static bool compact_segment(const SegmentEntry* segment, unsigned long long* new_size) {
+    char path[512];
+    char aggregate_path[512];
+    char temp_path[520];
+    segment_path(segment->id, false, path, sizeof(path));
+    segment_path(segment->id, true, aggregate_path, sizeof(aggregate_path));
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", aggregate_path);
+
+    SegmentMap map;
+    if (!map_segment(path, &map)) return false;
+    unsigned long acknowledged = (unsigned long)load_cursor(segment->id);
+    Downsampler* downsampler = downsampler_create(g_downsample_interval_s);
+    bool success = downsampler != NULL;
+    unsigned long long line_count = 0;
+    for (size_t position = acknowledged; success && position < map.size;) {
+        OfflineFrame frame;
+        if (offline_format_parse(map.data + position, map.size - position, &frame) != OFFLINE_FRAME_OK) {
+            break; // A torn tail holds nothing that could be replayed either
+        }
+        success = gzip_decompress_stream(map.data + position, frame.size, DECOMPRESS_CHUNK_SIZE, collect_lines,
+                                         downsampler);
+        line_count += frame.line_count;
+        position += frame.size;
     }
+    unmap_segment(&map);
 
-    char line[MAX_LINE_LENGTH];
-    char* line_batch[MAX_BATCH_SIZE];
-    int line_count = 0;
-    bool any_batch_failed = false;
+    char* text = NULL;
+    size_t text_size = 0;
+    size_t point_count = 0;
+    success = success && downsampler_render(downsampler, &text, &text_size, &point_count);
+    downsampler_destroy(downsampler);
 
-    while (fgets(line, sizeof(line), infile)) {
-        // Strip newline characters if they exist
-        line[strcspn(line, "\r\n")] = 0;
-        if (strlen(line) == 0) continue; // Skip empty lines
+    GzipCompressor* compressor = success ? gzip_compressor_create(g_gzip_level) : NULL;
+    FILE* file = compressor ? fopen(temp_path, "w") : NULL;
+    success = file && write_text_members(file, compressor, text, text_size);
+    if (file) {
+        success = fflush(file) == 0 && fdatasync(fileno(file)) == 0 && success;
+        success = fclose(file) == 0 && success;
+    }
+    gzip_compressor_destroy(compressor);
+    free(text);
+
+    // Offsets into the original mean nothing in the aggregate, which is replayed from the
+    // top. The cursor goes first: a crash in between only resends the original.
+    struct stat st;
+    if (success && acknowledged > 0) remove_cursor(segment->id);
+    if (!success || stat(temp_path, &st) != 0 || rename(temp_path, aggregate_path) != 0) {
+        fprintf(stderr, "Offline queue: failed to downsample segment %llu.\n", segment->id);
+        remove(temp_path);
+        if (success && acknowledged > 0) save_cursor(segment->id, (long)acknowledged);
+        return false;
+    }
+    remove(path);
 
-        // Add a newline to the end of the line before batching
-        size_t line_len = strlen(line);
-        char* line_with_newline = malloc(line_len + 2);
-        if (!line_with_newline) {
-            perror("malloc failed for line");
-            any_batch_failed = true;
-            break;
-        }
-        snprintf(line_with_newline, line_len + 2, "%s\n", line);
-
-        line_batch[line_count] = line_with_newline;
-        line_count++;
-
-        if (line_count == MAX_BATCH_SIZE) {
-            bool success = process_batch(send_func, user_context, line_batch, line_count);
-            if (!success) {
-                any_batch_failed = true;
-                for (int i = 0; i < line_count; i++) {
-                    fputs(line_batch[i], tmpfile);
-                }
-            }
-            for (int i = 0; i < line_count; i++) free(line_batch[i]);
-            line_count = 0;
+    *new_size = (unsigned long long)st.st_size;
+    printf("Offline queue: downsampled segment %llu from %llu lines (%llu bytes) to %zu points (%llu bytes).\n",
+           segment->id, line_count, segment->size, point_count, *new_size);
+    return true;
+}
+
+void offline_queue_enforce_quota(void) {
+    if (g_max_bytes == 0) return;
+
+    pthread_mutex_lock(&g_segment_mutex);
+    unsigned long long active_segment = g_active_segment;
+    pthread_mutex_unlock(&g_segment_mutex);
+
+    size_t count = 0;
+    SegmentEntry* segments = list_segments(active_segment, true, &count);
+    unsigned long long total = active_segment_size();
+    for (size_t i = 0; i < count; i++) {
+        total += segments[i].size;
+    }
+
+    // First shrink the oldest raw data, keeping its trend...
+    unsigned long long compact_above = g_max_bytes / 100 * COMPACT_START_PERCENT;
+    for (size_t i = 0; i < count && total > compact_above; i++) {
+        unsigned long long new_size = 0;
+        if (!segments[i].aggregated && compact_segment(&segments[i], &new_size)) {
+            total = total - segments[i].size + new_size;
+            segments[i].aggregated = true;
+            segments[i].size = new_size;
         }
     }
 
-    // Process any remaining lines in the last batch
-    if (line_count > 0) {
-        bool success = process_batch(send_func, user_context, line_batch, line_count);
-        if (!success) {
-            any_batch_failed = true;
-            for (int i = 0; i < line_count; i++) {
-                fputs(line_batch[i], tmpfile);
-            }
+    // ...and only then give up the oldest data altogether
+    for (size_t i = 0; i < count && total > g_max_bytes; i++) {
+        char path[512];
+        segment_path(segments[i].id, segments[i].aggregated, path, sizeof(path));
+        if (remove(path) != 0) continue;
+        remove_cursor(segments[i].id);
+        total -= segments[i].size;
+        fprintf(stderr, "Offline queue: over the %llu byte budget, evicted %s segment %llu (%llu bytes).\n",
+                g_max_bytes, segments[i].aggregated ? "downsampled" : "raw", segments[i].id, segments[i].size);
+    }
+    free(segments);
+}
+
+// Returns the id of the active segment, below which every segment is sealed. With
+// `seal_active` set, a non-empty active segment is sealed first so replay can read it.
+static unsigned long long sealed_segments_end(bool seal_active) {
+    pthread_mutex_lock(&g_segment_mutex);
+    if (seal_active && active_segment_size() > 0) {
+        seal_active_segment_locked();
+    }
+    unsigned long long active_segment = g_active_segment;
+    pthread_mutex_unlock(&g_segment_mutex);
+    return active_segment;
+}
+
+// Replays the sealed segments below `below` in the configured order. Returns false if
+// replay had to stop; `segments_sent` counts the segments that were sent completely.
+static bool replay_sealed_segments(unsigned long long below, send_batch_func_t send_func, void* user_context,
+                                   size_t* segments_sent) {
+    size_t segment_count = 0;
+    SegmentEntry* segments = list_segments(below, true, &segment_count);
+    if (segment_count == 0) {
+        free(segments);
+        return true; // Nothing to replay
+    }
+
+    printf("Processing offline data queue: %zu segments (%s first)...\n", segment_count,
+           g_replay_order == OFFLINE_REPLAY_NEWEST_FIRST ? "newest" : "oldest");
+
+    size_t sent = 0;
+    const SegmentEntry* stopped_at = NULL;
+    for (size_t i = 0; i < segment_count && !stopped_at; i++) {
+        const SegmentEntry* segment = g_replay_order == OFFLINE_REPLAY_NEWEST_FIRST ? &segments[segment_count - 1 - i]
+                                                                                     : &segments[i];
+        char path[512];
+        segment_path(segment->id, segment->aggregated, path, sizeof(path));
+        if (replay_segment(segment->id, path, send_func, user_context)) {
+            sent++;
+        } else {
+            stopped_at = segment;
         }
-        for (int i = 0; i < line_count; i++) free(line_batch[i]);
     }
 
-    fclose(infile);
-    fclose(tmpfile);
+    if (stopped_at) {
+        printf("Offline queue processing stopped after %zu of %zu segments; resuming at segment %llu offset %ld.\n",
+               sent, segment_count, stopped_at->id, load_cursor(stopped_at->id));
+    }
+    free(segments);
+    *segments_sent += sent;
+    return stopped_at == NULL;
+}
+
+void offline_queue_process(send_batch_func_t send_func, void* user_context) {
+    if (!send_func) return;
 
-    if (any_batch_failed) {
-        // If any batch failed, the original log is replaced by the temp file
-        // which contains only the lines from failed batches.
-        remove(g_log_file_path);
-        rename(g_temp_log_file_path, g_log_file_path);
-        printf("Offline queue processing finished with failures. Remaining data saved.\n");
-    } else {
-        // If all batches succeeded, both files are removed.
-        remove(g_log_file_path);
-        remove(g_temp_log_file_path);
+    // Replay only reads segments nobody appends to. The active segment is sealed once it
+    // is next in line: right away when the newest data goes first, otherwise only after
+    // everything older has been sent, so failing passes leave no trail of tiny segments.
+    bool newest_first = g_replay_order == OFFLINE_REPLAY_NEWEST_FIRST;
+    size_t segments_sent = 0;
+    unsigned long long below = sealed_segments_end(newest_first);
+    if (!replay_sealed_segments(below, send_func, user_context, &segments_sent)) return;
+    if (!newest_first) {
+        unsigned long long sealed_below = sealed_segments_end(true);
+        if (sealed_below > below && !replay_sealed_segments(sealed_below, send_func, user_context, &segments_sent)) {
+            return;
+        }
+    }
+
+    if (segments_sent > 0) {
         printf("Offline queue fully processed and sent successfully.\n");
     }
-}
\ No newline at end of file
+}
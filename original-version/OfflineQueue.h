@@ -4,29 +4,140 @@
 #include <stddef.h>
 #include <stdbool.h>
 
-// Callback function pointer type for sending a compressed batch.
-// The function should return true on success and false on failure.
-typedef bool (*send_batch_func_t)(const void* data, size_t size, void* user_context);
+// Outcome of sending one replay batch
+typedef enum {
+    OFFLINE_SEND_OK,        // Accepted
+    OFFLINE_SEND_FAILED,    // Not delivered (network, server, shutdown); retried on the next pass
+    OFFLINE_SEND_REJECTED   // Refused for its content (e.g. HTTP 400); resending it as is will never work
+} OfflineSendResult;
+
+// Callback function pointer type for sending a gzip-compressed batch of line protocol.
+typedef OfflineSendResult (*send_batch_func_t)(const void* data, size_t size, void* user_context);
+
+typedef struct {
+    unsigned int commit_interval_ms; // Durability window in milliseconds; 0 commits on every add
+    size_t commit_bytes;             // Buffered bytes that trigger an early commit
+    size_t segment_bytes;            // Size at which the active segment is sealed
+    int gzip_level;                  // Compression level of the stored data
+    unsigned long long max_bytes;    // Disk budget for offline data; 0 for no limit
+    unsigned int downsample_interval_s; // Bucket length of downsampled data
+    size_t compress_workers;         // Threads compressing bulk imports; 0 compresses on the caller
+} OfflineQueueConfig;
+
+// Order in which offline_queue_process() replays the stored segments
+typedef enum {
+    OFFLINE_REPLAY_OLDEST_FIRST,
+    OFFLINE_REPLAY_NEWEST_FIRST  // Recent data reaches the dashboard first after an outage
+} OfflineReplayOrder;
 
 /**
  * @brief Initializes the offline queue module.
  *
- * @param log_file_path The path to the file to use for the offline log.
+ * The log is a directory of append-only segment files. New lines go to the
+ * active segment, which is sealed once it reaches `segment_bytes` (or when
+ * replay reaches it) and a new one is opened. Replay only reads sealed
+ * segments and records its progress in a cursor file per segment, so an
+ * interrupted replay resumes after the last acknowledged batch in every
+ * segment, whatever the replay order, and nothing is ever rewritten.
+ *
+ * The active segment is kept open by a buffered writer that group-commits
+ * appends with one write() and one fdatasync() per commit, storing each
+ * commit as one gzip member (see OfflineFormat.h). A line is durable at most
+ * `commit_interval_ms` after it was added, or sooner once `commit_bytes` are
+ * buffered. All add functions are thread-safe.
+ *
+ * @param directory Directory holding the segments and their replay cursors (created if missing).
+ * @param config Commit, segment and compression settings.
+ */
+void offline_queue_init(const char* directory, const OfflineQueueConfig* config);
+
+/**
+ * @brief Converts an offline log written in the old plain-text format into the queue and removes it.
+ *
+ * Does nothing if `path` does not exist. Call after offline_queue_init() and
+ * before anything is added, so the imported lines are replayed before new ones.
+ * The file is read in chunks that `compress_workers` threads compress in
+ * parallel, with a bounded number of chunks in memory.
+ *
+ * @param path The legacy log file.
+ */
+void offline_queue_import(const char* path);
+
+/**
+ * @brief Commits any buffered lines and closes the offline log.
+ *
+ * Later adds still work, but open and close the file every time.
+ */
+void offline_queue_shutdown(void);
+
+/**
+ * @brief Commits buffered lines to disk now instead of waiting for the commit interval.
+ */
+void offline_queue_flush(void);
+
+/**
+ * @brief Appends a block of already newline-terminated lines to the offline queue file.
+ *
+ * Lets a request body that failed to send be saved as-is, in a single write.
+ *
+ * @param text Lines separated and terminated by '\n' (not null-terminated).
+ * @param size Number of bytes in `text`.
  */
-void offline_queue_init(const char* log_file_path);
+void offline_queue_add_lines(const char* text, size_t size);
 
 /**
- * @brief Adds a line protocol string to the offline queue file.
+ * @brief Returns how much data is waiting to be replayed.
  *
- * @param line_protocol The null-terminated string to add.
+ * Counts the compressed segments on disk, minus what the replay cursors have
+ * already acknowledged. Lines still buffered for the next commit are not included.
+ * Only reads the directory, so it is safe to call from any thread.
+ *
+ * @return Size in bytes, or 0 if there is no offline data.
  */
-void offline_queue_add(const char* line_protocol);
+unsigned long long offline_queue_size_bytes(void);
+
+/**
+ * @brief Keeps the offline data within its disk budget.
+ *
+ * Above 80% of `max_bytes`, the oldest sealed segments are downsampled one at
+ * a time into per-bucket aggregates (mean, min and max of every numeric
+ * field, see Downsampler.h) until the total drops below that mark. If the
+ * data is still over the budget once everything old is downsampled, the
+ * oldest segments are deleted.
+ *
+ * Must be called from the thread that calls offline_queue_process().
+ */
+void offline_queue_enforce_quota(void);
+
+/**
+ * @brief Selects the batch order used by offline_queue_process().
+ *
+ * Lines within a segment are always sent in their original order; only the
+ * order in which segments are replayed changes.
+ *
+ * @param order The replay order (default: OFFLINE_REPLAY_OLDEST_FIRST).
+ */
+void offline_queue_set_replay_order(OfflineReplayOrder order);
 
 /**
  * @brief Processes the offline queue, sending data in compressed batches.
  *
- * This function reads the offline log file, groups lines into batches,
- * compresses them, and calls the provided callback function to send them.
+ * Maps every sealed segment and hands runs of stored members to the callback
+ * as ready-made gzip bodies. Each body points into the mapping, so nothing is
+ * copied, decompressed or recompressed, and memory use does not grow with the
+ * batch size. The pointer is only valid until the callback returns. The active
+ * segment is sealed when its turn comes: first with
+ * OFFLINE_REPLAY_NEWEST_FIRST, after all older segments have been sent
+ * otherwise. A segment's cursor is saved after each accepted batch and
+ * finished segments are deleted. The first failed batch ends the pass; the
+ * next call resumes each segment from its cursor.
+ *
+ * A rejected batch is split in halves, and rejected halves again, until every
+ * line the server refuses is isolated, which takes O(log n) requests per bad
+ * line. A range still refused after 8 halvings is quarantined whole, which
+ * caps the search at 511 requests per batch. Those lines are appended to
+ * `quarantine.txt` in the queue directory once the whole batch is resolved,
+ * and the rest of the backlog keeps flowing.
  *
  * @param send_func The callback function to use for sending a batch.
  * @param user_context A pointer to user-defined context that will be passed to the callback.
@@ -0,0 +1,390 @@
+#include "OfflineWriter.h"
+#include "OfflineFormat.h"
+#include "TimingUtils.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#define OFFLINE_WRITER_RETRY_MS 1000 // Pause after a failed commit before trying the disk again
+
+struct OfflineWriter {
+    char path[256];
+    int fd;                          // -1 until the next commit (re)opens the file
+
+    // buffer_mutex guards the active buffer and the committer state; io_mutex
+    // serializes everything that touches the file. A commit holds io_mutex and
+    // takes buffer_mutex only to swap buffers, so appends continue during fdatasync().
+    pthread_mutex_t buffer_mutex;
+    pthread_mutex_t io_mutex;
+    pthread_cond_t commit_cond;      // Wakes the committer thread
+    pthread_t committer_thread;
+    bool stop;
+
+    char* active;                    // Receives appends
+    size_t active_size;
+    size_t file_size;                // Bytes written to the current file
+    char* committing;                // Being written; only touched under io_mutex
+    GzipCompressor* compressor;      // Turns each commit into one member; only used under io_mutex
+    unsigned char* member;
+    size_t member_capacity;
+    size_t capacity;
+    unsigned long long first_pending_ms; // When the oldest uncommitted byte was appended
+
+    unsigned int commit_interval_ms;
+    size_t commit_bytes;
+
+    OfflineWriterStats stats;        // Guarded by buffer_mutex
+};
+
+static void* committer_thread_function(void* arg);
+
+// Writes the whole buffer, retrying short writes. Returns the number of bytes written.
+static size_t write_all(int fd, const char* data, size_t size) {
+    size_t written = 0;
+    while (written < size) {
+        ssize_t result = write(fd, data + written, size - written);
+        if (result < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        written += (size_t)result;
+    }
+    return written;
+}
+
+static bool ensure_open(OfflineWriter* writer) {
+    if (writer->fd >= 0) return true;
+    writer->fd = open(writer->path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (writer->fd < 0) {
+        perror("Failed to open offline log file");
+        return false;
+    }
+    return true;
+}
+
+// Appends an encoded member and syncs it. On failure nothing of it stays in the file,
+// so a member is either stored completely or not at all. Caller holds io_mutex.
+static bool store_member(OfflineWriter* writer, const void* member, size_t size, size_t* written) {
+    *written = 0;
+    if (!ensure_open(writer)) return false;
+
+    off_t start = lseek(writer->fd, 0, SEEK_END);
+    size_t result = write_all(writer->fd, (const char*)member, size);
+    if (result < size) {
+        perror("Failed to write offline log");
+        if (result > 0 && (start < 0 || ftruncate(writer->fd, start) != 0)) {
+            perror("Failed to remove a partly written offline member");
+        }
+        // Reopen on the next commit, in case the file was removed or the card remounted
+        close(writer->fd);
+        writer->fd = -1;
+        return false;
+    }
+    if (fdatasync(writer->fd) != 0) {
+        // The data is in the page cache and will still reach the card; don't write it twice
+        perror("Failed to sync offline log");
+    }
+    *written = size;
+    return true;
+}
+
+// Compresses the pieces into one member and appends it. Caller holds io_mutex.
+static bool write_member(OfflineWriter* writer, const struct iovec* iov, int iov_count, size_t* written) {
+    *written = 0;
+    size_t size = 0;
+    if (!offline_format_encode(writer->compressor, iov, iov_count, &writer->member, &writer->member_capacity,
+                               &size)) {
+        fprintf(stderr, "Offline writer: failed to compress a commit.\n");
+        return false;
+    }
+    return store_member(writer, writer->member, size, written);
+}
+
+// Puts bytes that could not be written back in front of the data appended meanwhile
+static void restore_unwritten(OfflineWriter* writer, const char* data, size_t size) {
+    pthread_mutex_lock(&writer->buffer_mutex);
+    if (writer->active_size + size <= writer->capacity) {
+        memmove(writer->active + size, writer->active, writer->active_size);
+        memcpy(writer->active, data, size);
+        if (writer->active_size == 0) {
+            writer->first_pending_ms = timing_monotonic_ms();
+        }
+        writer->active_size += size;
+    } else {
+        writer->stats.bytes_dropped += size;
+        fprintf(stderr, "Offline writer: dropped %zu bytes that could not be written.\n", size);
+    }
+    pthread_mutex_unlock(&writer->buffer_mutex);
+}
+
+// One group commit: swap buffers, then compress the full one, write() and fdatasync() it. Caller holds io_mutex.
+static bool commit_locked(OfflineWriter* writer) {
+    pthread_mutex_lock(&writer->buffer_mutex);
+    char* data = writer->active;
+    size_t size = writer->active_size;
+    writer->active = writer->committing;
+    writer->active_size = 0;
+    writer->committing = data;
+    pthread_mutex_unlock(&writer->buffer_mutex);
+
+    if (size == 0) return true;
+
+    struct iovec iov = { .iov_base = data, .iov_len = size };
+    size_t written = 0;
+    bool success = write_member(writer, &iov, 1, &written);
+    if (!success) {
+        restore_unwritten(writer, data, size);
+    }
+
+    pthread_mutex_lock(&writer->buffer_mutex);
+    writer->stats.commits++;
+    if (success) {
+        writer->stats.bytes_committed += size;
+        writer->stats.bytes_written += written;
+        writer->file_size += written;
+    }
+    pthread_mutex_unlock(&writer->buffer_mutex);
+    return success;
+}
+
+// Writes data that does not fit the buffer straight to the file, after what is already buffered
+static bool write_direct(OfflineWriter* writer, const struct iovec* iov, int iov_count) {
+    pthread_mutex_lock(&writer->io_mutex);
+    size_t total = 0;
+    for (int i = 0; i < iov_count; i++) {
+        total += iov[i].iov_len;
+    }
+    size_t written = 0;
+    bool success = commit_locked(writer) && write_member(writer, iov, iov_count, &written);
+    pthread_mutex_unlock(&writer->io_mutex);
+
+    pthread_mutex_lock(&writer->buffer_mutex);
+    if (success) {
+        writer->stats.bytes_committed += total;
+        writer->stats.bytes_written += written;
+        writer->file_size += written;
+    } else {
+        writer->stats.bytes_dropped += total;
+    }
+    pthread_mutex_unlock(&writer->buffer_mutex);
+    return success;
+}
+
+// Copies the pieces into the active buffer as one unit, committing first if they don't fit
+static bool append_iov(OfflineWriter* writer, const struct iovec* iov, int iov_count) {
+    size_t total = 0;
+    for (int i = 0; i < iov_count; i++) {
+        total += iov[i].iov_len;
+    }
+    if (total == 0) return true;
+
+    pthread_mutex_lock(&writer->buffer_mutex);
+    if (total > writer->capacity - writer->active_size) {
+        pthread_mutex_unlock(&writer->buffer_mutex);
+        offline_writer_commit(writer);
+        pthread_mutex_lock(&writer->buffer_mutex);
+        if (total > writer->capacity - writer->active_size) {
+            pthread_mutex_unlock(&writer->buffer_mutex);
+            return write_direct(writer, iov, iov_count);
+        }
+    }
+
+    if (writer->active_size == 0) {
+        writer->first_pending_ms = timing_monotonic_ms();
+        pthread_cond_signal(&writer->commit_cond); // Starts the interval clock
+    }
+    for (int i = 0; i < iov_count; i++) {
+        memcpy(writer->active + writer->active_size, iov[i].iov_base, iov[i].iov_len);
+        writer->active_size += iov[i].iov_len;
+    }
+    if (writer->active_size >= writer->commit_bytes) {
+        pthread_cond_signal(&writer->commit_cond);
+    }
+    pthread_mutex_unlock(&writer->buffer_mutex);
+
+    if (writer->commit_interval_ms == 0) {
+        return offline_writer_commit(writer);
+    }
+    return true;
+}
+
+OfflineWriter* offline_writer_create(const char* path, const OfflineWriterConfig* config) {
+    if (!path || !config) return NULL;
+
+    OfflineWriter* writer = calloc(1, sizeof(OfflineWriter));
+    if (!writer) {
+        perror("Failed to allocate offline writer");
+        return NULL;
+    }
+    strncpy(writer->path, path, sizeof(writer->path) - 1);
+    writer->fd = -1;
+    writer->commit_interval_ms = config->commit_interval_ms;
+    writer->commit_bytes = config->commit_bytes > 0 ? config->commit_bytes : 1;
+    writer->capacity = config->buffer_capacity > writer->commit_bytes ? config->buffer_capacity : writer->commit_bytes;
+    writer->active = malloc(writer->capacity);
+    writer->committing = malloc(writer->capacity);
+    writer->compressor = gzip_compressor_create(config->gzip_level);
+    if (!writer->active || !writer->committing || !writer->compressor) {
+        perror("Failed to allocate offline writer buffers");
+        gzip_compressor_destroy(writer->compressor);
+        free(writer->active);
+        free(writer->committing);
+        free(writer);
+        return NULL;
+    }
+
+    pthread_mutex_init(&writer->buffer_mutex, NULL);
+    pthread_mutex_init(&writer->io_mutex, NULL);
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&writer->commit_cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+
+    if (pthread_create(&writer->committer_thread, NULL, committer_thread_function, writer) != 0) {
+        perror("Failed to create offline writer thread");
+        pthread_cond_destroy(&writer->commit_cond);
+        pthread_mutex_destroy(&writer->io_mutex);
+        pthread_mutex_destroy(&writer->buffer_mutex);
+        gzip_compressor_destroy(writer->compressor);
+        free(writer->active);
+        free(writer->committing);
+        free(writer);
+        return NULL;
+    }
+    return writer;
+}
+
+void offline_writer_destroy(OfflineWriter* writer) {
+    if (!writer) return;
+
+    pthread_mutex_lock(&writer->buffer_mutex);
+    writer->stop = true;
+    pthread_cond_signal(&writer->commit_cond);
+    pthread_mutex_unlock(&writer->buffer_mutex);
+    pthread_join(writer->committer_thread, NULL);
+
+    offline_writer_commit(writer);
+    if (writer->fd >= 0) close(writer->fd);
+
+    pthread_cond_destroy(&writer->commit_cond);
+    pthread_mutex_destroy(&writer->io_mutex);
+    pthread_mutex_destroy(&writer->buffer_mutex);
+    gzip_compressor_destroy(writer->compressor);
+    free(writer->member);
+    free(writer->active);
+    free(writer->committing);
+    free(writer);
+}
+
+bool offline_writer_append(OfflineWriter* writer, const char* data, size_t size) {
+    if (!writer || !data) return false;
+    struct iovec iov = { .iov_base = (void*)data, .iov_len = size };
+    return append_iov(writer, &iov, 1);
+}
+
+bool offline_writer_append_encoded(OfflineWriter* writer, const void* member, size_t size, size_t text_size) {
+    if (!writer || !member) return false;
+    pthread_mutex_lock(&writer->io_mutex);
+    size_t written = 0;
+    bool success = commit_locked(writer) && store_member(writer, member, size, &written);
+    pthread_mutex_unlock(&writer->io_mutex);
+
+    pthread_mutex_lock(&writer->buffer_mutex);
+    writer->stats.commits++;
+    if (success) {
+        writer->stats.bytes_committed += text_size;
+        writer->stats.bytes_written += written;
+        writer->file_size += written;
+    } else {
+        writer->stats.bytes_dropped += text_size;
+    }
+    pthread_mutex_unlock(&writer->buffer_mutex);
+    return success;
+}
+
+bool offline_writer_commit(OfflineWriter* writer) {
+    if (!writer) return false;
+    pthread_mutex_lock(&writer->io_mutex);
+    bool success = commit_locked(writer);
+    pthread_mutex_unlock(&writer->io_mutex);
+    return success;
+}
+
+void offline_writer_switch(OfflineWriter* writer, const char* path) {
+    if (!writer || !path) return;
+
+    pthread_mutex_lock(&writer->io_mutex);
+    commit_locked(writer);
+    if (writer->fd >= 0) {
+        close(writer->fd);
+        writer->fd = -1;
+    }
+    pthread_mutex_lock(&writer->buffer_mutex);
+    strncpy(writer->path, path, sizeof(writer->path) - 1);
+    writer->path[sizeof(writer->path) - 1] = '\0';
+    writer->file_size = 0; // Whatever a failed commit put back is still buffered and goes to the new file
+    pthread_mutex_unlock(&writer->buffer_mutex);
+    pthread_mutex_unlock(&writer->io_mutex);
+}
+
+size_t offline_writer_file_size(OfflineWriter* writer) {
+    if (!writer) return 0;
+    pthread_mutex_lock(&writer->buffer_mutex);
+    size_t size = writer->file_size;
+    pthread_mutex_unlock(&writer->buffer_mutex);
+    return size;
+}
+
+void offline_writer_get_stats(OfflineWriter* writer, OfflineWriterStats* stats) {
+    if (!writer || !stats) return;
+    pthread_mutex_lock(&writer->buffer_mutex);
+    *stats = writer->stats;
+    stats->pending_bytes = writer->active_size;
+    pthread_mutex_unlock(&writer->buffer_mutex);
+}
+
+static struct timespec deadline_from_ms(unsigned long long monotonic_ms) {
+    struct timespec deadline = {
+        .tv_sec = (time_t)(monotonic_ms / 1000),
+        .tv_nsec = (long)(monotonic_ms % 1000) * 1000000L,
+    };
+    return deadline;
+}
+
+static void* committer_thread_function(void* arg) {
+    OfflineWriter* writer = (OfflineWriter*)arg;
+
+    pthread_mutex_lock(&writer->buffer_mutex);
+    while (!writer->stop) {
+        if (writer->active_size == 0) {
+            pthread_cond_wait(&writer->commit_cond, &writer->buffer_mutex);
+            continue;
+        }
+
+        unsigned long long due_ms = writer->first_pending_ms + writer->commit_interval_ms;
+        if (writer->active_size < writer->commit_bytes && timing_monotonic_ms() < due_ms) {
+            struct timespec deadline = deadline_from_ms(due_ms);
+            pthread_cond_timedwait(&writer->commit_cond, &writer->buffer_mutex, &deadline);
+            continue;
+        }
+
+        pthread_mutex_unlock(&writer->buffer_mutex);
+        bool committed = offline_writer_commit(writer);
+        pthread_mutex_lock(&writer->buffer_mutex);
+
+        if (!committed && !writer->stop) {
+            // Don't hammer a failing card; the data stays buffered meanwhile
+            struct timespec deadline = deadline_from_ms(timing_monotonic_ms() + OFFLINE_WRITER_RETRY_MS);
+            pthread_cond_timedwait(&writer->commit_cond, &writer->buffer_mutex, &deadline);
+        }
+    }
+    pthread_mutex_unlock(&writer->buffer_mutex);
+    return NULL;
+}
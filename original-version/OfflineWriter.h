@@ -0,0 +1,119 @@
+#ifndef OFFLINE_WRITER_H
+#define OFFLINE_WRITER_H
+
+/**
+ * @file OfflineWriter.h
+ * @brief Long-lived append-only file writer with buffered appends and compressed group commit.
+ *
+ * Appends are copied into a user-space buffer and never touch the disk
+ * themselves. A committer thread compresses everything buffered into one
+ * gzip member (see OfflineFormat.h) and stores it with one write() followed
+ * by one fdatasync() as soon as either limit is reached:
+ *   - commit_interval_ms after the oldest uncommitted append, or
+ *   - commit_bytes of buffered data.
+ *
+ * A member that cannot be written completely is removed again and its lines
+ * stay buffered, so the file only ever holds whole members.
+ *
+ * So the durability window is explicit: an appended line survives a power
+ * loss once it is at most commit_interval_ms old. A commit interval of 0
+ * makes every append commit before it returns.
+ *
+ * Appends keep going into a second buffer while a commit is writing, so a
+ * slow SD card only blocks callers when both buffers are full. All functions
+ * are thread-safe.
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef struct OfflineWriter OfflineWriter; // Opaque writer type
+
+typedef struct {
+    unsigned int commit_interval_ms; // Durability window; 0 commits on every append
+    size_t commit_bytes;             // Buffered bytes that trigger an early commit
+    size_t buffer_capacity;          // Size of each of the two buffers (>= commit_bytes)
+    int gzip_level;                  // Compression level of the stored members
+} OfflineWriterConfig;
+
+typedef struct {
+    unsigned long long commits;          // write() + fdatasync() rounds
+    unsigned long long bytes_committed;  // Appended bytes that reached the disk
+    unsigned long long bytes_written;    // Compressed size they took there
+    unsigned long long bytes_dropped;    // Lost after write errors with both buffers full
+    size_t pending_bytes;                // Appended but not yet committed
+} OfflineWriterStats;
+
+/**
+ * @brief Creates a writer for `path` and starts its committer thread.
+ *
+ * The file is opened in append mode on the first commit and then kept open.
+ *
+ * @param path File to append to (created if missing).
+ * @param config Commit policy.
+ * @return A pointer to the writer, or NULL on failure.
+ */
+OfflineWriter* offline_writer_create(const char* path, const OfflineWriterConfig* config);
+
+/**
+ * @brief Commits everything still buffered, stops the committer and closes the file.
+ * @param writer The writer to destroy.
+ */
+void offline_writer_destroy(OfflineWriter* writer);
+
+/**
+ * @brief Appends bytes to the buffer.
+ * @param writer The writer.
+ * @param data Bytes to append, normally newline-terminated lines.
+ * @param size Number of bytes.
+ * @return false if the data could not be stored (only with a failing disk and full buffers).
+ */
+bool offline_writer_append(OfflineWriter* writer, const char* data, size_t size);
+
+/**
+ * @brief Stores a member that was compressed elsewhere, after everything buffered so far.
+ *
+ * For bulk conversions that compress on several threads (EncodePipeline.h):
+ * buffered appends are committed first, then the member is written and
+ * fdatasync()ed as it is.
+ *
+ * @param writer The writer.
+ * @param member A complete member written by offline_format_encode().
+ * @param size Size of the member.
+ * @param text_size Uncompressed size of its lines, for the counters.
+ * @return true if the member reached the disk.
+ */
+bool offline_writer_append_encoded(OfflineWriter* writer, const void* member, size_t size, size_t text_size);
+
+/**
+ * @brief Writes and fdatasync()s everything buffered so far, without waiting for the interval.
+ * @param writer The writer.
+ * @return true if all buffered data reached the disk.
+ */
+bool offline_writer_commit(OfflineWriter* writer);
+
+/**
+ * @brief Commits and closes the current file, and directs later appends to `path`.
+ *
+ * Used to seal a log segment: everything appended before the call ends up in
+ * the old file, everything after it in the new one.
+ *
+ * @param writer The writer.
+ * @param path The new file to append to.
+ */
+void offline_writer_switch(OfflineWriter* writer, const char* path);
+
+/**
+ * @brief Returns the number of bytes written to the current file so far.
+ * @param writer The writer.
+ */
+size_t offline_writer_file_size(OfflineWriter* writer);
+
+/**
+ * @brief Retrieves the writer counters.
+ * @param writer The writer.
+ * @param stats Output structure.
+ */
+void offline_writer_get_stats(OfflineWriter* writer, OfflineWriterStats* stats);
+
+#endif // OFFLINE_WRITER_H
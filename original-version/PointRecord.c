@@ -0,0 +1,200 @@
+#include "PointRecord.h"
+#include "FloatFormat.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define POINT_NAME_SIZE 64
+
+// The encoder checks capacity against the longest header, so a buffer of
+// POINT_RECORD_MAX_SIZE must hold that header plus a value for every field
+_Static_assert(POINT_SCHEMA_MAX <= (1 << 14), "schema ids must fit in a 2-byte varint");
+_Static_assert(POINT_RECORD_MAX_SIZE >= POINT_RECORD_HEADER_MAX_SIZE + FRAME_MAX_VALUES * sizeof(double),
+               "POINT_RECORD_MAX_SIZE must fit a record with every field");
+
+typedef struct {
+    char measurement[POINT_NAME_SIZE];
+    char tag_keys[POINT_SCHEMA_MAX_TAGS][POINT_NAME_SIZE];
+    char tag_values[POINT_SCHEMA_MAX_TAGS][POINT_NAME_SIZE];
+    size_t tag_count;
+    char field_names[FRAME_MAX_VALUES][POINT_NAME_SIZE];
+    size_t field_count;
+    LineProtocolTemplate* line_template; // Not part of the layout
+} PointSchema;
+
+// Append-only: a schema never changes once its id has been published through
+// g_schema_count, so encoders and renderers read it without taking the lock
+static PointSchema g_schemas[POINT_SCHEMA_MAX];
+static atomic_size_t g_schema_count;
+static pthread_mutex_t g_register_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int64_t g_timestamp_base; // Set before the first schema is published
+
+// --- Encoding Helpers ---
+
+static size_t put_varint(unsigned char* out, uint64_t value) {
+    size_t size = 0;
+    while (value >= 0x80) {
+        out[size++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    out[size++] = (unsigned char)value;
+    return size;
+}
+
+// Returns the bytes consumed, or 0 if the varint is cut short
+static size_t get_varint(const unsigned char* in, size_t available, uint64_t* value) {
+    *value = 0;
+    for (size_t i = 0; i < available && i < 10; i++) {
+        *value |= (uint64_t)(in[i] & 0x7F) << (7 * i);
+        if ((in[i] & 0x80) == 0) return i + 1;
+    }
+    return 0;
+}
+
+// Small deltas of either sign become small unsigned numbers
+static uint64_t zigzag_encode(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t zigzag_decode(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static bool copy_name(char* out, const char* name) {
+    if (!name || strlen(name) >= POINT_NAME_SIZE) return false;
+    strcpy(out, name);
+    return true;
+}
+
+static bool schema_equals(const PointSchema* left, const PointSchema* right) {
+    if (left->tag_count != right->tag_count || left->field_count != right->field_count ||
+        strcmp(left->measurement, right->measurement) != 0) {
+        return false;
+    }
+    for (size_t i = 0; i < left->tag_count; i++) {
+        if (strcmp(left->tag_keys[i], right->tag_keys[i]) != 0 ||
+            strcmp(left->tag_values[i], right->tag_values[i]) != 0) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < left->field_count; i++) {
+        if (strcmp(left->field_names[i], right->field_names[i]) != 0) return false;
+    }
+    return true;
+}
+
+// --- Public Functions ---
+
+int point_schema_register(const char* measurement, const char* const tag_keys[], const char* const tag_values[],
+                          size_t tag_count, const char* const field_names[], size_t field_count) {
+    if (tag_count > POINT_SCHEMA_MAX_TAGS || field_count == 0 || field_count > FRAME_MAX_VALUES) return -1;
+
+    PointSchema schema;
+    memset(&schema, 0, sizeof(schema));
+    bool valid = copy_name(schema.measurement, measurement);
+    for (size_t i = 0; valid && i < tag_count; i++) {
+        valid = copy_name(schema.tag_keys[i], tag_keys[i]) && copy_name(schema.tag_values[i], tag_values[i]);
+    }
+    int field_digits[FRAME_MAX_VALUES];
+    for (size_t i = 0; valid && i < field_count; i++) {
+        valid = copy_name(schema.field_names[i], field_names[i]);
+        field_digits[i] = float_format_field_digits(field_names[i]);
+    }
+    // Names are validated and the fixed part of the line rendered here once, so
+    // rendering a record never fails on a name and only formats numbers
+    if (valid) {
+        schema.line_template = lp_template_create(measurement, tag_keys, tag_values, tag_count, field_names,
+                                                  field_digits, field_count);
+        valid = schema.line_template != NULL;
+    }
+    if (!valid) {
+        fprintf(stderr, "Point schema for '%s' has an invalid or too long name.\n", measurement ? measurement : "");
+        return -1;
+    }
+    schema.tag_count = tag_count;
+    schema.field_count = field_count;
+
+    pthread_mutex_lock(&g_register_mutex);
+    size_t count = atomic_load_explicit(&g_schema_count, memory_order_relaxed);
+    for (size_t i = 0; i < count; i++) {
+        if (schema_equals(&g_schemas[i], &schema)) {
+            pthread_mutex_unlock(&g_register_mutex);
+            lp_template_destroy(schema.line_template);
+            return (int)i;
+        }
+    }
+    if (count == POINT_SCHEMA_MAX) {
+        pthread_mutex_unlock(&g_register_mutex);
+        lp_template_destroy(schema.line_template);
+        fprintf(stderr, "Point schema registry is full (%d schemas).\n", POINT_SCHEMA_MAX);
+        return -1;
+    }
+    if (count == 0) {
+        g_timestamp_base = (int64_t)time(NULL);
+    }
+    g_schemas[count] = schema;
+    atomic_store_explicit(&g_schema_count, count + 1, memory_order_release);
+    pthread_mutex_unlock(&g_register_mutex);
+    return (int)count;
+}
+
+size_t point_record_encode(int schema_id, const MeasurementFrame* frame, void* out, size_t capacity) {
+    if (!frame || !out) return 0;
+    size_t count = atomic_load_explicit(&g_schema_count, memory_order_acquire);
+    if (schema_id < 0 || (size_t)schema_id >= count) {
+        fprintf(stderr, "Point record: unknown schema %d.\n", schema_id);
+        return 0;
+    }
+    const PointSchema* schema = &g_schemas[schema_id];
+    if (frame->count != schema->field_count) {
+        fprintf(stderr, "Point record: frame has %zu values, schema %d has %zu fields.\n", frame->count, schema_id,
+                schema->field_count);
+        return 0;
+    }
+
+    // Checking the longest header keeps the writes unchecked
+    if (capacity < POINT_RECORD_HEADER_MAX_SIZE + schema->field_count * sizeof(double)) {
+        fprintf(stderr, "Point record: %zu bytes are too few for %zu values of schema %d.\n", capacity,
+                schema->field_count, schema_id);
+        return 0;
+    }
+    for (size_t i = 0; i < frame->count; i++) {
+        if (!isfinite(frame->values[i].value)) { // Line protocol has no NaN or infinity
+            fprintf(stderr, "Point record: '%s' is not a finite number.\n", schema->field_names[i]);
+            return 0;
+        }
+    }
+
+    unsigned char* data = out;
+    size_t size = put_varint(data, (uint64_t)schema_id);
+    size += put_varint(data + size, zigzag_encode(frame->timestamp - g_timestamp_base));
+    for (size_t i = 0; i < frame->count; i++) {
+        memcpy(data + size, &frame->values[i].value, sizeof(double)); // In memory only, so native byte order
+        size += sizeof(double);
+    }
+    return size;
+}
+
+LineProtocolError point_record_render(const void* record, size_t size, LineProtocolBuilder* builder) {
+    if (!record || !builder) return LP_ERROR_INVALID_PARAM;
+    const unsigned char* data = record;
+
+    uint64_t schema_id;
+    uint64_t delta;
+    size_t position = get_varint(data, size, &schema_id);
+    size_t used = position > 0 ? get_varint(data + position, size - position, &delta) : 0;
+    if (used == 0 || schema_id >= atomic_load_explicit(&g_schema_count, memory_order_acquire)) {
+        return LP_ERROR_INVALID_PARAM;
+    }
+    position += used;
+    const PointSchema* schema = &g_schemas[schema_id];
+    if (size - position != schema->field_count * sizeof(double)) return LP_ERROR_INVALID_PARAM;
+
+    double values[FRAME_MAX_VALUES];
+    memcpy(values, data + position, schema->field_count * sizeof(double)); // Records are not aligned
+    return lp_render_template(builder, schema->line_template, values, g_timestamp_base + zigzag_decode(delta));
+}
@@ -0,0 +1,70 @@
+#ifndef POINT_RECORD_H
+#define POINT_RECORD_H
+
+/**
+ * @file PointRecord.h
+ * @brief Compact binary form of a measurement frame, queued instead of line protocol text.
+ *
+ * A record holds a schema id, the timestamp as a delta from a process-wide
+ * base and the raw field values; measurement, tags and field names live once
+ * in the schema registry. Four channels plus GPS take about 70 bytes instead
+ * of about 250 bytes of text, and no number is formatted until the point is
+ * actually sent or written to disk.
+ *
+ * Records only live in memory: schema ids and the timestamp base are valid
+ * for the current process. Everything persisted is rendered line protocol.
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "MeasurementFrame.h"
+#include "LineProtocol.h"
+
+#define POINT_SCHEMA_MAX 64        // Distinct schemas per process
+#define POINT_SCHEMA_MAX_TAGS 4
+#define POINT_RECORD_HEADER_MAX_SIZE (2 + 10) // Schema id and timestamp varints at their longest
+#define POINT_RECORD_MAX_SIZE (POINT_RECORD_HEADER_MAX_SIZE + FRAME_MAX_VALUES * 8) // Header and values
+
+/**
+ * @brief Registers the measurement, tag set and ordered field names of a point layout.
+ *
+ * Names are validated and the fixed part of the line (measurement, tags and
+ * field keys) is rendered into a line protocol template once, so rendering a
+ * record only formats its values and timestamp. Registering an identical
+ * layout again returns the existing id. Thread-safe.
+ *
+ * @param measurement Measurement name.
+ * @param tag_keys Tag keys, `tag_count` of them.
+ * @param tag_values Tag values, `tag_count` of them.
+ * @param tag_count Number of tags (at most POINT_SCHEMA_MAX_TAGS).
+ * @param field_names Field names in the order the frame holds their values.
+ * @param field_count Number of fields (at most FRAME_MAX_VALUES).
+ * @return The schema id, or -1 if a name is invalid or the registry is full.
+ */
+int point_schema_register(const char* measurement, const char* const tag_keys[], const char* const tag_values[],
+                          size_t tag_count, const char* const field_names[], size_t field_count);
+
+/**
+ * @brief Encodes the timestamp and values of a frame as a record of the given schema.
+ *
+ * @param schema_id A registered schema whose fields match the frame's values.
+ * @param frame The frame; its value names are not looked at.
+ * @param out Output buffer.
+ * @param capacity Size of `out`; POINT_RECORD_MAX_SIZE always suffices.
+ * @return Size of the record, or 0 on failure (unknown schema, mismatched value
+ *         count, buffer too small or a value that is not finite). The cause is
+ *         printed to stderr.
+ */
+size_t point_record_encode(int schema_id, const MeasurementFrame* frame, void* out, size_t capacity);
+
+/**
+ * @brief Renders a record as one line of line protocol, without a trailing newline.
+ *
+ * @param record The record.
+ * @param size Size of the record.
+ * @param builder Builder receiving the line (it is reset first).
+ * @return LP_SUCCESS, or the error that stopped the rendering.
+ */
+LineProtocolError point_record_render(const void* record, size_t size, LineProtocolBuilder* builder);
+
+#endif // POINT_RECORD_H
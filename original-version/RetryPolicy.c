@@ -0,0 +1,146 @@
+#include "RetryPolicy.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+SendOutcome send_outcome_classify(CURLcode curl_code, long http_status, long retry_after_s) {
+    if (curl_code != CURLE_OK) {
+        return SEND_OUTCOME_RETRYABLE;
+    }
+    if (http_status >= 200 && http_status < 300) {
+        return SEND_OUTCOME_SUCCESS;
+    }
+    if (http_status == 429 || (http_status == 503 && retry_after_s > 0)) {
+        return SEND_OUTCOME_THROTTLED;
+    }
+    if (http_status == 408 || http_status >= 500 || http_status == 0) {
+        return SEND_OUTCOME_RETRYABLE;
+    }
+    // 400 (malformed line protocol), 401/403 (token), 404 (org/bucket), 413 (too large), ...
+    return SEND_OUTCOME_PERMANENT;
+}
+
+const char* send_outcome_string(SendOutcome outcome) {
+    switch (outcome) {
+        case SEND_OUTCOME_SUCCESS:   return "success";
+        case SEND_OUTCOME_RETRYABLE: return "retryable";
+        case SEND_OUTCOME_THROTTLED: return "throttled";
+        case SEND_OUTCOME_PERMANENT: return "permanent";
+        default:                     return "unknown";
+    }
+}
+
+const char* circuit_state_string(CircuitState state) {
+    switch (state) {
+        case CIRCUIT_CLOSED:    return "closed";
+        case CIRCUIT_OPEN:      return "open";
+        case CIRCUIT_HALF_OPEN: return "half_open";
+        default:                return "unknown";
+    }
+}
+
+void backoff_policy_init(BackoffPolicy* policy, unsigned int base_ms, unsigned int max_ms) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    policy->base_ms = base_ms > 0 ? base_ms : 1;
+    policy->max_ms = max_ms > policy->base_ms ? max_ms : policy->base_ms;
+    policy->seed = (unsigned int)(now.tv_nsec ^ (getpid() << 16));
+}
+
+unsigned int backoff_delay_ms(BackoffPolicy* policy, unsigned int attempt) {
+    unsigned long long ceiling = policy->base_ms;
+    while (attempt-- > 0 && ceiling < policy->max_ms) {
+        ceiling *= 2;
+    }
+    if (ceiling > policy->max_ms) {
+        ceiling = policy->max_ms;
+    }
+    return (unsigned int)((unsigned long long)rand_r(&policy->seed) % (ceiling + 1));
+}
+
+void circuit_breaker_init(CircuitBreaker* breaker, unsigned int failure_threshold,
+                          unsigned int min_open_ms, unsigned int max_open_ms) {
+    breaker->state = CIRCUIT_CLOSED;
+    breaker->failure_threshold = failure_threshold > 0 ? failure_threshold : 1;
+    breaker->consecutive_failures = 0;
+    breaker->min_open_ms = min_open_ms;
+    breaker->max_open_ms = max_open_ms > min_open_ms ? max_open_ms : min_open_ms;
+    breaker->open_ms = min_open_ms;
+    breaker->open_until_ms = 0;
+    breaker->probe_in_flight = false;
+    breaker->trips = 0;
+}
+
+bool circuit_breaker_allow(CircuitBreaker* breaker, unsigned long long now_ms) {
+    switch (breaker->state) {
+        case CIRCUIT_CLOSED:
+            return true;
+        case CIRCUIT_OPEN:
+            if (now_ms < breaker->open_until_ms) {
+                return false;
+            }
+            breaker->state = CIRCUIT_HALF_OPEN;
+            breaker->probe_in_flight = true;
+            return true;
+        case CIRCUIT_HALF_OPEN:
+        default:
+            if (breaker->probe_in_flight) {
+                return false;
+            }
+            breaker->probe_in_flight = true;
+            return true;
+    }
+}
+
+void circuit_breaker_record_success(CircuitBreaker* breaker) {
+    if (breaker->state != CIRCUIT_CLOSED) {
+        printf("Sender: endpoint reachable again, resuming writes.\n");
+    }
+    breaker->state = CIRCUIT_CLOSED;
+    breaker->consecutive_failures = 0;
+    breaker->open_ms = breaker->min_open_ms;
+    breaker->open_until_ms = 0;
+    breaker->probe_in_flight = false;
+}
+
+static void open_circuit(CircuitBreaker* breaker, unsigned long long now_ms, unsigned int wait_ms) {
+    breaker->state = CIRCUIT_OPEN;
+    breaker->open_until_ms = now_ms + wait_ms;
+    breaker->probe_in_flight = false;
+    breaker->trips++;
+    fprintf(stderr, "Sender: endpoint unavailable, routing writes to the offline file for %u ms.\n", wait_ms);
+}
+
+void circuit_breaker_record_failure(CircuitBreaker* breaker, unsigned long long now_ms, unsigned int min_wait_ms) {
+    switch (breaker->state) {
+        case CIRCUIT_OPEN:
+            // A request started before the circuit opened; the decision is already made
+            if (min_wait_ms > 0 && now_ms + min_wait_ms > breaker->open_until_ms) {
+                breaker->open_until_ms = now_ms + min_wait_ms;
+            }
+            return;
+        case CIRCUIT_HALF_OPEN:
+            // The probe failed: stay away twice as long as last time
+            breaker->open_ms = breaker->open_ms * 2 < breaker->max_open_ms ? breaker->open_ms * 2 : breaker->max_open_ms;
+            open_circuit(breaker, now_ms, min_wait_ms > breaker->open_ms ? min_wait_ms : breaker->open_ms);
+            return;
+        case CIRCUIT_CLOSED:
+        default:
+            breaker->consecutive_failures++;
+            if (min_wait_ms > 0 || breaker->consecutive_failures >= breaker->failure_threshold) {
+                open_circuit(breaker, now_ms, min_wait_ms > breaker->open_ms ? min_wait_ms : breaker->open_ms);
+            }
+            return;
+    }
+}
+
+void circuit_breaker_expedite(CircuitBreaker* breaker, unsigned long long now_ms) {
+    if (breaker->state == CIRCUIT_OPEN && breaker->open_until_ms > now_ms) {
+        breaker->open_until_ms = now_ms;
+    }
+}
+
+unsigned long long circuit_breaker_retry_at(const CircuitBreaker* breaker) {
+    return breaker->state == CIRCUIT_CLOSED ? 0 : breaker->open_until_ms;
+}
@@ -0,0 +1,133 @@
+#ifndef RETRY_POLICY_H
+#define RETRY_POLICY_H
+
+/**
+ * @file RetryPolicy.h
+ * @brief Classification of write results, jittered backoff and a circuit breaker.
+ *
+ * None of these types are thread-safe; they are owned by the thread that
+ * drives the requests (the sender thread).
+ */
+
+#include <stdbool.h>
+#include <curl/curl.h>
+
+typedef enum {
+    SEND_OUTCOME_SUCCESS,   // 2xx
+    SEND_OUTCOME_RETRYABLE, // Network errors, timeouts, 408 and 5xx: try again after a backoff
+    SEND_OUTCOME_THROTTLED, // 429, or 503 with Retry-After: wait as long as the server asks
+    SEND_OUTCOME_PERMANENT  // Any other 4xx: resending the same body cannot succeed
+} SendOutcome;
+
+/**
+ * @brief Classifies the result of a write request.
+ * @param curl_code Transport-level result.
+ * @param http_status HTTP status, or 0 if no response was received.
+ * @param retry_after_s Value of the Retry-After header in seconds, or 0 if absent.
+ * @return The outcome class.
+ */
+SendOutcome send_outcome_classify(CURLcode curl_code, long http_status, long retry_after_s);
+
+/**
+ * @brief Returns a short name for an outcome, for log messages.
+ */
+const char* send_outcome_string(SendOutcome outcome);
+
+typedef struct {
+    unsigned int base_ms; // Delay ceiling for the first retry
+    unsigned int max_ms;  // Upper bound for the delay ceiling
+    unsigned int seed;    // rand_r() state
+} BackoffPolicy;
+
+/**
+ * @brief Initializes a backoff policy with a per-process random seed.
+ */
+void backoff_policy_init(BackoffPolicy* policy, unsigned int base_ms, unsigned int max_ms);
+
+/**
+ * @brief Returns a "full jitter" delay: uniform in [0, min(max_ms, base_ms * 2^attempt)].
+ *
+ * Spreading retries randomly keeps many devices that lost the uplink at the
+ * same time from reconnecting in lockstep.
+ * @param policy The policy.
+ * @param attempt Zero-based retry number.
+ */
+unsigned int backoff_delay_ms(BackoffPolicy* policy, unsigned int attempt);
+
+typedef enum {
+    CIRCUIT_CLOSED,   // Requests flow normally
+    CIRCUIT_OPEN,     // Endpoint considered down; requests are not attempted
+    CIRCUIT_HALF_OPEN // Open period expired; a single probe request is allowed
+} CircuitState;
+
+typedef struct {
+    CircuitState state;
+    unsigned int failure_threshold;    // Consecutive failures that open the circuit
+    unsigned int consecutive_failures;
+    unsigned int min_open_ms;
+    unsigned int max_open_ms;
+    unsigned int open_ms;              // Current open period, doubled by each failed probe
+    unsigned long long open_until_ms;
+    bool probe_in_flight;
+    unsigned long long trips;          // Number of times the circuit opened
+} CircuitBreaker;
+
+/**
+ * @brief Returns a short name for a circuit state, for log messages and metrics.
+ */
+const char* circuit_state_string(CircuitState state);
+
+/**
+ * @brief Initializes a closed circuit breaker.
+ * @param breaker The breaker.
+ * @param failure_threshold Consecutive failures that open the circuit (at least 1).
+ * @param min_open_ms First open period.
+ * @param max_open_ms Upper bound for the open period.
+ */
+void circuit_breaker_init(CircuitBreaker* breaker, unsigned int failure_threshold,
+                          unsigned int min_open_ms, unsigned int max_open_ms);
+
+/**
+ * @brief Asks whether a request may be sent now.
+ *
+ * Once the open period has expired this admits exactly one probe request and
+ * refuses everything else until that probe has been recorded.
+ * @param breaker The breaker.
+ * @param now_ms Current monotonic time in milliseconds.
+ * @return true if the caller should send the request.
+ */
+bool circuit_breaker_allow(CircuitBreaker* breaker, unsigned long long now_ms);
+
+/**
+ * @brief Records a request that reached a working endpoint and closes the circuit.
+ *
+ * Permanent rejections are recorded here too: the endpoint is up, the request was bad.
+ */
+void circuit_breaker_record_success(CircuitBreaker* breaker);
+
+/**
+ * @brief Records a retryable or throttled failure.
+ * @param breaker The breaker.
+ * @param now_ms Current monotonic time in milliseconds.
+ * @param min_wait_ms Minimum open period requested by the server (Retry-After), or 0.
+ *        A non-zero value opens the circuit immediately.
+ */
+void circuit_breaker_record_failure(CircuitBreaker* breaker, unsigned long long now_ms, unsigned int min_wait_ms);
+
+/**
+ * @brief Ends the current open period early, so the next request is the probe.
+ *
+ * For when there is reason to believe the endpoint is reachable again, such as
+ * the network coming back. The open period is not reset: if that probe fails,
+ * the circuit stays away twice as long as before.
+ * @param breaker The breaker.
+ * @param now_ms Current monotonic time in milliseconds.
+ */
+void circuit_breaker_expedite(CircuitBreaker* breaker, unsigned long long now_ms);
+
+/**
+ * @brief Returns the time until which requests are refused, or 0 if the circuit is closed.
+ */
+unsigned long long circuit_breaker_retry_at(const CircuitBreaker* breaker);
+
+#endif // RETRY_POLICY_H
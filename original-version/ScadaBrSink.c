@@ -0,0 +1,126 @@
+#include "ScadaBrSink.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <curl/curl.h>
+
+#define SCADABR_TIMEOUT_MS 5000L
+
+typedef struct {
+    char* base_url;
+    CURL* curl_handle;
+    char* url;              // Request URL, rebuilt in place for every record
+    size_t url_capacity;
+} ScadaBrSink;
+
+static size_t discard_response_callback(char* ptr, size_t size, size_t nmemb, void* userdata) {
+    (void)ptr;
+    (void)userdata;
+    return size * nmemb;
+}
+
+// Appends `text` percent-encoded as a query component. Returns false if it does not fit.
+static bool append_escaped(char** position, char* end, const char* text) {
+    static const char hex[] = "0123456789ABCDEF";
+    for (const unsigned char* c = (const unsigned char*)text; *c; c++) {
+        bool unreserved = (*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') ||
+                          (*c >= '0' && *c <= '9') || *c == '-' || *c == '_' || *c == '.' || *c == '~';
+        size_t needed = unreserved ? 1 : 3;
+        if ((size_t)(end - *position) <= needed) return false;
+        if (unreserved) {
+            *(*position)++ = (char)*c;
+        } else {
+            *(*position)++ = '%';
+            *(*position)++ = hex[*c >> 4];
+            *(*position)++ = hex[*c & 0x0F];
+        }
+    }
+    return true;
+}
+
+static size_t scadabr_encode(void* state, const MeasurementFrame* frame, char* out, size_t capacity) {
+    (void)state;
+    char* position = out;
+    char* end = out + capacity;
+
+    for (size_t i = 0; i < frame->count; i++) {
+        if (i > 0) {
+            if (end - position <= 1) return 0;
+            *position++ = '&';
+        }
+        if (!append_escaped(&position, end, frame->values[i].name)) return 0;
+        int written = snprintf(position, (size_t)(end - position), "=%.6f", frame->values[i].value);
+        if (written < 0 || written >= end - position) return 0;
+        position += written;
+    }
+    *position = '\0';
+    return (size_t)(position - out);
+}
+
+static bool scadabr_deliver(void* state, PooledBuffer* const records[], size_t count) {
+    ScadaBrSink* sink = (ScadaBrSink*)state;
+    size_t base_length = strlen(sink->base_url);
+
+    for (size_t i = 0; i < count; i++) {
+        size_t needed = base_length + 1 + records[i]->length + 1;
+        if (needed > sink->url_capacity) {
+            char* new_url = realloc(sink->url, needed);
+            if (!new_url) return false;
+            sink->url = new_url;
+            sink->url_capacity = needed;
+        }
+        memcpy(sink->url, sink->base_url, base_length);
+        sink->url[base_length] = '?';
+        memcpy(sink->url + base_length + 1, records[i]->data, records[i]->length + 1);
+
+        curl_easy_setopt(sink->curl_handle, CURLOPT_URL, sink->url);
+        CURLcode result = curl_easy_perform(sink->curl_handle);
+        long status = 0;
+        curl_easy_getinfo(sink->curl_handle, CURLINFO_RESPONSE_CODE, &status);
+        if (result != CURLE_OK || status < 200 || status >= 300) {
+            fprintf(stderr, "Sink scadabr: request failed: %s (HTTP %ld)\n", curl_easy_strerror(result), status);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void scadabr_destroy(void* state) {
+    ScadaBrSink* sink = (ScadaBrSink*)state;
+    if (!sink) return;
+    if (sink->curl_handle) curl_easy_cleanup(sink->curl_handle);
+    free(sink->base_url);
+    free(sink->url);
+    free(sink);
+}
+
+const SinkOps SCADABR_SINK_OPS = {
+    .name = "scadabr",
+    .encode = scadabr_encode,
+    .deliver = scadabr_deliver,
+    .destroy = scadabr_destroy,
+};
+
+void* scadabr_sink_create(const char* base_url) {
+    if (!base_url) return NULL;
+
+    ScadaBrSink* sink = calloc(1, sizeof(ScadaBrSink));
+    if (!sink) {
+        perror("Failed to allocate ScadaBR sink");
+        return NULL;
+    }
+    sink->base_url = strdup(base_url);
+    sink->curl_handle = curl_easy_init();
+    if (!sink->base_url || !sink->curl_handle) {
+        fprintf(stderr, "Failed to initialize ScadaBR sink.\n");
+        scadabr_destroy(sink);
+        return NULL;
+    }
+
+    curl_easy_setopt(sink->curl_handle, CURLOPT_HTTPGET, 1L);
+    curl_easy_setopt(sink->curl_handle, CURLOPT_WRITEFUNCTION, discard_response_callback);
+    curl_easy_setopt(sink->curl_handle, CURLOPT_TIMEOUT_MS, SCADABR_TIMEOUT_MS);
+    curl_easy_setopt(sink->curl_handle, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(sink->curl_handle, CURLOPT_NOSIGNAL, 1L);
+    return sink;
+}
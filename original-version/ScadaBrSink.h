@@ -0,0 +1,23 @@
+#ifndef SCADABR_SINK_H
+#define SCADABR_SINK_H
+
+/**
+ * @file ScadaBrSink.h
+ * @brief Sink for the ScadaBR HTTP data source (`/ScadaBR/httpds?tag=value&...`).
+ *
+ * Each frame becomes one GET request carrying every value as a query
+ * parameter. Requests reuse a single curl handle, so the connection stays open.
+ */
+
+#include "Sink.h"
+
+extern const SinkOps SCADABR_SINK_OPS;
+
+/**
+ * @brief Creates the sink state.
+ * @param base_url Data source URL, e.g. "http://192.168.0.10:8080/ScadaBR/httpds".
+ * @return Sink state for sink_worker_create(), or NULL on failure.
+ */
+void* scadabr_sink_create(const char* base_url);
+
+#endif // SCADABR_SINK_H
@@ -1,11 +1,25 @@
 #include "Sender.h"
 #include "DataQueue.h"
 #include "OfflineQueue.h"
-#include "util.h"
+#include "EncodePipeline.h"
+#include "Compression.h"
+#include "LineProtocol.h"
+#include "PointRecord.h"
+#include "HttpTransport.h"
+#include "NetworkMonitor.h"
+#include "RetryPolicy.h"
+#include "SenderMetrics.h"
+#include "TimingUtils.h"
+#include <poll.h>
 #include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include <unistd.h> 
+#include <sys/eventfd.h>
 #include <curl/curl.h>
 
 typedef struct _InfluxDBContext {
@@ -13,25 +27,213 @@ typedef struct _InfluxDBContext {
     char *bucket;
     char *org;
     char *token;
+    // Request state built once in sender_create_from_env() and reused for every write
+    char *write_url;
+    struct curl_slist *gzip_headers;  // Authorization, Content-Type and Content-Encoding: gzip
 } InfluxDBContext;
 
+// Replay starts as soon as it is triggered; this timer only catches what the triggers miss
 #define OFFLINE_QUEUE_PROCESS_INTERVAL_S 60
+// Link and route notifications arrive in bursts while an interface comes up
+#define REPLAY_NETWORK_SETTLE_MS 2000
+
+// Reasons for an immediate replay pass, collected until the offline processor takes them
+#define REPLAY_TRIGGER_NETWORK 0x1U  // An interface came up or a default route appeared
+#define REPLAY_TRIGGER_UPLINK 0x2U   // A write succeeded after failures
+#define REPLAY_TRIGGER_MANUAL 0x4U   // sender_request_replay()
+#define SENDER_CONNECT_TIMEOUT_MS 10000L
+#define SENDER_DEFAULT_REQUEST_TIMEOUT_MS 20000
+#define SENDER_DNS_CACHE_TIMEOUT_S 300L
+
+// Concurrent writes: enough to keep a high-RTT cellular link busy while a
+// single stalled request only ties up one slot until its own deadline
+#define SENDER_DEFAULT_MAX_IN_FLIGHT 4
+// Upper bound on how long the event loop sleeps when nothing is due
+#define SENDER_IDLE_POLL_MS 1000
+
+// Retryable failures are retried with jittered exponential backoff before the
+// batch goes to disk. After several consecutive failures the circuit opens and
+// writes go straight to the offline file until a single probe request succeeds.
+#define SENDER_DEFAULT_MAX_RETRIES 3
+#define SENDER_DEFAULT_RETRY_BASE_MS 1000
+#define SENDER_DEFAULT_RETRY_MAX_MS 30000
+#define SENDER_DEFAULT_BREAKER_THRESHOLD 5
+#define SENDER_DEFAULT_BREAKER_OPEN_MS 10000
+#define SENDER_DEFAULT_BREAKER_MAX_OPEN_MS 300000
+
+// Live micro-batching: a batch is sent when it reaches N lines, B bytes, or
+// T milliseconds after its first point, whichever comes first
+#define SENDER_BATCH_DEFAULT_MAX_LINES 1000
+#define SENDER_BATCH_DEFAULT_MAX_BYTES (256 * 1024)
+#define SENDER_BATCH_DEFAULT_MAX_DELAY_MS 10000
+
+// Pooled point buffers: one point record (PointRecord.h) always fits, and 1024 of
+// them cover the queue depth seen in normal operation without touching the heap
+#define SENDER_BUFFER_CAPACITY POINT_RECORD_MAX_SIZE
+#define SENDER_BUFFER_POOL_DEFAULT_SIZE 1024
+
+// Live queue bounds, roughly one hour of data at 10 Hz before the overflow policy kicks in
+#define SENDER_QUEUE_DEFAULT_MAX_ITEMS 36000
+#define SENDER_OFFLINE_DEFAULT_COMMIT_INTERVAL_MS 1000
+#define SENDER_OFFLINE_DEFAULT_COMMIT_BYTES (64 * 1024)
+#define SENDER_OFFLINE_DEFAULT_SEGMENT_BYTES (4 * 1024 * 1024)
+#define SENDER_OFFLINE_DEFAULT_MAX_BYTES (256ULL * 1024 * 1024)
+#define SENDER_OFFLINE_DEFAULT_DOWNSAMPLE_S 60
+#define SENDER_METRICS_DEFAULT_FILE "logs/sender_metrics.json"
+#define SENDER_METRICS_DEFAULT_INTERVAL_S 10
+#define SENDER_METRICS_JSON_SIZE (16 * 1024)
+#define SENDER_QUEUE_DEFAULT_MAX_BYTES (16 * 1024 * 1024)
+
+// Share of the uplink (in bytes) given to backlog replay while live data is waiting
+#define SENDER_DEFAULT_BACKLOG_SHARE_PERCENT 20
+// Lane byte counters are halved past this total so the share tracks recent traffic
+#define LANE_ACCOUNTING_WINDOW_BYTES (4 * 1024 * 1024)
+
+// Low-priority lane: one compressed replay batch handed over by the offline
+// processor thread, which waits until the sender thread has sent it.
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t done_cond;
+    const void* data;
+    size_t size;
+    bool pending;     // A batch is waiting to be scheduled
+    bool in_progress; // The batch is in flight
+    bool done;
+    OfflineSendResult result;
+} BacklogLane;
+
+// Byte accounting that decides when the backlog lane gets a turn
+typedef struct {
+    unsigned int backlog_share_percent;
+    unsigned long long live_bytes;
+    unsigned long long backlog_bytes;
+} LaneScheduler;
+
+typedef struct {
+    size_t max_lines;
+    size_t max_bytes;
+    unsigned int max_delay_ms;
+} BatchConfig;
+
+// Live points collected for the next request, still as records
+typedef struct {
+    PooledBuffer** points;
+    size_t count;
+    size_t bytes;
+    struct timespec first_point_at;
+} LiveBatch;
+
+typedef enum {
+    SENDER_LANE_LIVE,
+    SENDER_LANE_BACKLOG
+} SenderLane;
+
+// One in-flight write. Live requests own their body buffers, which are kept and
+// reused by later requests; backlog requests send a slice of the segment the offline
+// processor has mapped, which curl reads in place.
+typedef struct {
+    bool in_use;
+    SenderLane lane;
+    size_t point_count;
+    char* body;              // Uncompressed live body, kept for the offline log on failure
+    size_t body_size;
+    size_t body_capacity;
+    unsigned char* compressed;
+    size_t compressed_size;
+    size_t compressed_capacity;
+    unsigned int attempt;            // Retries made so far
+    bool awaiting_retry;             // Parked until retry_at_ms, holding no transport slot
+    unsigned long long retry_at_ms;
+} SenderRequest;
 
 // The full definition of the SenderContext is here, making it opaque.
 struct SenderContext {
-    DataQueue* queue;
+    BufferPool* buffer_pool;
+    DataQueue* queue;               // High-priority lane: live points
+    BacklogLane backlog_lane;       // Low-priority lane: offline replay batches
+    LaneScheduler scheduler;
+    BatchConfig batch_config;
     pthread_t sender_thread_id;
     pthread_t offline_processor_thread_id;
     volatile bool is_running;
     InfluxDBContext influxdb_context;
+
+    // DNS and TLS session caches shared by every request handle
+    CURLSH* curl_share;
+    pthread_mutex_t share_locks[CURL_LOCK_DATA_LAST];
+
+    // Driven by the sender thread only; other threads may just wake it up
+    HttpTransport* transport;
+    SenderRequest* requests;
+    size_t max_in_flight;
+
+    // One gzip stream for live batches, reset between batches; the backlog is stored compressed
+    GzipCompressor* live_compressor;      // Sender thread
+    int gzip_level;
+    LineProtocolBuilder* render_builder;  // Sender thread: turns queued records into line protocol
+
+    // Failure handling, also owned by the sender thread
+    unsigned int max_retries;
+    BackoffPolicy backoff;
+    CircuitBreaker breaker;
+    _Atomic unsigned long long uplink_retry_at_ms; // Published for the offline processor; 0 while healthy
+
+    // Replay triggers: raised from any thread (or a signal handler), taken by the offline processor
+    int replay_event_fd;            // eventfd that wakes the offline processor
+    atomic_uint replay_triggers;    // REPLAY_TRIGGER_* bits
+    atomic_bool expedite_probe;     // Asks the sender thread to probe the endpoint now
+
+    // Recorded lock-free by every sender thread, exported by the offline processor
+    SenderMetrics* metrics;
+    const char* metrics_file;
+    unsigned int metrics_interval_s;
 };
 
 // --- Private Function Prototypes ---
-static bool send_http_post(const SenderContext* context, const char* url, struct curl_slist* headers, const void* post_data, long post_size);
-static bool send_line_protocol(SenderContext* context, const char* line_protocol);
-static bool send_compressed_batch_callback(const void* data, size_t size, void* user_context);
+static bool init_request_state(SenderContext* context);
+static void free_request_state(SenderContext* context);
+static bool init_transport(SenderContext* context);
+static void free_transport(SenderContext* context);
+static void start_ready_requests(SenderContext* context, LiveBatch* batch);
+static void start_live_request(SenderContext* context, LiveBatch* batch);
+static void start_backlog_request(SenderContext* context);
+static void start_due_retries(SenderContext* context);
+static void give_up_request(SenderContext* context, SenderRequest* request);
+static void record_request_started(SenderContext* context);
+static void record_outcome(SenderContext* context, SendOutcome outcome, const HttpResult* result);
+static void configure_retries(SenderContext* context);
+static void configure_metrics(SenderContext* context);
+static void publish_sender_gauges(SenderContext* context);
+static void write_metrics_file(SenderContext* context);
+static SenderRequest* acquire_request(SenderContext* context);
+static void on_request_complete(void* request_context, const HttpResult* result, void* user_context);
+static int next_wakeup_ms(SenderContext* context, const LiveBatch* batch);
+static void drain_queue_to_offline_log(SenderContext* context, LiveBatch* batch);
+static void save_points_to_offline_log(SenderContext* context, PooledBuffer* points[], size_t count);
+static bool append_point_text(LineProtocolBuilder* builder, const PooledBuffer* point, char** text, size_t* size,
+                              size_t* capacity);
+static void write_points_to_offline_log(LineProtocolBuilder* builder, PooledBuffer* const points[], size_t count);
+static bool live_batch_init(LiveBatch* batch, const BatchConfig* config);
+static void live_batch_free(LiveBatch* batch);
+static void live_batch_fill(SenderContext* context, LiveBatch* batch);
+static bool live_batch_is_ready(const LiveBatch* batch, const BatchConfig* config);
+static long live_batch_age_ms(const LiveBatch* batch);
+static OfflineSendResult send_compressed_batch_callback(const void* data, size_t size, void* user_context);
+static bool lane_scheduler_backlog_turn(const LaneScheduler* scheduler, bool live_pending);
+static void lane_scheduler_account(LaneScheduler* scheduler, size_t live_bytes, size_t backlog_bytes);
+static bool backlog_lane_is_pending(BacklogLane* lane);
+static void backlog_lane_finish(BacklogLane* lane, OfflineSendResult result);
+static void configure_lanes(SenderContext* context);
+static void configure_batching(SenderContext* context);
 static void* sender_thread_function(void* arg);
 static void* offline_processor_thread_function(void* arg);
+static void trigger_replay(SenderContext* context, unsigned int reason);
+static unsigned int wait_for_replay_trigger(SenderContext* context, NetworkMonitor* monitor, int timeout_ms);
+static void wait_for_network_to_settle(SenderContext* context, NetworkMonitor* monitor);
+static void apply_expedited_probe(SenderContext* context);
+static size_t env_get_size(const char* name, size_t default_value);
+static void configure_queue_overflow(DataQueue* queue);
+static void spill_to_offline_log(PooledBuffer* const items[], size_t count, void* user_context);
 
 // --- Public Functions ---
 
@@ -53,20 +255,71 @@ SenderContext* sender_create_from_env() {
         return NULL;
     }
 
-    context->queue = data_queue_create();
+    if (!init_request_state(context)) {
+        fprintf(stderr, "Failed to prepare InfluxDB request state.\n");
+        free(context);
+        return NULL;
+    }
+
+    context->buffer_pool = buffer_pool_create(SENDER_BUFFER_CAPACITY,
+                                              env_get_size("SENDER_BUFFER_POOL_SIZE", SENDER_BUFFER_POOL_DEFAULT_SIZE));
+    if (!context->buffer_pool) {
+        fprintf(stderr, "Failed to create sender buffer pool.\n");
+        free_request_state(context);
+        free(context);
+        return NULL;
+    }
+
+    context->queue = data_queue_create(context->buffer_pool);
     if (!context->queue) {
         fprintf(stderr, "Failed to create sender queue.\n");
+        buffer_pool_destroy(context->buffer_pool);
+        free_request_state(context);
+        free(context);
+        return NULL;
+    }
+
+    if (!init_transport(context)) {
+        fprintf(stderr, "Failed to create sender transport.\n");
+        data_queue_destroy(context->queue);
+        buffer_pool_destroy(context->buffer_pool);
+        free_request_state(context);
         free(context);
         return NULL;
     }
 
-    offline_queue_init("logs/offline_log.txt");
+    // Up to one second of points can be lost on power failure, in exchange for one
+    // SD card write per second instead of one open/write/close per point
+    OfflineQueueConfig offline_config = {
+        .commit_interval_ms = (unsigned int)env_get_size("OFFLINE_COMMIT_INTERVAL_MS",
+                                                         SENDER_OFFLINE_DEFAULT_COMMIT_INTERVAL_MS),
+        .commit_bytes = env_get_size("OFFLINE_COMMIT_BYTES", SENDER_OFFLINE_DEFAULT_COMMIT_BYTES),
+        .segment_bytes = env_get_size("OFFLINE_SEGMENT_BYTES", SENDER_OFFLINE_DEFAULT_SEGMENT_BYTES),
+        .gzip_level = context->gzip_level,
+        .max_bytes = env_get_size("OFFLINE_MAX_BYTES", SENDER_OFFLINE_DEFAULT_MAX_BYTES),
+        .downsample_interval_s = (unsigned int)env_get_size("OFFLINE_DOWNSAMPLE_S", SENDER_OFFLINE_DEFAULT_DOWNSAMPLE_S),
+        .compress_workers = env_get_size("OFFLINE_COMPRESS_WORKERS", encode_pipeline_default_workers()),
+    };
+    offline_queue_init("logs/offline", &offline_config);
+    // Log left by versions that kept a single file
+    offline_queue_import("logs/offline_log.txt");
+    configure_queue_overflow(context->queue);
+    configure_lanes(context);
+    configure_batching(context);
+    configure_retries(context);
+    configure_metrics(context);
 
     context->is_running = true;
 
     if (pthread_create(&context->sender_thread_id, NULL, sender_thread_function, context) != 0) {
         perror("Failed to create sender thread");
+        offline_queue_shutdown();
+        free_transport(context);
+        pthread_mutex_destroy(&context->backlog_lane.mutex);
+        pthread_cond_destroy(&context->backlog_lane.done_cond);
         data_queue_destroy(context->queue);
+        buffer_pool_destroy(context->buffer_pool);
+        free_request_state(context);
         free(context);
         return NULL;
     }
@@ -76,8 +329,15 @@ SenderContext* sender_create_from_env() {
         // Stop the already running sender thread
         context->is_running = false;
         data_queue_shutdown(context->queue);
+        http_transport_wakeup(context->transport);
         pthread_join(context->sender_thread_id, NULL);
+        offline_queue_shutdown();
+        free_transport(context);
+        pthread_mutex_destroy(&context->backlog_lane.mutex);
+        pthread_cond_destroy(&context->backlog_lane.done_cond);
         data_queue_destroy(context->queue);
+        buffer_pool_destroy(context->buffer_pool);
+        free_request_state(context);
         free(context);
         return NULL;
     }
@@ -92,49 +352,276 @@ void sender_destroy(SenderContext* context) {
     printf("Stopping sender module...\n");
     context->is_running = false;
 
-    // Signal the queue to shut down, waking up the sender thread if it's waiting
+    // Signal the queue to shut down and wake up the sender thread's event loop
     data_queue_shutdown(context->queue);
+    http_transport_wakeup(context->transport);
+
+    // Wake the offline processor if it is waiting for a trigger, and release it if
+    // it is waiting for a replay batch to be sent
+    trigger_replay(context, 0);
+    pthread_mutex_lock(&context->backlog_lane.mutex);
+    pthread_cond_broadcast(&context->backlog_lane.done_cond);
+    pthread_mutex_unlock(&context->backlog_lane.mutex);
 
     // Wait for the threads to finish
     pthread_join(context->sender_thread_id, NULL);
     pthread_join(context->offline_processor_thread_id, NULL);
 
+    DataQueueStats stats;
+    data_queue_get_stats(context->queue, &stats);
+    printf("Sender queue: %llu enqueued, %llu blocked, %llu dropped (oldest), %llu dropped (newest), "
+           "%llu spilled in %llu chunks, %zu left\n",
+           stats.enqueued, stats.blocked, stats.dropped_oldest, stats.dropped_newest,
+           stats.spilled, stats.spill_events, stats.current_items);
+
+    printf("Sender: %llu retries, circuit opened %llu times\n",
+           metrics_counter_read(&sender_metrics_shard(context->metrics, SENDER_SHARD_SENDER)->retries),
+           context->breaker.trips);
+    write_metrics_file(context);
+    offline_queue_shutdown();
+
+    BufferPoolStats pool_stats;
+    buffer_pool_get_stats(context->buffer_pool, &pool_stats);
+    printf("Sender buffer pool: %zu slab buffers, %llu heap fallbacks\n",
+           pool_stats.slab_buffers, pool_stats.heap_fallbacks);
+
     // Clean up resources
+    free_transport(context);
+    pthread_mutex_destroy(&context->backlog_lane.mutex);
+    pthread_cond_destroy(&context->backlog_lane.done_cond);
     data_queue_destroy(context->queue);
+    buffer_pool_destroy(context->buffer_pool);
+    free_request_state(context);
     free(context);
     printf("Sender module stopped.\n");
 }
 
-void sender_submit(SenderContext* context, const char* line_protocol) {
+PooledBuffer* sender_acquire_buffer(SenderContext* context) {
+    if (!context || !context->is_running) return NULL;
+    return buffer_pool_acquire(context->buffer_pool);
+}
+
+void sender_submit_buffer(SenderContext* context, PooledBuffer** buffer) {
+    if (!buffer || !*buffer) return;
     if (!context || !context->is_running) {
         fprintf(stderr, "Cannot submit measurement, sender is not running.\n");
-        offline_queue_add(line_protocol); // Fallback to offline queue
+        LineProtocolBuilder* builder = lp_builder_create_default();
+        if (builder) {
+            write_points_to_offline_log(builder, buffer, 1); // Fallback to offline queue
+            lp_builder_destroy(builder);
+        }
+        pooled_buffer_release(buffer);
         return;
     }
-    data_queue_enqueue(context->queue, line_protocol);
+    metrics_counter_add(&sender_metrics_shard(context->metrics, SENDER_SHARD_PRODUCER)->points_submitted, 1);
+    data_queue_enqueue_buffer(context->queue, buffer);
+    http_transport_wakeup(context->transport);
+}
+
+void sender_request_replay(SenderContext* context) {
+    if (!context) return;
+    trigger_replay(context, REPLAY_TRIGGER_MANUAL);
+}
+
+void sender_get_queue_stats(SenderContext* context, DataQueueStats* stats) {
+    if (!context || !stats) return;
+    data_queue_get_stats(context->queue, stats);
+}
+
+int sender_get_metrics_json(SenderContext* context, char* out, size_t capacity) {
+    if (!context || !out) return -1;
+    DataQueueStats queue_stats;
+    data_queue_get_stats(context->queue, &queue_stats);
+    return sender_metrics_format_json(context->metrics, &queue_stats, offline_queue_size_bytes(), out, capacity);
 }
 
 // --- Private Function Implementations ---
 
+static size_t env_get_size(const char* name, size_t default_value) {
+    const char* value = getenv(name);
+    if (!value || *value == '\0') return default_value;
+
+    char* endptr;
+    unsigned long long parsed = strtoull(value, &endptr, 10);
+    if (*endptr != '\0') {
+        fprintf(stderr, "Ignoring invalid %s='%s', using %zu\n", name, value, default_value);
+        return default_value;
+    }
+    return (size_t)parsed;
+}
+
+static void configure_queue_overflow(DataQueue* queue) {
+    size_t max_items = env_get_size("SENDER_QUEUE_MAX_ITEMS", SENDER_QUEUE_DEFAULT_MAX_ITEMS);
+    size_t max_bytes = env_get_size("SENDER_QUEUE_MAX_BYTES", SENDER_QUEUE_DEFAULT_MAX_BYTES);
+
+    DataQueueOverflowPolicy policy = DATA_QUEUE_OVERFLOW_SPILL;
+    const char* policy_env = getenv("SENDER_QUEUE_OVERFLOW_POLICY");
+    if (policy_env) {
+        if (strcmp(policy_env, "block") == 0) {
+            policy = DATA_QUEUE_OVERFLOW_BLOCK;
+        } else if (strcmp(policy_env, "drop_oldest") == 0) {
+            policy = DATA_QUEUE_OVERFLOW_DROP_OLDEST;
+        } else if (strcmp(policy_env, "drop_newest") == 0) {
+            policy = DATA_QUEUE_OVERFLOW_DROP_NEWEST;
+        } else if (strcmp(policy_env, "spill") != 0) {
+            fprintf(stderr, "Unknown SENDER_QUEUE_OVERFLOW_POLICY '%s', using spill\n", policy_env);
+        }
+    }
+
+    data_queue_set_overflow_policy(queue, max_items, max_bytes, policy, spill_to_offline_log, NULL);
+}
+
+static void configure_lanes(SenderContext* context) {
+    pthread_mutex_init(&context->backlog_lane.mutex, NULL);
+    pthread_cond_init(&context->backlog_lane.done_cond, NULL);
+
+    size_t share = env_get_size("SENDER_BACKLOG_SHARE_PERCENT", SENDER_DEFAULT_BACKLOG_SHARE_PERCENT);
+    context->scheduler.backlog_share_percent = share > 100 ? 100 : (unsigned int)share;
+
+    const char* order_env = getenv("SENDER_REPLAY_ORDER");
+    if (order_env && strcmp(order_env, "newest") == 0) {
+        offline_queue_set_replay_order(OFFLINE_REPLAY_NEWEST_FIRST);
+    } else {
+        if (order_env && strcmp(order_env, "oldest") != 0) {
+            fprintf(stderr, "Unknown SENDER_REPLAY_ORDER '%s', using oldest\n", order_env);
+        }
+        offline_queue_set_replay_order(OFFLINE_REPLAY_OLDEST_FIRST);
+    }
+}
+
+static void configure_batching(SenderContext* context) {
+    BatchConfig* config = &context->batch_config;
+    config->max_lines = env_get_size("SENDER_BATCH_MAX_LINES", SENDER_BATCH_DEFAULT_MAX_LINES);
+    config->max_bytes = env_get_size("SENDER_BATCH_MAX_BYTES", SENDER_BATCH_DEFAULT_MAX_BYTES);
+    config->max_delay_ms = (unsigned int)env_get_size("SENDER_BATCH_MAX_DELAY_MS", SENDER_BATCH_DEFAULT_MAX_DELAY_MS);
+    if (config->max_lines == 0) {
+        config->max_lines = 1;
+    }
+    printf("Sender batching: up to %zu lines, %zu bytes or %u ms per request.\n",
+           config->max_lines, config->max_bytes, config->max_delay_ms);
+}
+
+static void configure_retries(SenderContext* context) {
+    context->max_retries = (unsigned int)env_get_size("SENDER_MAX_RETRIES", SENDER_DEFAULT_MAX_RETRIES);
+    backoff_policy_init(&context->backoff,
+                        (unsigned int)env_get_size("SENDER_RETRY_BASE_MS", SENDER_DEFAULT_RETRY_BASE_MS),
+                        (unsigned int)env_get_size("SENDER_RETRY_MAX_MS", SENDER_DEFAULT_RETRY_MAX_MS));
+    circuit_breaker_init(&context->breaker,
+                         (unsigned int)env_get_size("SENDER_BREAKER_THRESHOLD", SENDER_DEFAULT_BREAKER_THRESHOLD),
+                         (unsigned int)env_get_size("SENDER_BREAKER_OPEN_MS", SENDER_DEFAULT_BREAKER_OPEN_MS),
+                         (unsigned int)env_get_size("SENDER_BREAKER_MAX_OPEN_MS", SENDER_DEFAULT_BREAKER_MAX_OPEN_MS));
+}
+
+static void configure_metrics(SenderContext* context) {
+    context->metrics_file = getenv("SENDER_METRICS_FILE");
+    if (!context->metrics_file || *context->metrics_file == '\0') {
+        context->metrics_file = SENDER_METRICS_DEFAULT_FILE;
+    }
+    context->metrics_interval_s = (unsigned int)env_get_size("SENDER_METRICS_INTERVAL_S", SENDER_METRICS_DEFAULT_INTERVAL_S);
+}
+
+// State only the sender thread may read, copied out for metric snapshots
+static void publish_sender_gauges(SenderContext* context) {
+    SenderMetrics* metrics = context->metrics;
+    long long awaiting_retry = 0;
+    for (size_t i = 0; i < context->max_in_flight; i++) {
+        if (context->requests[i].awaiting_retry) awaiting_retry++;
+    }
+    unsigned long long now = timing_monotonic_ms();
+    unsigned long long retry_at = circuit_breaker_retry_at(&context->breaker);
+
+    metrics_gauge_set(&metrics->in_flight, (long long)http_transport_in_flight(context->transport));
+    metrics_gauge_set(&metrics->awaiting_retry, awaiting_retry);
+    metrics_gauge_set(&metrics->breaker_state, context->breaker.state);
+    metrics_gauge_set(&metrics->breaker_trips, (long long)context->breaker.trips);
+    metrics_gauge_set(&metrics->uplink_retry_in_ms, retry_at > now ? (long long)(retry_at - now) : 0);
+}
+
+// Replaces the metrics file atomically, so readers never see a partial snapshot
+static void write_metrics_file(SenderContext* context) {
+    if (context->metrics_interval_s == 0) return;
+
+    char json[SENDER_METRICS_JSON_SIZE];
+    int length = sender_get_metrics_json(context, json, sizeof(json));
+    if (length < 0) {
+        fprintf(stderr, "Sender: metrics snapshot too large, not written.\n");
+        return;
+    }
+
+    char temp_path[512];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", context->metrics_file);
+    FILE* file = fopen(temp_path, "w");
+    if (!file) {
+        perror("Could not open sender metrics file");
+        return;
+    }
+    fwrite(json, 1, (size_t)length, file);
+    fputc('\n', file);
+    if (fclose(file) != 0) {
+        perror("Could not write sender metrics file");
+        remove(temp_path);
+        return;
+    }
+    rename(temp_path, context->metrics_file);
+}
+
+// Moves a chunk of the oldest queued points to disk in one write. Runs on the producer's
+// thread, which has no builder of its own; spills come in chunks of half the queue, so
+// creating one here is rare.
+static void spill_to_offline_log(PooledBuffer* const items[], size_t count, void* user_context) {
+    (void)user_context;
+    fprintf(stderr, "Sender: queue over high-water mark, spilling %zu points to offline file.\n", count);
+    LineProtocolBuilder* builder = lp_builder_create_default();
+    if (!builder) {
+        fprintf(stderr, "Sender: no builder to render spilled points, dropping them.\n");
+        return;
+    }
+    write_points_to_offline_log(builder, items, count);
+    lp_builder_destroy(builder);
+}
+
 static void* sender_thread_function(void* arg) {
     SenderContext* context = (SenderContext*)arg;
     printf("Sender thread started.\n");
 
+    LiveBatch batch;
+    if (!live_batch_init(&batch, &context->batch_config)) {
+        fprintf(stderr, "Sender: failed to allocate batch buffers, sender thread exiting.\n");
+        return NULL;
+    }
+
+    // Event loop: start every request that is due while slots are free, then sleep
+    // until a transfer needs attention, a batch deadline passes or a producer wakes us
+    unsigned long long metrics_due_at_ms = timing_monotonic_ms() + context->metrics_interval_s * 1000ULL;
     while (context->is_running) {
-        char* data_to_send = data_queue_dequeue(context->queue);
-        if (data_to_send == NULL) { // This happens on shutdown
-            if (!context->is_running) break;
-            continue;
-        }
+        start_ready_requests(context, &batch);
+        http_transport_run(context->transport, next_wakeup_ms(context, &batch));
 
-        if (!send_line_protocol(context, data_to_send)) {
-            fprintf(stderr, "Sender: Failed to send data, queuing to offline file.\n");
-            offline_queue_add(data_to_send);
+        publish_sender_gauges(context);
+        if (context->metrics_interval_s > 0 && timing_monotonic_ms() >= metrics_due_at_ms) {
+            write_metrics_file(context);
+            metrics_due_at_ms = timing_monotonic_ms() + context->metrics_interval_s * 1000ULL;
         }
+    }
 
-        free(data_to_send);
+    // Cancel what is still in flight: live bodies go to the offline log and the
+    // replay batch is reported as failed, so it stays in the offline file
+    size_t in_flight = http_transport_in_flight(context->transport);
+    http_transport_abort_all(context->transport);
+    printf("Sender: %zu requests aborted at shutdown.\n", in_flight);
+    for (size_t i = 0; i < context->max_in_flight; i++) {
+        if (context->requests[i].awaiting_retry) {
+            give_up_request(context, &context->requests[i]);
+        }
     }
 
+    // Whatever is still batched or queued is kept on disk instead of being dropped
+    save_points_to_offline_log(context, batch.points, batch.count);
+    batch.count = 0;
+    drain_queue_to_offline_log(context, &batch);
+    live_batch_free(&batch);
+    publish_sender_gauges(context);
+
     printf("Sender thread finished.\n");
     return NULL;
 }
@@ -143,99 +630,731 @@ static void* offline_processor_thread_function(void* arg) {
     SenderContext* context = (SenderContext*)arg;
     printf("Offline queue processor thread started.\n");
 
+    // Without netlink, replay still starts on the other triggers and on the timer
+    NetworkMonitor* monitor = network_monitor_create();
+
+    unsigned long long next_pass_ms = timing_monotonic_ms() + OFFLINE_QUEUE_PROCESS_INTERVAL_S * 1000ULL;
     while (context->is_running) {
-        for (int i = 0; i < OFFLINE_QUEUE_PROCESS_INTERVAL_S && context->is_running; ++i) {
-            sleep(1);
+        unsigned int triggers = 0;
+        unsigned long long now_ms = timing_monotonic_ms();
+        while (context->is_running && triggers == 0 && now_ms < next_pass_ms) {
+            triggers = wait_for_replay_trigger(context, monitor, (int)(next_pass_ms - now_ms));
+            now_ms = timing_monotonic_ms();
         }
+        if (!context->is_running) break;
 
-        if (context->is_running) {
+        // Runs even while the uplink is down, which is exactly when the backlog grows
+        offline_queue_enforce_quota();
+
+        if (triggers != 0) {
+            printf("Offline queue: replay triggered by %s.\n",
+                   (triggers & REPLAY_TRIGGER_MANUAL)    ? "request"
+                   : (triggers & REPLAY_TRIGGER_NETWORK) ? "network change"
+                                                         : "uplink recovery");
+            // The endpoint is probably reachable again, so don't sit out the breaker's open period
+            if (triggers & (REPLAY_TRIGGER_NETWORK | REPLAY_TRIGGER_MANUAL)) {
+                atomic_store(&context->expedite_probe, true);
+            }
+            offline_queue_process(send_compressed_batch_callback, context);
+        } else if (timing_monotonic_ms() >= atomic_load(&context->uplink_retry_at_ms)) {
+            // While the endpoint is known to be down, replaying would only fail batch by batch
             offline_queue_process(send_compressed_batch_callback, context);
         }
+        next_pass_ms = timing_monotonic_ms() + OFFLINE_QUEUE_PROCESS_INTERVAL_S * 1000ULL;
     }
 
+    network_monitor_destroy(monitor);
     printf("Offline queue processor thread finished.\n");
     return NULL;
 }
 
-// This is the callback that the OfflineQueue will use to send data.
-// It delegates to the private send_http_post function.
-static bool send_compressed_batch_callback(const void* data, size_t size, void* user_context) {
+// Async-signal-safe: an atomic OR and a write(2). Reason 0 only wakes the offline processor.
+static void trigger_replay(SenderContext* context, unsigned int reason) {
+    atomic_fetch_or(&context->replay_triggers, reason);
+    uint64_t one = 1;
+    ssize_t written = write(context->replay_event_fd, &one, sizeof(one));
+    (void)written; // Only fails if the counter is saturated, and then the reader is awake anyway
+}
+
+// Waits up to `timeout_ms` for a trigger and returns the REPLAY_TRIGGER_* bits collected
+static unsigned int wait_for_replay_trigger(SenderContext* context, NetworkMonitor* monitor, int timeout_ms) {
+    struct pollfd fds[2] = {
+        { .fd = context->replay_event_fd, .events = POLLIN },
+        { .fd = network_monitor_fd(monitor), .events = POLLIN }, // poll() skips it while -1
+    };
+    if (poll(fds, 2, timeout_ms) <= 0) return 0;
+
+    if ((fds[1].revents & POLLIN) && network_monitor_read(monitor)) {
+        wait_for_network_to_settle(context, monitor);
+        atomic_fetch_or(&context->replay_triggers, REPLAY_TRIGGER_NETWORK);
+    }
+    if (fds[0].revents & POLLIN) {
+        uint64_t count;
+        ssize_t consumed = read(context->replay_event_fd, &count, sizeof(count));
+        (void)consumed; // Reading resets the counter; the trigger bits are what matter
+    }
+    return atomic_exchange(&context->replay_triggers, 0);
+}
+
+// Swallows the rest of the burst so the interface has its address and routes
+// before the first request; another trigger or shutdown cuts the wait short
+static void wait_for_network_to_settle(SenderContext* context, NetworkMonitor* monitor) {
+    unsigned long long now_ms = timing_monotonic_ms();
+    unsigned long long settled_at_ms = now_ms + REPLAY_NETWORK_SETTLE_MS;
+    while (context->is_running && now_ms < settled_at_ms) {
+        struct pollfd fds[2] = {
+            { .fd = context->replay_event_fd, .events = POLLIN },
+            { .fd = network_monitor_fd(monitor), .events = POLLIN },
+        };
+        if (poll(fds, 2, (int)(settled_at_ms - now_ms)) > 0) {
+            if (fds[0].revents & POLLIN) return;
+            network_monitor_read(monitor);
+        }
+        now_ms = timing_monotonic_ms();
+    }
+}
+
+// Sender thread: cuts an open circuit short once the offline processor has seen the network return
+static void apply_expedited_probe(SenderContext* context) {
+    if (atomic_exchange(&context->expedite_probe, false)) {
+        circuit_breaker_expedite(&context->breaker, timing_monotonic_ms());
+        atomic_store(&context->uplink_retry_at_ms, circuit_breaker_retry_at(&context->breaker));
+    }
+}
+
+static bool lane_scheduler_backlog_turn(const LaneScheduler* scheduler, bool live_pending) {
+    if (!live_pending) return true;
+    unsigned long long total = scheduler->live_bytes + scheduler->backlog_bytes;
+    return scheduler->backlog_bytes * 100 < (unsigned long long)scheduler->backlog_share_percent * total;
+}
+
+static void lane_scheduler_account(LaneScheduler* scheduler, size_t live_bytes, size_t backlog_bytes) {
+    scheduler->live_bytes += live_bytes;
+    scheduler->backlog_bytes += backlog_bytes;
+    if (scheduler->live_bytes + scheduler->backlog_bytes > LANE_ACCOUNTING_WINDOW_BYTES) {
+        scheduler->live_bytes /= 2;
+        scheduler->backlog_bytes /= 2;
+    }
+}
+
+static bool backlog_lane_is_pending(BacklogLane* lane) {
+    pthread_mutex_lock(&lane->mutex);
+    bool pending = lane->pending && !lane->in_progress;
+    pthread_mutex_unlock(&lane->mutex);
+    return pending;
+}
+
+// Reports the outcome of the replay batch back to the waiting offline processor
+static void backlog_lane_finish(BacklogLane* lane, OfflineSendResult result) {
+    pthread_mutex_lock(&lane->mutex);
+    lane->result = result;
+    lane->done = true;
+    lane->in_progress = false;
+    lane->pending = false;
+    pthread_cond_broadcast(&lane->done_cond);
+    pthread_mutex_unlock(&lane->mutex);
+}
+
+// This is the callback that the OfflineQueue uses to send data. Instead of
+// competing with live data for the uplink, it places the batch in the backlog
+// lane and waits for the sender thread to schedule it.
+static OfflineSendResult send_compressed_batch_callback(const void* data, size_t size, void* user_context) {
     SenderContext* context = (SenderContext*)user_context;
-    
-    char url[256];
-    snprintf(url, sizeof(url), "%s/api/v2/write?org=%s&bucket=%s&precision=s",
-             context->influxdb_context.url,
-             context->influxdb_context.org, context->influxdb_context.bucket);
+    BacklogLane* lane = &context->backlog_lane;
 
-    char auth_header[512];
-    snprintf(auth_header, sizeof(auth_header), "Authorization: Token %s", context->influxdb_context.token);
+    pthread_mutex_lock(&lane->mutex);
+    if (!context->is_running) {
+        pthread_mutex_unlock(&lane->mutex);
+        return OFFLINE_SEND_FAILED;
+    }
+    lane->data = data;
+    lane->size = size;
+    lane->done = false;
+    lane->result = OFFLINE_SEND_FAILED;
+    lane->pending = true;
+    pthread_mutex_unlock(&lane->mutex);
 
-    struct curl_slist *headers = NULL;
-    headers = curl_slist_append(headers, auth_header);
-    headers = curl_slist_append(headers, "Content-Type: text/plain; charset=utf-8");
-    headers = curl_slist_append(headers, "Content-Encoding: gzip");
+    SenderMetricsShard* metrics = sender_metrics_shard(context->metrics, SENDER_SHARD_OFFLINE);
+    metrics_counter_add(&metrics->backlog_batches_queued, 1);
+    unsigned long long queued_at_ms = timing_monotonic_ms();
+    http_transport_wakeup(context->transport);
 
-    bool success = send_http_post(context, url, headers, data, (long)size);
+    pthread_mutex_lock(&lane->mutex);
+    // Never return while a request still reads from `data`
+    while (!lane->done && (context->is_running || lane->in_progress)) {
+        pthread_cond_wait(&lane->done_cond, &lane->mutex);
+    }
+    OfflineSendResult result = lane->done ? lane->result : OFFLINE_SEND_FAILED;
+    lane->pending = false; // Withdraw the batch if it was never scheduled
+    pthread_mutex_unlock(&lane->mutex);
 
-    curl_slist_free_all(headers);
-    return success;
+    metrics_histogram_record(&metrics->backlog_wait_ms, timing_monotonic_ms() - queued_at_ms);
+    return result;
 }
 
-// A wrapper around the core curl logic for sending a single line protocol string.
-static bool send_line_protocol(SenderContext* context, const char* line_protocol) {
-    char url[256];
-    snprintf(url, sizeof(url), "%s/api/v2/write?org=%s&bucket=%s&precision=s",
-             context->influxdb_context.url,
-             context->influxdb_context.org, context->influxdb_context.bucket);
+static void start_ready_requests(SenderContext* context, LiveBatch* batch) {
+    start_due_retries(context);
+
+    while (http_transport_has_capacity(context->transport)) {
+        live_batch_fill(context, batch);
+        bool live_ready = live_batch_is_ready(batch, &context->batch_config);
+
+        // Live data always goes first; the backlog only gets a slot when no live batch
+        // is due or when it has fallen below its configured share of the uplink.
+        bool backlog_turn = backlog_lane_is_pending(&context->backlog_lane) &&
+                            lane_scheduler_backlog_turn(&context->scheduler, live_ready);
+        if (!backlog_turn && !live_ready) {
+            break;
+        }
+        if (!acquire_request(context)) {
+            break; // Every request buffer is parked for a retry
+        }
 
-    char auth_header[512];
-    snprintf(auth_header, sizeof(auth_header), "Authorization: Token %s", context->influxdb_context.token);
+        // Checked here rather than once per loop: the flag is raised before the replay
+        // batch is offered, so it is always seen by the time that batch gets here
+        apply_expedited_probe(context);
+        if (!circuit_breaker_allow(&context->breaker, timing_monotonic_ms())) {
+            // Endpoint is down: keep the data on disk instead of spending radio time on it
+            if (backlog_turn) {
+                metrics_counter_add(&sender_metrics_shard(context->metrics, SENDER_SHARD_SENDER)->backlog_batches_failed, 1);
+                backlog_lane_finish(&context->backlog_lane, OFFLINE_SEND_FAILED);
+            } else {
+                save_points_to_offline_log(context, batch->points, batch->count);
+                batch->count = 0;
+                batch->bytes = 0;
+            }
+        } else if (backlog_turn) {
+            start_backlog_request(context);
+        } else {
+            start_live_request(context, batch);
+        }
+    }
+}
 
-    struct curl_slist *headers = NULL;
-    headers = curl_slist_append(headers, auth_header);
-    headers = curl_slist_append(headers, "Content-Type: text/plain; charset=utf-8");
+// Re-sends parked live requests whose backoff has expired
+static void start_due_retries(SenderContext* context) {
+    unsigned long long now = timing_monotonic_ms();
+    bool circuit_open = circuit_breaker_retry_at(&context->breaker) > now;
 
-    bool success = send_http_post(context, url, headers, line_protocol, 0); // 0 post_size for null-terminated string
+    for (size_t i = 0; i < context->max_in_flight; i++) {
+        SenderRequest* request = &context->requests[i];
+        if (!request->awaiting_retry) continue;
 
-    curl_slist_free_all(headers);
-    return success;
+        if (circuit_open) {
+            give_up_request(context, request);
+            continue;
+        }
+        if (now < request->retry_at_ms) continue;
+        if (!http_transport_has_capacity(context->transport)) return;
+        if (!circuit_breaker_allow(&context->breaker, now)) {
+            give_up_request(context, request);
+            continue;
+        }
+
+        request->awaiting_retry = false;
+        if (!http_transport_post(context->transport, request->compressed, request->compressed_size, request)) {
+            circuit_breaker_record_failure(&context->breaker, now, 0);
+            give_up_request(context, request);
+            continue;
+        }
+        record_request_started(context);
+        metrics_counter_add(&sender_metrics_shard(context->metrics, SENDER_SHARD_SENDER)->retries, 1);
+    }
 }
 
-// The core, generic HTTP POST function using CURL.
-static bool send_http_post(const SenderContext* context, const char* url, struct curl_slist* headers, const void* post_data, long post_size) {
-    CURL* curl_handle = curl_easy_init();
-    if (!curl_handle) {
-        fprintf(stderr, "Failed to initialize CURL\n");
+static void record_request_started(SenderContext* context) {
+    SenderMetricsShard* metrics = sender_metrics_shard(context->metrics, SENDER_SHARD_SENDER);
+    metrics_counter_add(&metrics->requests_started, 1);
+    metrics_histogram_record(&metrics->in_flight_depth, http_transport_in_flight(context->transport));
+}
+
+// Writes a live request's body to the offline log and frees the request
+static void give_up_request(SenderContext* context, SenderRequest* request) {
+    fprintf(stderr, "Sender: Failed to send batch of %zu points, queuing to offline file.\n", request->point_count);
+    offline_queue_add_lines(request->body, request->body_size);
+    metrics_counter_add(&sender_metrics_shard(context->metrics, SENDER_SHARD_SENDER)->points_to_offline,
+                        request->point_count);
+    request->awaiting_retry = false;
+    request->in_use = false;
+}
+
+// How long the event loop may sleep before the forming batch or a parked retry becomes due.
+// A batch can only start with a free request buffer; while every buffer is in flight or
+// parked, the loop sleeps until a completion or the earliest retry instead of spinning.
+static int next_wakeup_ms(SenderContext* context, const LiveBatch* batch) {
+    long wait_ms = SENDER_IDLE_POLL_MS;
+    unsigned long long now = timing_monotonic_ms();
+
+    if (batch->count > 0 && http_transport_has_capacity(context->transport) && acquire_request(context)) {
+        long remaining = (long)context->batch_config.max_delay_ms - live_batch_age_ms(batch);
+        if (remaining < wait_ms) wait_ms = remaining;
+    }
+    for (size_t i = 0; i < context->max_in_flight; i++) {
+        const SenderRequest* request = &context->requests[i];
+        if (request->awaiting_retry) {
+            long remaining = request->retry_at_ms > now ? (long)(request->retry_at_ms - now) : 0;
+            if (remaining < wait_ms) wait_ms = remaining;
+        }
+    }
+    return wait_ms < 0 ? 0 : (int)wait_ms;
+}
+
+static SenderRequest* acquire_request(SenderContext* context) {
+    for (size_t i = 0; i < context->max_in_flight; i++) {
+        if (!context->requests[i].in_use) {
+            return &context->requests[i];
+        }
+    }
+    return NULL;
+}
+
+// Renders the batched records into one newline-separated body, gzipping each line
+// as it is written, and starts the body as a single write. The points are released either way.
+static void start_live_request(SenderContext* context, LiveBatch* batch) {
+    SenderRequest* request = acquire_request(context);
+    size_t count = batch->count;
+    batch->count = 0;
+    batch->bytes = 0;
+    if (!request) {
+        fprintf(stderr, "Sender: no request buffer for %zu points, queuing to offline file.\n", count);
+        save_points_to_offline_log(context, batch->points, count);
+        circuit_breaker_record_failure(&context->breaker, timing_monotonic_ms(), 0);
+        return;
+    }
+
+    gzip_compressor_begin(context->live_compressor, &request->compressed, &request->compressed_capacity);
+    size_t body_size = 0;
+    for (size_t i = 0; i < count; i++) {
+        size_t line_start = body_size;
+        if (!append_point_text(context->render_builder, batch->points[i], &request->body, &body_size,
+                               &request->body_capacity)) {
+            fprintf(stderr, "Sender: no memory for a body of %zu points, queuing to offline file.\n", count);
+            offline_queue_add_lines(request->body, body_size);
+            metrics_counter_add(&sender_metrics_shard(context->metrics, SENDER_SHARD_SENDER)->points_to_offline, i);
+            save_points_to_offline_log(context, batch->points + i, count - i);
+            circuit_breaker_record_failure(&context->breaker, timing_monotonic_ms(), 0);
+            return;
+        }
+        gzip_compressor_append(context->live_compressor, request->body + line_start, body_size - line_start);
+        pooled_buffer_release(&batch->points[i]);
+    }
+    request->lane = SENDER_LANE_LIVE;
+    request->point_count = count;
+    request->body_size = body_size;
+    request->attempt = 0;
+    request->awaiting_retry = false;
+
+    if (gzip_compressor_finish(context->live_compressor, &request->compressed_size) &&
+        http_transport_post(context->transport, request->compressed, request->compressed_size, request)) {
+        request->in_use = true;
+        lane_scheduler_account(&context->scheduler, body_size, 0);
+
+        SenderMetricsShard* metrics = sender_metrics_shard(context->metrics, SENDER_SHARD_SENDER);
+        metrics_counter_add(&metrics->bytes_uncompressed, body_size);
+        metrics_counter_add(&metrics->bytes_compressed, request->compressed_size);
+        metrics_histogram_record(&metrics->batch_points, count);
+        metrics_histogram_record(&metrics->batch_compressed_bytes, request->compressed_size);
+        record_request_started(context);
+        return;
+    }
+
+    fprintf(stderr, "Sender: Failed to start batch of %zu points, queuing to offline file.\n", count);
+    offline_queue_add_lines(request->body, body_size);
+    metrics_counter_add(&sender_metrics_shard(context->metrics, SENDER_SHARD_SENDER)->points_to_offline, count);
+    circuit_breaker_record_failure(&context->breaker, timing_monotonic_ms(), 0);
+}
+
+static void start_backlog_request(SenderContext* context) {
+    BacklogLane* lane = &context->backlog_lane;
+    SenderRequest* request = acquire_request(context);
+    if (!request) return;
+
+    pthread_mutex_lock(&lane->mutex);
+    if (!lane->pending || lane->in_progress) {
+        pthread_mutex_unlock(&lane->mutex);
+        return;
+    }
+    lane->in_progress = true;
+    const void* data = lane->data;
+    size_t size = lane->size;
+    pthread_mutex_unlock(&lane->mutex);
+
+    request->lane = SENDER_LANE_BACKLOG;
+    request->point_count = 0;
+    request->compressed_size = size;
+    request->awaiting_retry = false;
+    if (!http_transport_post(context->transport, data, size, request)) {
+        circuit_breaker_record_failure(&context->breaker, timing_monotonic_ms(), 0);
+        metrics_counter_add(&sender_metrics_shard(context->metrics, SENDER_SHARD_SENDER)->backlog_batches_failed, 1);
+        backlog_lane_finish(lane, OFFLINE_SEND_FAILED);
+        return;
+    }
+    request->in_use = true;
+    lane_scheduler_account(&context->scheduler, 0, size);
+    record_request_started(context);
+}
+
+// Feeds a completed request into the circuit breaker and publishes its state
+static void record_outcome(SenderContext* context, SendOutcome outcome, const HttpResult* result) {
+    if (outcome == SEND_OUTCOME_SUCCESS || outcome == SEND_OUTCOME_PERMANENT) {
+        circuit_breaker_record_success(&context->breaker);
+    } else {
+        // Retry-After comes from the server: never wait longer than the breaker's own limit
+        long retry_after_s = result->retry_after_s > 0 ? result->retry_after_s : 0;
+        long max_wait_s = (long)(context->breaker.max_open_ms / 1000U);
+        if (retry_after_s > max_wait_s) retry_after_s = max_wait_s;
+        circuit_breaker_record_failure(&context->breaker, timing_monotonic_ms(), (unsigned int)retry_after_s * 1000U);
+    }
+    atomic_store(&context->uplink_retry_at_ms, circuit_breaker_retry_at(&context->breaker));
+}
+
+// A rejected body (bad line protocol, too large, unwritable points) fails again on
+// every resend. Any other permanent status, such as a rejected token, a missing
+// bucket or a misrouted proxy, is a configuration problem the data should outlive.
+static bool is_rejected_content(long http_status) {
+    return http_status == 400 || http_status == 413 || http_status == 422;
+}
+
+// Runs on the sender thread from within http_transport_run()
+static void on_request_complete(void* request_context, const HttpResult* result, void* user_context) {
+    SenderContext* context = (SenderContext*)user_context;
+    SenderRequest* request = (SenderRequest*)request_context;
+
+    if (result->curl_code == CURLE_ABORTED_BY_CALLBACK) {
+        // Cancelled at shutdown: says nothing about the endpoint
+        if (request->lane == SENDER_LANE_BACKLOG) {
+            metrics_counter_add(&sender_metrics_shard(context->metrics, SENDER_SHARD_SENDER)->backlog_batches_failed, 1);
+            backlog_lane_finish(&context->backlog_lane, OFFLINE_SEND_FAILED);
+            request->in_use = false;
+        } else {
+            give_up_request(context, request);
+        }
+        return;
+    }
+
+    SendOutcome outcome = send_outcome_classify(result->curl_code, result->http_status, result->retry_after_s);
+    bool uplink_was_failing = context->breaker.state != CIRCUIT_CLOSED || context->breaker.consecutive_failures > 0;
+    record_outcome(context, outcome, result);
+
+    SenderMetricsShard* metrics = sender_metrics_shard(context->metrics, SENDER_SHARD_SENDER);
+    metrics_histogram_record(&metrics->request_rtt_ms, (unsigned long long)(result->total_time_s * 1000.0));
+    metrics_counter_add(outcome == SEND_OUTCOME_SUCCESS ? &metrics->requests_succeeded : &metrics->requests_failed, 1);
+    if (outcome != SEND_OUTCOME_SUCCESS && result->curl_code != CURLE_OK) {
+        fprintf(stderr, "Sender: request #%llu failed (%s): %s\n", result->sequence,
+                send_outcome_string(outcome), curl_easy_strerror(result->curl_code));
+    } else if (outcome != SEND_OUTCOME_SUCCESS) {
+        fprintf(stderr, "Sender: request #%llu failed (%s): HTTP %ld\n", result->sequence,
+                send_outcome_string(outcome), result->http_status);
+    }
+
+    if (request->lane == SENDER_LANE_BACKLOG) {
+        // Rejected replay batches are split up by the offline queue to find the bad lines;
+        // everything else is retried on the next replay pass
+        OfflineSendResult replay_result = OFFLINE_SEND_FAILED;
+        if (outcome == SEND_OUTCOME_SUCCESS) {
+            metrics_counter_add(&metrics->backlog_batches_sent, 1);
+            metrics_counter_add(&metrics->backlog_bytes_sent, request->compressed_size);
+            replay_result = OFFLINE_SEND_OK;
+        } else if (outcome == SEND_OUTCOME_PERMANENT && is_rejected_content(result->http_status)) {
+            metrics_counter_add(&metrics->backlog_batches_rejected, 1);
+            replay_result = OFFLINE_SEND_REJECTED;
+        } else {
+            metrics_counter_add(&metrics->backlog_batches_failed, 1);
+        }
+        backlog_lane_finish(&context->backlog_lane, replay_result);
+        request->in_use = false;
+        return;
+    }
+
+    switch (outcome) {
+        case SEND_OUTCOME_SUCCESS:
+            metrics_counter_add(&metrics->points_sent, request->point_count);
+            request->in_use = false;
+            // The first live write that gets through after failures means the backlog can go now too
+            if (uplink_was_failing) {
+                trigger_replay(context, REPLAY_TRIGGER_UPLINK);
+            }
+            break;
+        case SEND_OUTCOME_PERMANENT:
+            // A rejected body usually holds a few bad lines among good ones. Replay
+            // isolates them, so the batch goes to disk like any other failure.
+            if (is_rejected_content(result->http_status)) {
+                metrics_counter_add(&metrics->points_rejected, request->point_count);
+            }
+            give_up_request(context, request);
+            break;
+        case SEND_OUTCOME_RETRYABLE:
+        case SEND_OUTCOME_THROTTLED:
+        default:
+            // Retry-After is honoured by the circuit breaker, which record_outcome() has
+            // already opened for that long; the open circuit sends the batch to disk here.
+            // Only a bare 429 is left to be retried, on the normal backoff.
+            if (request->attempt >= context->max_retries || !context->is_running ||
+                context->breaker.state == CIRCUIT_OPEN) {
+                give_up_request(context, request);
+                break;
+            }
+            unsigned int delay_ms = backoff_delay_ms(&context->backoff, request->attempt);
+            request->attempt++;
+            request->awaiting_retry = true;
+            request->retry_at_ms = timing_monotonic_ms() + delay_ms;
+            break;
+    }
+}
+
+static bool live_batch_init(LiveBatch* batch, const BatchConfig* config) {
+    memset(batch, 0, sizeof(*batch));
+    batch->points = malloc(config->max_lines * sizeof(*batch->points));
+    return batch->points != NULL;
+}
+
+static void live_batch_free(LiveBatch* batch) {
+    free(batch->points);
+    memset(batch, 0, sizeof(*batch));
+}
+
+// Tops the forming batch up with whatever is queued right now, without blocking
+static void live_batch_fill(SenderContext* context, LiveBatch* batch) {
+    const BatchConfig* config = &context->batch_config;
+    if (batch->count >= config->max_lines || (config->max_bytes > 0 && batch->bytes >= config->max_bytes)) {
+        return;
+    }
+
+    size_t room_bytes = config->max_bytes > 0 ? config->max_bytes - batch->bytes : 0;
+    size_t taken = data_queue_try_dequeue_batch(context->queue, batch->points + batch->count,
+                                                config->max_lines - batch->count, room_bytes);
+    if (taken == 0) return;
+
+    if (batch->count == 0) {
+        clock_gettime(CLOCK_MONOTONIC, &batch->first_point_at);
+    }
+    for (size_t i = batch->count; i < batch->count + taken; i++) {
+        batch->bytes += batch->points[i]->length;
+    }
+    batch->count += taken;
+}
+
+static long live_batch_age_ms(const LiveBatch* batch) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - batch->first_point_at.tv_sec) * 1000L +
+           (now.tv_nsec - batch->first_point_at.tv_nsec) / 1000000L;
+}
+
+// A batch is due once it reaches N lines, B bytes, or T milliseconds after its first point
+static bool live_batch_is_ready(const LiveBatch* batch, const BatchConfig* config) {
+    if (batch->count == 0) return false;
+    return batch->count >= config->max_lines ||
+           (config->max_bytes > 0 && batch->bytes >= config->max_bytes) ||
+           live_batch_age_ms(batch) >= (long)config->max_delay_ms;
+}
+
+// Renders one queued record onto the end of `text`, newline included, growing it as needed.
+// A record that cannot be rendered is reported and skipped; false means out of memory.
+static bool append_point_text(LineProtocolBuilder* builder, const PooledBuffer* point, char** text, size_t* size,
+                              size_t* capacity) {
+    LineProtocolError error = point_record_render(point->data, point->length, builder);
+    if (error != LP_SUCCESS) {
+        fprintf(stderr, "Sender: skipping a point that cannot be rendered: %s\n", lp_error_string(error));
+        return true;
+    }
+
+    size_t length = lp_get_length(builder);
+    if (*size + length + 1 > *capacity) {
+        size_t new_capacity = *capacity > 0 ? *capacity : 4096;
+        while (*size + length + 1 > new_capacity) new_capacity *= 2;
+        char* new_text = realloc(*text, new_capacity);
+        if (!new_text) return false;
+        *text = new_text;
+        *capacity = new_capacity;
+    }
+    memcpy(*text + *size, lp_view(builder), length);
+    (*text)[*size + length] = '\n';
+    *size += length + 1;
+    return true;
+}
+
+// Only text goes to disk: records are meaningless to another process
+static void write_points_to_offline_log(LineProtocolBuilder* builder, PooledBuffer* const points[], size_t count) {
+    char* text = NULL;
+    size_t size = 0;
+    size_t capacity = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (!append_point_text(builder, points[i], &text, &size, &capacity)) {
+            fprintf(stderr, "Sender: no memory to render %zu points for the offline file.\n", count - i);
+            break;
+        }
+    }
+    offline_queue_add_lines(text, size);
+    free(text);
+}
+
+static void save_points_to_offline_log(SenderContext* context, PooledBuffer* points[], size_t count) {
+    metrics_counter_add(&sender_metrics_shard(context->metrics, SENDER_SHARD_SENDER)->points_to_offline, count);
+    write_points_to_offline_log(context->render_builder, points, count);
+    for (size_t i = 0; i < count; i++) {
+        pooled_buffer_release(&points[i]);
+    }
+}
+
+// Called after the queue has been shut down, so the dequeue never blocks
+static void drain_queue_to_offline_log(SenderContext* context, LiveBatch* batch) {
+    size_t count;
+    while ((count = data_queue_try_dequeue_batch(context->queue, batch->points,
+                                                 context->batch_config.max_lines, 0)) > 0) {
+        save_points_to_offline_log(context, batch->points, count);
+        printf("Sender: saved %zu unsent points to offline file.\n", count);
+    }
+}
+
+static void share_lock_callback(CURL* handle, curl_lock_data data, curl_lock_access access, void* userptr) {
+    (void)handle;
+    (void)access;
+    SenderContext* context = (SenderContext*)userptr;
+    pthread_mutex_lock(&context->share_locks[data]);
+}
+
+static void share_unlock_callback(CURL* handle, curl_lock_data data, void* userptr) {
+    (void)handle;
+    SenderContext* context = (SenderContext*)userptr;
+    pthread_mutex_unlock(&context->share_locks[data]);
+}
+
+static bool init_transport(SenderContext* context) {
+    context->replay_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (context->replay_event_fd < 0) {
+        perror("Failed to create replay trigger");
+        return false;
+    }
+
+    context->max_in_flight = env_get_size("SENDER_MAX_IN_FLIGHT", SENDER_DEFAULT_MAX_IN_FLIGHT);
+    if (context->max_in_flight == 0) {
+        context->max_in_flight = 1;
+    }
+
+    context->requests = calloc(context->max_in_flight, sizeof(SenderRequest));
+    if (!context->requests) {
+        perror("Failed to allocate sender requests");
+        return false;
+    }
+
+    context->gzip_level = gzip_level_from_string(getenv("SENDER_GZIP_LEVEL"));
+    context->live_compressor = gzip_compressor_create(context->gzip_level);
+    context->render_builder = lp_builder_create_default();
+    context->metrics = sender_metrics_create();
+    if (!context->live_compressor || !context->render_builder || !context->metrics) {
+        free_transport(context);
+        return false;
+    }
+
+    HttpTransportConfig config = {
+        .url = context->influxdb_context.write_url,
+        .headers = context->influxdb_context.gzip_headers,
+        .max_in_flight = context->max_in_flight,
+        .connect_timeout_ms = SENDER_CONNECT_TIMEOUT_MS,
+        .request_timeout_ms = (long)env_get_size("SENDER_REQUEST_TIMEOUT_MS", SENDER_DEFAULT_REQUEST_TIMEOUT_MS),
+        .dns_cache_timeout_s = SENDER_DNS_CACHE_TIMEOUT_S,
+        .share = context->curl_share,
+    };
+    context->transport = http_transport_create(&config, on_request_complete, context);
+    if (!context->transport) {
+        free_transport(context);
+        return false;
+    }
+
+    printf("Sender transport: up to %zu requests in flight, %ld ms deadline each, gzip level %d.\n",
+           config.max_in_flight, config.request_timeout_ms, context->gzip_level);
+    return true;
+}
+
+// Only called once the sender thread has stopped, so no request is in flight
+static void free_transport(SenderContext* context) {
+    http_transport_destroy(context->transport);
+    context->transport = NULL;
+    for (size_t i = 0; context->requests && i < context->max_in_flight; i++) {
+        free(context->requests[i].body);
+        free(context->requests[i].compressed);
+    }
+    free(context->requests);
+    context->requests = NULL;
+    gzip_compressor_destroy(context->live_compressor);
+    context->live_compressor = NULL;
+    lp_builder_destroy(context->render_builder);
+    context->render_builder = NULL;
+    sender_metrics_destroy(context->metrics);
+    context->metrics = NULL;
+    if (context->replay_event_fd >= 0) {
+        close(context->replay_event_fd);
+        context->replay_event_fd = -1;
+    }
+}
+
+// Builds the write URL, header lists and the shared caches once, instead of per request
+static bool init_request_state(SenderContext* context) {
+    InfluxDBContext* influx = &context->influxdb_context;
+
+    if (curl_global_init(CURL_GLOBAL_DEFAULT) != CURLE_OK) {
+        fprintf(stderr, "curl_global_init failed\n");
         return false;
     }
 
-    struct MemoryStruct chunk = { .memory = malloc(1), .size = 0 };
-    if (!chunk.memory) {
-        fprintf(stderr, "Failed to allocate memory for CURL response\n");
-        curl_easy_cleanup(curl_handle);
+    const char* url_format = "%s/api/v2/write?org=%s&bucket=%s&precision=s";
+    int url_length = snprintf(NULL, 0, url_format, influx->url, influx->org, influx->bucket);
+    influx->write_url = malloc((size_t)url_length + 1);
+    if (!influx->write_url) {
+        free_request_state(context);
         return false;
     }
+    snprintf(influx->write_url, (size_t)url_length + 1, url_format, influx->url, influx->org, influx->bucket);
 
-    curl_easy_setopt(curl_handle, CURLOPT_URL, url);
-    curl_easy_setopt(curl_handle, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
-    curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, (void *)&chunk);
-    curl_easy_setopt(curl_handle, CURLOPT_POSTFIELDS, post_data);
-    if (post_size > 0) { // For binary data
-        curl_easy_setopt(curl_handle, CURLOPT_POSTFIELDSIZE, post_size);
+    int auth_length = snprintf(NULL, 0, "Authorization: Token %s", influx->token);
+    char* auth_header = malloc((size_t)auth_length + 1);
+    if (!auth_header) {
+        free_request_state(context);
+        return false;
     }
-    curl_easy_setopt(curl_handle, CURLOPT_CONNECTTIMEOUT, 10L);
-    curl_easy_setopt(curl_handle, CURLOPT_TIMEOUT, 20L);
+    snprintf(auth_header, (size_t)auth_length + 1, "Authorization: Token %s", influx->token);
 
-    CURLcode result = curl_easy_perform(curl_handle);
-    bool success = (result == CURLE_OK);
+    // curl_slist_append copies the strings, so the auth header can be freed right away
+    influx->gzip_headers = curl_slist_append(NULL, auth_header);
+    influx->gzip_headers = curl_slist_append(influx->gzip_headers, "Content-Type: text/plain; charset=utf-8");
+    influx->gzip_headers = curl_slist_append(influx->gzip_headers, "Content-Encoding: gzip");
+    free(auth_header);
+    if (!influx->gzip_headers) {
+        free_request_state(context);
+        return false;
+    }
 
-    if (!success) {
-        fprintf(stderr, "CURL error: %s\n", curl_easy_strerror(result));
+    // Sharing is an optimization only: without it each handle keeps its own caches.
+    // Connections are pooled by the transport's multi handle, so they are not shared here.
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+        pthread_mutex_init(&context->share_locks[i], NULL);
     }
+    context->curl_share = curl_share_init();
+    if (context->curl_share) {
+        curl_share_setopt(context->curl_share, CURLSHOPT_LOCKFUNC, share_lock_callback);
+        curl_share_setopt(context->curl_share, CURLSHOPT_UNLOCKFUNC, share_unlock_callback);
+        curl_share_setopt(context->curl_share, CURLSHOPT_USERDATA, context);
+        curl_share_setopt(context->curl_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(context->curl_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    }
+
+    return true;
+}
 
-    curl_easy_cleanup(curl_handle);
-    free(chunk.memory);
+static void free_request_state(SenderContext* context) {
+    InfluxDBContext* influx = &context->influxdb_context;
 
-    return success;
-}
\ No newline at end of file
+    if (context->curl_share) {
+        curl_share_cleanup(context->curl_share);
+        context->curl_share = NULL;
+        for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+            pthread_mutex_destroy(&context->share_locks[i]);
+        }
+    }
+    curl_slist_free_all(influx->gzip_headers);
+    free(influx->write_url);
+    influx->gzip_headers = NULL;
+    influx->write_url = NULL;
+    curl_global_cleanup();
+}
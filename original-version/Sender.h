@@ -1,6 +1,9 @@
 #ifndef SENDER_H
 #define SENDER_H
 
+#include "DataQueue.h"
+#include "BufferPool.h"
+
 // Opaque handle to the sender module
 typedef struct SenderContext SenderContext;
 
@@ -25,15 +28,69 @@ SenderContext* sender_create_from_env(void);
 void sender_destroy(SenderContext* context);
 
 /**
- * @brief Submits a measurement string to the sending queue.
+ * @brief Acquires an empty buffer from the sender's pool.
+ *
+ * Producers encode a point record (PointRecord.h) straight into this buffer
+ * and hand it back with sender_submit_buffer(); line protocol is only rendered
+ * when the point is sent or written to disk. Buffers hold POINT_RECORD_MAX_SIZE
+ * bytes. Returns NULL if no buffer could be obtained.
+ *
+ * @param context The sender context.
+ * @return An empty buffer owned by the caller, or NULL.
+ */
+PooledBuffer* sender_acquire_buffer(SenderContext* context);
+
+/**
+ * @brief Submits a filled buffer to the sending queue, transferring ownership.
+ *
+ * `buffer->data` must hold a point record of `buffer->length` bytes, as
+ * written by point_record_encode(). The sender takes ownership and sets
+ * `*buffer` to NULL.
+ *
+ * @param context The sender context.
+ * @param buffer Address of the caller's buffer pointer.
+ */
+void sender_submit_buffer(SenderContext* context, PooledBuffer** buffer);
+
+/**
+ * @brief Starts replaying the offline backlog now instead of at the next timer pass.
+ *
+ * Replay also starts by itself when an interface comes up or a default route
+ * appears, and when a write succeeds after failures; the periodic pass is only
+ * a fallback. An open circuit breaker probes the endpoint right away instead
+ * of waiting out its open period. Async-signal-safe, so it may be called from
+ * a signal handler.
+ *
+ * @param context The sender context.
+ */
+void sender_request_replay(SenderContext* context);
+
+/**
+ * @brief Retrieves the live send queue counters (occupancy and overflow actions).
+ *
+ * The queue is bounded by SENDER_QUEUE_MAX_ITEMS / SENDER_QUEUE_MAX_BYTES and
+ * overflows according to SENDER_QUEUE_OVERFLOW_POLICY
+ * (block, drop_oldest, drop_newest or spill).
+ *
+ * @param context The sender context.
+ * @param stats Output structure.
+ */
+void sender_get_queue_stats(SenderContext* context, DataQueueStats* stats);
+
+/**
+ * @brief Formats a snapshot of the sender metrics as a single-line JSON object.
  *
- * This function is the main interface for other threads to send data. It adds the
- * data to a thread-safe queue to be processed by the sender thread.
- * This function is non-blocking and makes a copy of the provided data.
+ * Covers point counts (submitted, sent, spilled, dropped, sent to disk), bytes
+ * before and after compression, request counts, retries, in-flight depth,
+ * circuit breaker state, offline backlog size and histograms of request RTT,
+ * batch size and in-flight depth. The same snapshot is written to
+ * SENDER_METRICS_FILE every SENDER_METRICS_INTERVAL_S seconds.
  *
  * @param context The sender context.
- * @param line_protocol The null-terminated string (in line protocol format) to be sent.
+ * @param out Output buffer (16 KiB is always enough).
+ * @param capacity Size of `out`.
+ * @return Number of characters written, or -1 if the snapshot did not fit.
  */
-void sender_submit(SenderContext* context, const char* line_protocol);
+int sender_get_metrics_json(SenderContext* context, char* out, size_t capacity);
 
 #endif // SENDER_H
\ No newline at end of file
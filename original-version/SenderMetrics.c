@@ -0,0 +1,116 @@
+#include "SenderMetrics.h"
+#include "TimingUtils.h"
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Appends to a fixed buffer; once anything fails to fit, the whole snapshot is rejected
+typedef struct {
+    char* out;
+    size_t capacity;
+    size_t length;
+    bool overflow;
+} JsonOutput;
+
+static void json_append(JsonOutput* json, const char* format, ...) {
+    if (json->overflow) return;
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(json->out + json->length, json->capacity - json->length, format, args);
+    va_end(args);
+    if (written < 0 || (size_t)written >= json->capacity - json->length) {
+        json->overflow = true;
+        return;
+    }
+    json->length += (size_t)written;
+}
+
+static void json_append_histogram(JsonOutput* json, const char* name, const SenderMetrics* metrics,
+                                  size_t offset) {
+    MetricsHistogramSnapshot snapshot;
+    memset(&snapshot, 0, sizeof(snapshot));
+    for (int i = 0; i < SENDER_SHARD_COUNT; i++) {
+        const char* shard = (const char*)&metrics->shards[i];
+        metrics_histogram_collect((const MetricsHistogram*)(shard + offset), &snapshot);
+    }
+
+    json_append(json, ",\"%s\":", name);
+    if (json->overflow) return;
+    int written = metrics_histogram_format_json(&snapshot, json->out + json->length, json->capacity - json->length);
+    if (written < 0) {
+        json->overflow = true;
+        return;
+    }
+    json->length += (size_t)written;
+}
+
+static unsigned long long sum_counter(const SenderMetrics* metrics, size_t offset) {
+    unsigned long long total = 0;
+    for (int i = 0; i < SENDER_SHARD_COUNT; i++) {
+        const char* shard = (const char*)&metrics->shards[i];
+        total += metrics_counter_read((const MetricsCounter*)(shard + offset));
+    }
+    return total;
+}
+
+#define COUNTER(name) sum_counter(metrics, offsetof(SenderMetricsShard, name))
+#define HISTOGRAM(json, name) json_append_histogram(json, #name, metrics, offsetof(SenderMetricsShard, name))
+
+SenderMetrics* sender_metrics_create(void) {
+    size_t size = (sizeof(SenderMetrics) + METRICS_CACHE_LINE - 1) / METRICS_CACHE_LINE * METRICS_CACHE_LINE;
+    SenderMetrics* metrics = aligned_alloc(METRICS_CACHE_LINE, size);
+    if (!metrics) {
+        perror("Failed to allocate sender metrics");
+        return NULL;
+    }
+    memset(metrics, 0, size);
+    metrics->started_at_ms = timing_monotonic_ms();
+    return metrics;
+}
+
+void sender_metrics_destroy(SenderMetrics* metrics) {
+    free(metrics);
+}
+
+int sender_metrics_format_json(const SenderMetrics* metrics, const DataQueueStats* queue_stats,
+                               unsigned long long offline_bytes, char* out, size_t capacity) {
+    JsonOutput json = { .out = out, .capacity = capacity };
+
+    unsigned long long bytes_uncompressed = COUNTER(bytes_uncompressed);
+    unsigned long long bytes_compressed = COUNTER(bytes_compressed);
+    long long breaker_state = metrics_gauge_read(&metrics->breaker_state);
+
+    json_append(&json, "{\"uptime_ms\":%llu", timing_monotonic_ms() - metrics->started_at_ms);
+    json_append(&json, ",\"points\":{\"submitted\":%llu,\"sent\":%llu,\"to_offline\":%llu,\"rejected\":%llu"
+                       ",\"spilled\":%llu,\"dropped_oldest\":%llu,\"dropped_newest\":%llu}",
+                COUNTER(points_submitted), COUNTER(points_sent), COUNTER(points_to_offline),
+                COUNTER(points_rejected), queue_stats->spilled, queue_stats->dropped_oldest,
+                queue_stats->dropped_newest);
+    json_append(&json, ",\"queue\":{\"items\":%zu,\"bytes\":%zu,\"blocked\":%llu}",
+                queue_stats->current_items, queue_stats->current_bytes, queue_stats->blocked);
+    json_append(&json, ",\"bytes\":{\"uncompressed\":%llu,\"compressed\":%llu,\"ratio\":%.3f}",
+                bytes_uncompressed, bytes_compressed,
+                bytes_compressed > 0 ? (double)bytes_uncompressed / (double)bytes_compressed : 0.0);
+    json_append(&json, ",\"requests\":{\"started\":%llu,\"succeeded\":%llu,\"failed\":%llu,\"retries\":%llu"
+                       ",\"in_flight\":%lld,\"awaiting_retry\":%lld}",
+                COUNTER(requests_started), COUNTER(requests_succeeded), COUNTER(requests_failed),
+                COUNTER(retries), metrics_gauge_read(&metrics->in_flight),
+                metrics_gauge_read(&metrics->awaiting_retry));
+    json_append(&json, ",\"breaker\":{\"state\":\"%s\",\"trips\":%lld,\"retry_in_ms\":%lld}",
+                circuit_state_string((CircuitState)breaker_state), metrics_gauge_read(&metrics->breaker_trips),
+                metrics_gauge_read(&metrics->uplink_retry_in_ms));
+    json_append(&json, ",\"backlog\":{\"offline_bytes\":%llu,\"batches_queued\":%llu,\"batches_sent\":%llu"
+                       ",\"batches_failed\":%llu,\"batches_rejected\":%llu,\"bytes_sent\":%llu}",
+                offline_bytes, COUNTER(backlog_batches_queued), COUNTER(backlog_batches_sent),
+                COUNTER(backlog_batches_failed), COUNTER(backlog_batches_rejected), COUNTER(backlog_bytes_sent));
+    HISTOGRAM(&json, request_rtt_ms);
+    HISTOGRAM(&json, batch_points);
+    HISTOGRAM(&json, batch_compressed_bytes);
+    HISTOGRAM(&json, in_flight_depth);
+    HISTOGRAM(&json, backlog_wait_ms);
+    json_append(&json, "}");
+
+    return json.overflow ? -1 : (int)json.length;
+}
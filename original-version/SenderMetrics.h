@@ -0,0 +1,90 @@
+#ifndef SENDER_METRICS_H
+#define SENDER_METRICS_H
+
+/**
+ * @file SenderMetrics.h
+ * @brief Throughput, latency and backlog metrics of the InfluxDB sender.
+ *
+ * Each thread that touches the sender records into its own shard, so no two
+ * threads ever write the same cache line. A snapshot adds the shards up and
+ * is exported as one JSON object.
+ */
+
+#include "Metrics.h"
+#include "DataQueue.h"
+#include "RetryPolicy.h"
+
+typedef enum {
+    SENDER_SHARD_PRODUCER,  // Callers of sender_submit*()
+    SENDER_SHARD_SENDER,    // Sender thread (event loop and completions)
+    SENDER_SHARD_OFFLINE,   // Offline processor thread
+    SENDER_SHARD_COUNT
+} SenderMetricsShardId;
+
+typedef struct {
+    _Alignas(METRICS_CACHE_LINE) MetricsCounter points_submitted;
+    MetricsCounter points_sent;              // Live points acknowledged by the server
+    MetricsCounter points_to_offline;        // Live points written to the offline log (queue spills excluded)
+    MetricsCounter points_rejected;          // Live points in batches refused for their content (then sent to disk)
+    MetricsCounter bytes_uncompressed;       // Live line protocol handed to the compressor
+    MetricsCounter bytes_compressed;         // Live gzip bytes produced from it
+    MetricsCounter requests_started;         // HTTP writes started, retries included
+    MetricsCounter requests_succeeded;
+    MetricsCounter requests_failed;          // Any non-2xx or transport error
+    MetricsCounter retries;
+    MetricsCounter backlog_batches_queued;   // Replay batches handed to the sender
+    MetricsCounter backlog_batches_sent;
+    MetricsCounter backlog_batches_failed;
+    MetricsCounter backlog_batches_rejected;
+    MetricsCounter backlog_bytes_sent;
+    MetricsHistogram request_rtt_ms;         // Completed requests, from libcurl's total time
+    MetricsHistogram batch_points;           // Points per live write
+    MetricsHistogram batch_compressed_bytes; // Body size per live write
+    MetricsHistogram in_flight_depth;        // Requests in flight right after each start
+    MetricsHistogram backlog_wait_ms;        // Time a replay batch waited for its result
+} SenderMetricsShard;
+
+typedef struct {
+    SenderMetricsShard shards[SENDER_SHARD_COUNT];
+
+    // Gauges published by the sender thread
+    MetricsGauge in_flight;
+    MetricsGauge awaiting_retry;
+    MetricsGauge breaker_state;              // CircuitState
+    MetricsGauge breaker_trips;
+    MetricsGauge uplink_retry_in_ms;         // Time until the open circuit lets a probe through
+
+    unsigned long long started_at_ms;
+} SenderMetrics;
+
+/**
+ * @brief Allocates zeroed, cache-line aligned metrics.
+ * @return The metrics, or NULL on allocation failure. Free with sender_metrics_destroy().
+ */
+SenderMetrics* sender_metrics_create(void);
+
+/**
+ * @brief Frees metrics created by sender_metrics_create().
+ */
+void sender_metrics_destroy(SenderMetrics* metrics);
+
+/**
+ * @brief Returns the shard the calling thread records into.
+ */
+static inline SenderMetricsShard* sender_metrics_shard(SenderMetrics* metrics, SenderMetricsShardId id) {
+    return &metrics->shards[id];
+}
+
+/**
+ * @brief Formats a snapshot of the metrics as a single-line JSON object.
+ * @param metrics The metrics.
+ * @param queue_stats Current live queue statistics.
+ * @param offline_bytes Current size of the offline log in bytes.
+ * @param out Output buffer.
+ * @param capacity Size of `out`.
+ * @return Number of characters written (excluding the terminator), or -1 if it did not fit.
+ */
+int sender_metrics_format_json(const SenderMetrics* metrics, const DataQueueStats* queue_stats,
+                               unsigned long long offline_bytes, char* out, size_t capacity);
+
+#endif // SENDER_METRICS_H
@@ -0,0 +1,251 @@
+#include "Sink.h"
+#include "DataQueue.h"
+#include "RetryPolicy.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define SINK_BUFFER_CAPACITY 512
+#define SINK_BUFFER_LARGE_CAPACITY 4096
+#define SINK_BUFFER_POOL_SIZE 128
+
+struct SinkWorker {
+    const SinkOps* ops;
+    void* state;
+    SinkWorkerConfig config;
+    BufferPool* pool;
+    DataQueue* queue;
+    PooledBuffer** batch;
+    BackoffPolicy backoff;
+    unsigned int consecutive_failures;
+
+    pthread_t thread_id;
+    volatile bool is_running;
+    pthread_mutex_t mutex;     // Protects stats and the backoff wait
+    pthread_cond_t stop_cond;
+    SinkStats stats;
+};
+
+// --- Private Function Prototypes ---
+static void* sink_worker_thread_function(void* arg);
+static void deliver_batch(SinkWorker* worker, size_t count);
+static bool wait_for_retry(SinkWorker* worker, unsigned int delay_ms);
+
+// --- Public Functions ---
+
+SinkWorker* sink_worker_create(const SinkOps* ops, void* state, const SinkWorkerConfig* config) {
+    if (!ops || !ops->encode || !ops->deliver || !config) {
+        if (ops && ops->destroy) ops->destroy(state);
+        return NULL;
+    }
+
+    SinkWorker* worker = calloc(1, sizeof(SinkWorker));
+    if (!worker) {
+        perror("Failed to allocate SinkWorker");
+        if (ops->destroy) ops->destroy(state);
+        return NULL;
+    }
+    worker->ops = ops;
+    worker->state = state;
+    worker->config = *config;
+    if (worker->config.batch_max_items == 0) {
+        worker->config.batch_max_items = 1;
+    }
+
+    worker->pool = buffer_pool_create(SINK_BUFFER_CAPACITY, SINK_BUFFER_POOL_SIZE);
+    worker->queue = worker->pool ? data_queue_create(worker->pool) : NULL;
+    worker->batch = malloc(worker->config.batch_max_items * sizeof(*worker->batch));
+    if (!worker->pool || !worker->queue || !worker->batch) {
+        fprintf(stderr, "Sink %s: failed to allocate queue.\n", ops->name);
+        data_queue_destroy(worker->queue);
+        buffer_pool_destroy(worker->pool);
+        free(worker->batch);
+        if (ops->destroy) ops->destroy(state);
+        free(worker);
+        return NULL;
+    }
+
+    // A sink must never hold the publisher up, so a full queue sheds its oldest records
+    data_queue_set_overflow_policy(worker->queue, worker->config.queue_max_items, 0,
+                                   DATA_QUEUE_OVERFLOW_DROP_OLDEST, NULL, NULL);
+    backoff_policy_init(&worker->backoff, worker->config.retry_base_ms, worker->config.retry_max_ms);
+
+    pthread_mutex_init(&worker->mutex, NULL);
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&worker->stop_cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+
+    worker->is_running = true;
+    if (pthread_create(&worker->thread_id, NULL, sink_worker_thread_function, worker) != 0) {
+        perror("Failed to create sink thread");
+        pthread_cond_destroy(&worker->stop_cond);
+        pthread_mutex_destroy(&worker->mutex);
+        data_queue_destroy(worker->queue);
+        buffer_pool_destroy(worker->pool);
+        free(worker->batch);
+        if (ops->destroy) ops->destroy(state);
+        free(worker);
+        return NULL;
+    }
+
+    printf("Sink %s: started (queue %zu, batches of %zu, %u ms).\n", ops->name,
+           worker->config.queue_max_items, worker->config.batch_max_items, worker->config.batch_max_delay_ms);
+    return worker;
+}
+
+void sink_worker_destroy(SinkWorker* worker) {
+    if (!worker) return;
+
+    pthread_mutex_lock(&worker->mutex);
+    worker->is_running = false;
+    pthread_cond_broadcast(&worker->stop_cond);
+    pthread_mutex_unlock(&worker->mutex);
+    data_queue_shutdown(worker->queue);
+    pthread_join(worker->thread_id, NULL);
+
+    // Records still queued at shutdown are discarded; these sinks are live views
+    size_t count;
+    while ((count = data_queue_try_dequeue_batch(worker->queue, worker->batch, worker->config.batch_max_items, 0)) > 0) {
+        worker->stats.dropped += count;
+        for (size_t i = 0; i < count; i++) {
+            pooled_buffer_release(&worker->batch[i]);
+        }
+    }
+
+    SinkStats stats;
+    sink_worker_get_stats(worker, &stats);
+    printf("Sink %s: %llu submitted, %llu delivered, %llu dropped, %llu failed attempts, %llu encode failures\n",
+           worker->ops->name, stats.submitted, stats.delivered, stats.dropped,
+           stats.failed_attempts, stats.encode_failures);
+
+    if (worker->ops->destroy) {
+        worker->ops->destroy(worker->state);
+    }
+    pthread_cond_destroy(&worker->stop_cond);
+    pthread_mutex_destroy(&worker->mutex);
+    data_queue_destroy(worker->queue);
+    buffer_pool_destroy(worker->pool);
+    free(worker->batch);
+    free(worker);
+}
+
+bool sink_worker_submit(SinkWorker* worker, const MeasurementFrame* frame) {
+    if (!worker || !frame || !worker->is_running) return false;
+
+    PooledBuffer* buffer = buffer_pool_acquire(worker->pool);
+    size_t length = buffer ? worker->ops->encode(worker->state, frame, buffer->data, buffer->capacity) : 0;
+    if (buffer && length == 0) {
+        // Unusually large frame: retry once with a heap buffer
+        pooled_buffer_release(&buffer);
+        buffer = buffer_pool_acquire_sized(worker->pool, SINK_BUFFER_LARGE_CAPACITY);
+        length = buffer ? worker->ops->encode(worker->state, frame, buffer->data, buffer->capacity) : 0;
+    }
+
+    pthread_mutex_lock(&worker->mutex);
+    worker->stats.submitted++;
+    if (length == 0) worker->stats.encode_failures++;
+    pthread_mutex_unlock(&worker->mutex);
+
+    if (length == 0) {
+        pooled_buffer_release(&buffer);
+        return false;
+    }
+    buffer->length = length;
+    data_queue_enqueue_buffer(worker->queue, &buffer);
+    return true;
+}
+
+const char* sink_worker_name(const SinkWorker* worker) {
+    return worker ? worker->ops->name : NULL;
+}
+
+void sink_worker_get_stats(SinkWorker* worker, SinkStats* stats) {
+    if (!worker || !stats) return;
+
+    DataQueueStats queue_stats;
+    data_queue_get_stats(worker->queue, &queue_stats);
+
+    pthread_mutex_lock(&worker->mutex);
+    *stats = worker->stats;
+    pthread_mutex_unlock(&worker->mutex);
+    stats->dropped += queue_stats.dropped_oldest;
+}
+
+// --- Private Function Implementations ---
+
+static void* sink_worker_thread_function(void* arg) {
+    SinkWorker* worker = (SinkWorker*)arg;
+
+    while (worker->is_running) {
+        size_t count = data_queue_dequeue_batch(worker->queue, worker->batch, worker->config.batch_max_items,
+                                                0, worker->config.batch_max_delay_ms);
+        if (count > 0) {
+            deliver_batch(worker, count);
+        }
+    }
+    return NULL;
+}
+
+// Delivers one batch, backing off between attempts. The backoff grows with
+// consecutive failures across batches, so a dead sink costs next to nothing.
+static void deliver_batch(SinkWorker* worker, size_t count) {
+    unsigned int attempts = 0;
+    bool delivered = false;
+
+    while (worker->is_running) {
+        if (worker->ops->deliver(worker->state, worker->batch, count)) {
+            delivered = true;
+            worker->consecutive_failures = 0;
+            break;
+        }
+
+        pthread_mutex_lock(&worker->mutex);
+        worker->stats.failed_attempts++;
+        pthread_mutex_unlock(&worker->mutex);
+
+        unsigned int delay_ms = backoff_delay_ms(&worker->backoff, worker->consecutive_failures);
+        if (worker->consecutive_failures < 32) {
+            worker->consecutive_failures++;
+        }
+        if (attempts++ >= worker->config.max_retries || !wait_for_retry(worker, delay_ms)) {
+            break;
+        }
+    }
+
+    pthread_mutex_lock(&worker->mutex);
+    if (delivered) {
+        worker->stats.delivered += count;
+    } else {
+        worker->stats.dropped += count;
+    }
+    pthread_mutex_unlock(&worker->mutex);
+
+    for (size_t i = 0; i < count; i++) {
+        pooled_buffer_release(&worker->batch[i]);
+    }
+}
+
+// Sleeps for `delay_ms` unless the worker is stopped first. Returns false if stopped.
+static bool wait_for_retry(SinkWorker* worker, unsigned int delay_ms) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += delay_ms / 1000;
+    deadline.tv_nsec += (long)(delay_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&worker->mutex);
+    while (worker->is_running) {
+        if (pthread_cond_timedwait(&worker->stop_cond, &worker->mutex, &deadline) != 0) {
+            break; // ETIMEDOUT
+        }
+    }
+    bool running = worker->is_running;
+    pthread_mutex_unlock(&worker->mutex);
+    return running;
+}
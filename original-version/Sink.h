@@ -0,0 +1,89 @@
+#ifndef SINK_H
+#define SINK_H
+
+/**
+ * @file Sink.h
+ * @brief Output sink interface and the worker that isolates each sink.
+ *
+ * A sink is a wire format plus a transport (ScadaBR HTTP GET, raw socket, ...).
+ * Every sink runs behind its own SinkWorker: a private buffer pool, a bounded
+ * queue that drops its oldest records when full, and a thread that batches,
+ * delivers and backs off on failure. Submitting never blocks, so a slow or
+ * dead sink cannot add latency to the publisher or to the other sinks.
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "BufferPool.h"
+#include "MeasurementFrame.h"
+
+typedef struct {
+    const char* name;
+
+    // Encodes one frame in the sink's wire format, on the publisher's thread.
+    // Returns the number of bytes written (without terminator), or 0 if `capacity` was too small.
+    size_t (*encode)(void* state, const MeasurementFrame* frame, char* out, size_t capacity);
+
+    // Delivers a batch of encoded records, in order, on the worker thread.
+    // Returns true only if every record was delivered.
+    bool (*deliver)(void* state, PooledBuffer* const records[], size_t count);
+
+    // Frees the sink state. Called after the worker thread has stopped.
+    void (*destroy)(void* state);
+} SinkOps;
+
+typedef struct {
+    size_t queue_max_items;        // Older records are dropped beyond this
+    size_t batch_max_items;        // Records handed to one deliver() call
+    unsigned int batch_max_delay_ms;
+    unsigned int max_retries;      // Retries of one batch before it is dropped
+    unsigned int retry_base_ms;
+    unsigned int retry_max_ms;
+} SinkWorkerConfig;
+
+typedef struct {
+    unsigned long long submitted;
+    unsigned long long encode_failures;
+    unsigned long long delivered;        // Records
+    unsigned long long failed_attempts;  // deliver() calls that returned false
+    unsigned long long dropped;          // Records lost to retries running out or queue overflow
+} SinkStats;
+
+typedef struct SinkWorker SinkWorker; // Opaque worker type
+
+/**
+ * @brief Starts a worker thread for a sink. Takes ownership of `state`.
+ * @param ops The sink implementation.
+ * @param state Sink state passed to every callback; destroyed with the worker.
+ * @param config Queue, batching and retry limits.
+ * @return A pointer to the running worker, or NULL on failure (`state` is destroyed).
+ */
+SinkWorker* sink_worker_create(const SinkOps* ops, void* state, const SinkWorkerConfig* config);
+
+/**
+ * @brief Stops the worker, discarding records that were not delivered, and frees it.
+ * @param worker The worker to destroy.
+ */
+void sink_worker_destroy(SinkWorker* worker);
+
+/**
+ * @brief Encodes a frame for this sink and queues it. Never blocks.
+ * @param worker The worker.
+ * @param frame The frame to publish.
+ * @return true if the record was queued.
+ */
+bool sink_worker_submit(SinkWorker* worker, const MeasurementFrame* frame);
+
+/**
+ * @brief Returns the sink's name.
+ */
+const char* sink_worker_name(const SinkWorker* worker);
+
+/**
+ * @brief Takes a snapshot of the worker counters.
+ * @param worker The worker.
+ * @param stats Output structure.
+ */
+void sink_worker_get_stats(SinkWorker* worker, SinkStats* stats);
+
+#endif // SINK_H
@@ -1,6 +1,7 @@
 #include "SocketServer.h"
 #include "Measurement.h"
 #include "DataPublisher.h"
+#include "FloatFormat.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -14,6 +15,12 @@
 #define MAX_CLIENTS 5
 #define JSON_BUFFER_SIZE 2048
 
+// Formats a value for JSON with the digits configured for its field; callers skip NaN
+static const char* json_number(char* text, const char* field, double value) {
+    float_format(value, float_format_field_digits(field), text);
+    return text;
+}
+
 // Thread function to handle communication with a single client.
 void* handle_client_thread(void* client_socket_ptr) {
     int client_socket = *(int*)client_socket_ptr;
@@ -36,33 +43,38 @@ void* handle_client_thread(void* client_socket_ptr) {
         }
 
         // Format the data into a JSON string
+        char number[FLOAT_FORMAT_MAX_LENGTH];
         int offset = snprintf(json_buffer, JSON_BUFFER_SIZE, "{\"timestamp\": %ld, \"measurements\": [", time(NULL));
         for (int i = 0; i < NUM_CHANNELS; i++) {
             offset += snprintf(json_buffer + offset, JSON_BUFFER_SIZE - offset,
-                "{\"id\": \"%s\", \"adc\": %d, \"value\": %.4f}%s",
+                "{\"id\": \"%s\", \"adc\": %d, \"value\": %s}%s",
                 local_channels[i].id,
                 local_channels[i].raw_adc_value,
-                channel_get_calibrated_value(&local_channels[i]),
+                json_number(number, local_channels[i].id, channel_get_calibrated_value(&local_channels[i])),
                 (i == NUM_CHANNELS - 1) ? "" : ",");
         }
         offset += snprintf(json_buffer + offset, JSON_BUFFER_SIZE - offset, "], \"gps\": {");
 
         // Add GPS data, handling NaN values for valid JSON
         if (!isnan(local_gps_data.latitude)) {
-            offset += snprintf(json_buffer + offset, JSON_BUFFER_SIZE - offset, "\"latitude\": %.6f,", local_gps_data.latitude);
+            offset += snprintf(json_buffer + offset, JSON_BUFFER_SIZE - offset, "\"latitude\": %s,",
+                               json_number(number, "latitude", local_gps_data.latitude));
         }
         if (!isnan(local_gps_data.longitude)) {
-            offset += snprintf(json_buffer + offset, JSON_BUFFER_SIZE - offset, "\"longitude\": %.6f,", local_gps_data.longitude);
+            offset += snprintf(json_buffer + offset, JSON_BUFFER_SIZE - offset, "\"longitude\": %s,",
+                               json_number(number, "longitude", local_gps_data.longitude));
         }
         if (!isnan(local_gps_data.altitude)) {
-            offset += snprintf(json_buffer + offset, JSON_BUFFER_SIZE - offset, "\"altitude\": %.2f,", local_gps_data.altitude);
+            offset += snprintf(json_buffer + offset, JSON_BUFFER_SIZE - offset, "\"altitude\": %s,",
+                               json_number(number, "altitude", local_gps_data.altitude));
         }
         if (!isnan(local_gps_data.speed)) {
-             offset += snprintf(json_buffer + offset, JSON_BUFFER_SIZE - offset, "\"speed\": %.2f", local_gps_data.speed);
+             offset += snprintf(json_buffer + offset, JSON_BUFFER_SIZE - offset, "\"speed\": %s",
+                                json_number(number, "speed", local_gps_data.speed));
         }
         // Remove trailing comma if any GPS data was added
         if (json_buffer[offset-1] == ',') {
-            json_buffer[offset-1] = '\0';
+            offset--;
         }
         
         snprintf(json_buffer + offset, JSON_BUFFER_SIZE - offset, "}}\n"); // End of JSON object with newline
@@ -0,0 +1,151 @@
+#include "SocketSink.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+
+#define SOCKET_SINK_SEND_TIMEOUT_S 2
+#define SOCKET_SINK_MAX_IOV 64
+
+typedef struct {
+    char* host;
+    char* port;
+    int fd;     // -1 while disconnected
+} SocketSink;
+
+static bool socket_sink_connect(SocketSink* sink) {
+    struct addrinfo hints = {0};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo* addresses = NULL;
+    int error = getaddrinfo(sink->host, sink->port, &hints, &addresses);
+    if (error != 0) {
+        fprintf(stderr, "Sink socket: cannot resolve %s: %s\n", sink->host, gai_strerror(error));
+        return false;
+    }
+
+    for (struct addrinfo* address = addresses; address; address = address->ai_next) {
+        int fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if (fd < 0) continue;
+
+        // Bound the time a stalled reader can hold the worker in send()
+        struct timeval timeout = { .tv_sec = SOCKET_SINK_SEND_TIMEOUT_S, .tv_usec = 0 };
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        if (connect(fd, address->ai_addr, address->ai_addrlen) == 0) {
+            sink->fd = fd;
+            break;
+        }
+        close(fd);
+    }
+    freeaddrinfo(addresses);
+
+    if (sink->fd < 0) {
+        fprintf(stderr, "Sink socket: connection to %s:%s failed\n", sink->host, sink->port);
+        return false;
+    }
+    return true;
+}
+
+static void socket_sink_disconnect(SocketSink* sink) {
+    if (sink->fd >= 0) {
+        close(sink->fd);
+        sink->fd = -1;
+    }
+}
+
+static size_t socket_encode(void* state, const MeasurementFrame* frame, char* out, size_t capacity) {
+    (void)state;
+    size_t length = 0;
+    for (size_t i = 0; i < frame->count; i++) {
+        int written = snprintf(out + length, capacity - length, "%s,%.6f\n",
+                               frame->values[i].name, frame->values[i].value);
+        if (written < 0 || (size_t)written >= capacity - length) return 0;
+        length += (size_t)written;
+    }
+    return length;
+}
+
+// Sends every byte of `iov`, advancing it across partial writes
+static bool send_all(int fd, struct iovec* iov, int iov_count) {
+    while (iov_count > 0) {
+        struct msghdr message = { .msg_iov = iov, .msg_iovlen = (size_t)iov_count };
+        ssize_t sent = sendmsg(fd, &message, MSG_NOSIGNAL);
+        if (sent < 0) return false;
+
+        while (iov_count > 0 && (size_t)sent >= iov->iov_len) {
+            sent -= (ssize_t)iov->iov_len;
+            iov++;
+            iov_count--;
+        }
+        if (iov_count > 0) {
+            iov->iov_base = (char*)iov->iov_base + sent;
+            iov->iov_len -= (size_t)sent;
+        }
+    }
+    return true;
+}
+
+static bool socket_deliver(void* state, PooledBuffer* const records[], size_t count) {
+    SocketSink* sink = (SocketSink*)state;
+    if (sink->fd < 0 && !socket_sink_connect(sink)) {
+        return false;
+    }
+
+    // Gather the records straight from their buffers instead of joining them first
+    struct iovec iov[SOCKET_SINK_MAX_IOV];
+    for (size_t done = 0; done < count;) {
+        int chunk = 0;
+        while (done + (size_t)chunk < count && chunk < SOCKET_SINK_MAX_IOV) {
+            iov[chunk].iov_base = records[done + (size_t)chunk]->data;
+            iov[chunk].iov_len = records[done + (size_t)chunk]->length;
+            chunk++;
+        }
+        if (!send_all(sink->fd, iov, chunk)) {
+            perror("Sink socket: send failed");
+            socket_sink_disconnect(sink);
+            return false;
+        }
+        done += (size_t)chunk;
+    }
+    return true;
+}
+
+static void socket_destroy(void* state) {
+    SocketSink* sink = (SocketSink*)state;
+    if (!sink) return;
+    socket_sink_disconnect(sink);
+    free(sink->host);
+    free(sink->port);
+    free(sink);
+}
+
+const SinkOps SOCKET_SINK_OPS = {
+    .name = "socket",
+    .encode = socket_encode,
+    .deliver = socket_deliver,
+    .destroy = socket_destroy,
+};
+
+void* socket_sink_create(const char* host, const char* port) {
+    if (!host || !port) return NULL;
+
+    SocketSink* sink = calloc(1, sizeof(SocketSink));
+    if (!sink) {
+        perror("Failed to allocate socket sink");
+        return NULL;
+    }
+    sink->fd = -1;
+    sink->host = strdup(host);
+    sink->port = strdup(port);
+    if (!sink->host || !sink->port) {
+        socket_destroy(sink);
+        return NULL;
+    }
+    return sink;
+}
@@ -0,0 +1,24 @@
+#ifndef SOCKET_SINK_H
+#define SOCKET_SINK_H
+
+/**
+ * @file SocketSink.h
+ * @brief Sink that streams `tag,value` lines to a TCP listener.
+ *
+ * Keeps one connection open and writes a whole batch with a single send.
+ * A broken connection is re-established on the next delivery attempt.
+ */
+
+#include "Sink.h"
+
+extern const SinkOps SOCKET_SINK_OPS;
+
+/**
+ * @brief Creates the sink state. No connection is made until the first delivery.
+ * @param host IPv4 address or host name.
+ * @param port TCP port.
+ * @return Sink state for sink_worker_create(), or NULL on failure.
+ */
+void* socket_sink_create(const char* host, const char* port);
+
+#endif // SOCKET_SINK_H
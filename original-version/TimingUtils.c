@@ -23,4 +23,10 @@ void interval_timer_mark_triggered(IntervalTimer* timer) {
     if (!timer) return;
     
     clock_gettime(CLOCK_MONOTONIC, &timer->last_send_time);
-}
\ No newline at end of file
+}
+
+unsigned long long timing_monotonic_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000ULL + (unsigned long long)(now.tv_nsec / 1000000L);
+}
@@ -18,4 +18,7 @@ bool interval_timer_should_trigger(IntervalTimer* timer);
 // Mark that timer was triggered (updates last_send_time)
 void interval_timer_mark_triggered(IntervalTimer* timer);
 
+// Milliseconds on the monotonic clock, for deadlines that must ignore wall-clock changes
+unsigned long long timing_monotonic_ms(void);
+
 #endif // TIMING_UTILS_H
\ No newline at end of file
@@ -0,0 +1,244 @@
+// lp_benchmark.c - Measures the cost of encoding points as line protocol.
+//
+// Reports nanoseconds and heap allocations per point for the encodings the
+// sender performs, and for formatting a point's values with FloatFormat
+// against snprintf. Built as the lp-benchmark target, which wraps malloc,
+// calloc and realloc at link time to count allocations.
+//
+// Usage: lp-benchmark [iterations]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "FloatFormat.h"
+#include "LineProtocol.h"
+#include "PointRecord.h"
+
+#define BENCHMARK_DEFAULT_ITERATIONS 1000000
+#define BENCHMARK_WARMUP_ITERATIONS 1000
+#define BENCHMARK_VALUE_SETS 256
+#define BENCHMARK_POINT_VALUES 8
+
+static size_t g_allocations;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* pointer, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    g_allocations++;
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    g_allocations++;
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* pointer, size_t size) {
+    g_allocations++;
+    return __real_realloc(pointer, size);
+}
+
+typedef struct {
+    LineProtocolBuilder* builder;
+    const void* record;
+    size_t record_size;
+    const LineProtocolTemplate* point_template;
+    size_t iteration;
+    double values[BENCHMARK_VALUE_SETS][BENCHMARK_POINT_VALUES];
+    char text[BENCHMARK_POINT_VALUES * FLOAT_FORMAT_MAX_LENGTH];
+    const char* sample; // Shown instead of the builder's line
+} BenchmarkState;
+
+typedef LineProtocolError (*encode_func_t)(BenchmarkState* state);
+
+static const char* const g_channel_names[] = { "ch0", "ch1", "ch2", "ch3" };
+
+// The point DataPublisher produces: four channels and a GPS fix
+static LineProtocolError encode_typical(BenchmarkState* state) {
+    LineProtocolBuilder* builder = state->builder;
+    double offset = (double)(state->iteration % 1000) * 0.001;
+    LineProtocolError error = lp_set_measurement(builder, "measurements");
+    if (error == LP_SUCCESS) error = lp_add_tag(builder, "source", "instrumentacao");
+    for (size_t i = 0; error == LP_SUCCESS && i < 4; i++) {
+        error = lp_add_field_double(builder, g_channel_names[i], 12.345678 * (double)(i + 1) + offset);
+    }
+    if (error == LP_SUCCESS) error = lp_add_field_double(builder, "latitude", -22.9068467 + offset);
+    if (error == LP_SUCCESS) error = lp_add_field_double(builder, "longitude", -43.1728965 - offset);
+    if (error == LP_SUCCESS) error = lp_add_field_double(builder, "altitude", 11.2 + offset);
+    if (error == LP_SUCCESS) error = lp_add_field_double(builder, "speed", 0.0);
+    if (error == LP_SUCCESS) error = lp_set_timestamp(builder, 1700000000 + (int64_t)state->iteration);
+    return error;
+}
+
+// Every field type, including a string that needs escaping
+static LineProtocolError encode_mixed(BenchmarkState* state) {
+    LineProtocolBuilder* builder = state->builder;
+    LineProtocolError error = lp_set_measurement(builder, "status");
+    if (error == LP_SUCCESS) error = lp_add_tag(builder, "source", "instrumentacao");
+    if (error == LP_SUCCESS) error = lp_add_field_integer(builder, "uptime", -1234567890123LL + (int64_t)state->iteration);
+    if (error == LP_SUCCESS) error = lp_add_field_string(builder, "message", "board \"A\" at C:\\data");
+    if (error == LP_SUCCESS) error = lp_add_field_boolean(builder, "gps_fix", state->iteration % 2 == 0);
+    if (error == LP_SUCCESS) error = lp_add_field_double(builder, "battery", 3.7);
+    if (error == LP_SUCCESS) error = lp_set_timestamp(builder, 1700000000 + (int64_t)state->iteration);
+    return error;
+}
+
+// The typical point through a template: no names are copied or checked per point
+static LineProtocolError encode_template(BenchmarkState* state) {
+    double offset = (double)(state->iteration % 1000) * 0.001;
+    double values[8];
+    for (size_t i = 0; i < 4; i++) {
+        values[i] = 12.345678 * (double)(i + 1) + offset;
+    }
+    values[4] = -22.9068467 + offset;
+    values[5] = -43.1728965 - offset;
+    values[6] = 11.2 + offset;
+    values[7] = 0.0;
+    return lp_render_template(state->builder, state->point_template, values, 1700000000 + (int64_t)state->iteration);
+}
+
+// What the sender does for every queued point
+static LineProtocolError encode_record(BenchmarkState* state) {
+    return point_record_render(state->record, state->record_size, state->builder);
+}
+
+// Formatting cases: the eight values of a point, joined by commas
+typedef size_t (*format_func_t)(double value, char* out);
+
+static size_t format_shortest(double value, char* out) {
+    return float_format(value, FLOAT_FORMAT_SHORTEST, out);
+}
+
+static size_t format_printf_fixed(double value, char* out) {
+    return (size_t)snprintf(out, FLOAT_FORMAT_MAX_LENGTH, "%.6f", value);
+}
+
+static size_t format_printf_round_trip(double value, char* out) {
+    return (size_t)snprintf(out, FLOAT_FORMAT_MAX_LENGTH, "%.17g", value);
+}
+
+static LineProtocolError format_values(BenchmarkState* state, format_func_t format) {
+    const double* values = state->values[state->iteration % BENCHMARK_VALUE_SETS];
+    char* out = state->text;
+    for (size_t i = 0; i < BENCHMARK_POINT_VALUES; i++) {
+        if (i > 0) *out++ = ',';
+        out += format(values[i], out);
+    }
+    *out = '\0';
+    state->sample = state->text;
+    return LP_SUCCESS;
+}
+
+static LineProtocolError encode_float_format(BenchmarkState* state) {
+    return format_values(state, format_shortest);
+}
+
+static LineProtocolError encode_printf_fixed(BenchmarkState* state) {
+    return format_values(state, format_printf_fixed);
+}
+
+static LineProtocolError encode_printf_round_trip(BenchmarkState* state) {
+    return format_values(state, format_printf_round_trip);
+}
+
+// Calibrated ADC readings and a moving GPS fix, as full-precision doubles
+static void fill_values(BenchmarkState* state) {
+    static const double slopes[] = { 0.002098780795, 0.002384429, 0.00053852, 0.00206079 };
+    static const double offsets[] = { -27.60566316, -0.013682007, -0.00370030, -27.13033559 };
+    for (size_t set = 0; set < BENCHMARK_VALUE_SETS; set++) {
+        double* values = state->values[set];
+        for (size_t i = 0; i < 4; i++) {
+            values[i] = (double)(13000 + 37 * set + 101 * i) * slopes[i] + offsets[i];
+        }
+        values[4] = -22.9068467 + (double)set * 0.0000123 / 3.0;
+        values[5] = -43.1728965 - (double)set * 0.0000071 / 3.0;
+        values[6] = 11.2 + (double)set * 0.1;
+        values[7] = (double)set * 0.0277777;
+    }
+}
+
+static unsigned long long monotonic_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000000ULL + (unsigned long long)now.tv_nsec;
+}
+
+static bool run_case(const char* name, encode_func_t encode, BenchmarkState* state, size_t iterations) {
+    for (state->iteration = 0; state->iteration < BENCHMARK_WARMUP_ITERATIONS; state->iteration++) {
+        if (encode(state) != LP_SUCCESS) {
+            fprintf(stderr, "%s: encoding failed during warm-up\n", name);
+            return false;
+        }
+    }
+
+    size_t allocations_before = g_allocations;
+    unsigned long long started_ns = monotonic_ns();
+    for (state->iteration = 0; state->iteration < iterations; state->iteration++) {
+        if (encode(state) != LP_SUCCESS) {
+            fprintf(stderr, "%s: encoding failed\n", name);
+            return false;
+        }
+    }
+    unsigned long long elapsed_ns = monotonic_ns() - started_ns;
+    size_t allocations = g_allocations - allocations_before;
+
+    printf("%-8s %8.1f ns/point %8.2f allocs/point  %s\n", name, (double)elapsed_ns / (double)iterations,
+           (double)allocations / (double)iterations, state->sample ? state->sample : lp_view(state->builder));
+    state->sample = NULL;
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    size_t iterations = argc > 1 ? strtoul(argv[1], NULL, 10) : BENCHMARK_DEFAULT_ITERATIONS;
+    if (iterations == 0) iterations = BENCHMARK_DEFAULT_ITERATIONS;
+
+    BenchmarkState state;
+    memset(&state, 0, sizeof(state));
+    state.builder = lp_builder_create_default();
+    if (!state.builder) {
+        fprintf(stderr, "Failed to create the line protocol builder\n");
+        return 1;
+    }
+
+    static const char* const tag_keys[] = { "source" };
+    static const char* const tag_values[] = { "instrumentacao" };
+    static const char* const field_names[] = { "ch0", "ch1", "ch2", "ch3", "latitude", "longitude", "altitude", "speed" };
+    static const double values[] = { 12.345678, 24.691356, 37.037034, 49.382712, -22.9068467, -43.1728965, 11.2, 0.0 };
+    int schema_id = point_schema_register("measurements", tag_keys, tag_values, 1, field_names, 8);
+    LineProtocolTemplate* point_template = lp_template_create("measurements", tag_keys, tag_values, 1, field_names, NULL, 8);
+    state.point_template = point_template;
+    MeasurementFrame frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.timestamp = (int64_t)time(NULL);
+    frame.count = 8;
+    for (size_t i = 0; i < frame.count; i++) {
+        frame.values[i].name = field_names[i];
+        frame.values[i].value = values[i];
+    }
+    unsigned char record[POINT_RECORD_MAX_SIZE];
+    state.record = record;
+    state.record_size = point_record_encode(schema_id, &frame, record, sizeof(record));
+    if (state.record_size == 0 || !point_template) {
+        fprintf(stderr, "Failed to set up the benchmark record and template\n");
+        lp_template_destroy(point_template);
+        lp_builder_destroy(state.builder);
+        return 1;
+    }
+
+    fill_values(&state);
+
+    printf("%zu points per case\n", iterations);
+    bool success = run_case("typical", encode_typical, &state, iterations) &&
+                   run_case("mixed", encode_mixed, &state, iterations) &&
+                   run_case("template", encode_template, &state, iterations) &&
+                   run_case("record", encode_record, &state, iterations) &&
+                   run_case("shortest", encode_float_format, &state, iterations) &&
+                   run_case("%.6f", encode_printf_fixed, &state, iterations) &&
+                   run_case("%.17g", encode_printf_round_trip, &state, iterations);
+
+    lp_template_destroy(point_template);
+    lp_builder_destroy(state.builder);
+    return success ? 0 : 1;
+}
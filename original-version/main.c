@@ -18,6 +18,30 @@ static void signal_handler(int signum) {
     app_manager_signal_shutdown(g_app_manager);
 }
 
+/**
+ * @brief Signal handler for SIGUSR1: replay the offline backlog now.
+ */
+static void replay_signal_handler(int signum) {
+    (void)signum;
+    if (!g_app_manager) return;
+    app_manager_request_replay(g_app_manager);
+}
+
+/**
+ * @brief Stops routing signals to the app manager before it is torn down.
+ *
+ * SIGUSR1 is ignored process-wide, since any thread may take it, and the
+ * handlers lose their pointer before the manager and its sender are freed.
+ */
+static void detach_signal_handlers(void) {
+    struct sigaction ignore_sa;
+    ignore_sa.sa_handler = SIG_IGN;
+    sigemptyset(&ignore_sa.sa_mask);
+    ignore_sa.sa_flags = 0;
+    sigaction(SIGUSR1, &ignore_sa, NULL);
+    g_app_manager = NULL;
+}
+
 /**
  * @brief Prints a usage error message to stderr.
  */
@@ -62,6 +86,16 @@ int main(int argc, char **argv) {
         return 1;
     }
 
+    // `kill -USR1 <pid>` starts offline replay without waiting for the next timer pass
+    struct sigaction replay_sa;
+    replay_sa.sa_handler = replay_signal_handler;
+    sigemptyset(&replay_sa.sa_mask);
+    replay_sa.sa_flags = SA_RESTART;
+    if (sigaction(SIGUSR1, &replay_sa, NULL) == -1) {
+        perror("Failed to register replay signal handler");
+        return 1;
+    }
+
     // Create and initialize the application manager.
     g_app_manager = app_manager_create(argv[1], i2c_address, argv[3]);
     if (!g_app_manager) {
@@ -69,19 +103,22 @@ int main(int argc, char **argv) {
         return 1;
     }
     
-    AppManagerError init_result = app_manager_init(g_app_manager);
+    ApplicationManager* app = g_app_manager;
+    AppManagerError init_result = app_manager_init(app);
     if (init_result != APP_SUCCESS) {
         fprintf(stderr, "[Main] Application initialization failed: %s\n", 
                 app_manager_error_string(init_result));
-        app_manager_destroy(g_app_manager);
+        detach_signal_handlers();
+        app_manager_destroy(app);
         return 1;
     }
 
     // Run the main application loop.
-    app_manager_run(g_app_manager);
+    app_manager_run(app);
 
     // Clean up and destroy the application manager.
-    app_manager_destroy(g_app_manager);
+    detach_signal_handlers();
+    app_manager_destroy(app);
 
     printf("[Main] Shutdown complete.\n");
     return 0;
@@ -0,0 +1,390 @@
+"""
+A local stand-in for the InfluxDB v2 write endpoint, for benchmarking the
+sender and exercising its retry, circuit breaker and offline replay paths
+on one machine.
+
+Implements POST /api/v2/write (token check, org/bucket/precision parameters,
+gzip bodies, line protocol validation with partial writes), GET /health and
+a small control API:
+
+    GET  /stats     counters as JSON
+    POST /control   change fault settings at runtime, e.g.
+                    curl -d '{"fail_rate": 0.5, "fail_status": 503}' localhost:8086/control
+    POST /reset     zero the counters
+
+Faults can also be scripted on the command line. --script lists the outcomes
+of the next writes in order, after which the probabilistic settings apply:
+
+    python3 mock_influxdb.py --script "204*20,503*5,429,reset,204" --latency-ms 300
+
+Point the application at it with INFLUXDB_URL=http://127.0.0.1:8086.
+"""
+
+import argparse
+import gzip
+import json
+import random
+import socket
+import struct
+import sys
+import threading
+import time
+from dataclasses import dataclass, field, asdict
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from typing import List, Optional, Tuple
+from urllib.parse import urlparse, parse_qs
+
+PRECISIONS = ("ns", "us", "ms", "s")
+
+
+@dataclass
+class FaultConfig:
+    """Fault injection settings. All of them can be changed through /control."""
+    latency_ms: float = 0.0        # Added to every write
+    jitter_ms: float = 0.0         # Uniform random extra latency
+    fail_rate: float = 0.0         # Probability of answering with fail_status
+    fail_status: int = 503
+    throttle_rate: float = 0.0     # Probability of answering 429
+    retry_after_s: int = 1         # Sent with 429 and 503
+    reset_rate: float = 0.0        # Probability of resetting the connection without a response
+    partial_rate: float = 0.0      # Probability of rejecting each line individually
+    script: List[str] = field(default_factory=list)  # Scripted outcomes, consumed in order
+
+
+@dataclass
+class Stats:
+    requests: int = 0
+    points_accepted: int = 0
+    points_rejected: int = 0
+    bytes_received: int = 0        # As sent over the wire
+    bytes_decoded: int = 0         # After gzip decoding
+    gzip_requests: int = 0
+    resets: int = 0
+    statuses: dict = field(default_factory=dict)
+    first_write: Optional[float] = None
+    last_write: Optional[float] = None
+
+
+def parse_script(text: str) -> List[str]:
+    """Expands "204*3,503,reset" into ["204", "204", "204", "503", "reset"]."""
+    outcomes = []
+    for item in filter(None, (part.strip() for part in text.split(","))):
+        outcome, _, repeat = item.partition("*")
+        if outcome != "reset" and not outcome.isdigit():
+            raise ValueError(f"invalid script entry '{item}'")
+        outcomes.extend([outcome] * (int(repeat) if repeat else 1))
+    return outcomes
+
+
+def split_unescaped(text: str, separator: str, honour_quotes: bool = False) -> List[str]:
+    """Splits on `separator`, skipping backslash-escaped characters and, optionally, quoted strings."""
+    parts, current, escaped, quoted = [], [], False, False
+    for char in text:
+        if escaped:
+            current.append(char)
+            escaped = False
+        elif char == "\\":
+            current.append(char)
+            escaped = True
+        elif honour_quotes and char == '"':
+            current.append(char)
+            quoted = not quoted
+        elif char == separator and not quoted:
+            parts.append("".join(current))
+            current = []
+        else:
+            current.append(char)
+    if quoted:
+        raise ValueError("unterminated string field")
+    parts.append("".join(current))
+    return parts
+
+
+def validate_field_value(value: str) -> None:
+    if not value:
+        raise ValueError("empty field value")
+    if value.startswith('"'):
+        if len(value) < 2 or not value.endswith('"'):
+            raise ValueError(f"bad string field {value}")
+    elif value in ("t", "T", "true", "True", "TRUE", "f", "F", "false", "False", "FALSE"):
+        pass
+    elif value.endswith("i") or value.endswith("u"):
+        int(value[:-1])
+    else:
+        float(value)
+
+
+def validate_line(line: str) -> None:
+    """Raises ValueError if `line` is not a valid line protocol point."""
+    sections = split_unescaped(line, " ", honour_quotes=True)
+    if len(sections) not in (2, 3):
+        raise ValueError("expected 'measurement[,tags] fields [timestamp]'")
+
+    series = split_unescaped(sections[0], ",")
+    if not series[0]:
+        raise ValueError("missing measurement")
+    for tag in series[1:]:
+        key, sep, value = tag.partition("=")
+        if not sep or not key or not value:
+            raise ValueError(f"bad tag '{tag}'")
+
+    for field_text in split_unescaped(sections[1], ",", honour_quotes=True):
+        key, sep, value = field_text.partition("=")
+        if not sep or not key:
+            raise ValueError(f"bad field '{field_text}'")
+        validate_field_value(value)
+
+    if len(sections) == 3 and not sections[2].lstrip("-").isdigit():
+        raise ValueError(f"bad timestamp '{sections[2]}'")
+
+
+class MockInfluxDB(ThreadingHTTPServer):
+    daemon_threads = True
+
+    def __init__(self, address: Tuple[str, int], args: argparse.Namespace):
+        super().__init__(address, WriteHandler)
+        self.args = args
+        self.faults = FaultConfig(
+            latency_ms=args.latency_ms, jitter_ms=args.jitter_ms,
+            fail_rate=args.fail_rate, fail_status=args.fail_status,
+            throttle_rate=args.throttle_rate, retry_after_s=args.retry_after,
+            reset_rate=args.reset_rate, partial_rate=args.partial_rate,
+            script=parse_script(args.script))
+        self.stats = Stats()
+        self.lock = threading.Lock()
+        self.dump = open(args.dump, "a") if args.dump else None
+
+    def next_outcome(self) -> Optional[str]:
+        """Returns a forced outcome ("reset" or a status code) or None for a normal write."""
+        with self.lock:
+            if self.faults.script:
+                return self.faults.script.pop(0)
+            roll = random.random()
+            if roll < self.faults.reset_rate:
+                return "reset"
+            roll -= self.faults.reset_rate
+            if roll < self.faults.throttle_rate:
+                return "429"
+            roll -= self.faults.throttle_rate
+            if roll < self.faults.fail_rate:
+                return str(self.faults.fail_status)
+            return None
+
+
+class WriteHandler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    server: MockInfluxDB
+
+    def log_message(self, format, *args):
+        if self.server.args.verbose:
+            super().log_message(format, *args)
+
+    def send_json(self, status: int, payload: dict, headers: Optional[dict] = None) -> None:
+        body = json.dumps(payload).encode()
+        self.send_response(status)
+        self.send_header("Content-Type", "application/json; charset=utf-8")
+        self.send_header("Content-Length", str(len(body)))
+        for name, value in (headers or {}).items():
+            self.send_header(name, value)
+        self.end_headers()
+        self.wfile.write(body)
+
+    def send_empty(self, status: int) -> None:
+        self.send_response(status)
+        self.send_header("Content-Length", "0")
+        self.end_headers()
+
+    def count_status(self, status) -> None:
+        with self.server.lock:
+            key = str(status)
+            self.server.stats.statuses[key] = self.server.stats.statuses.get(key, 0) + 1
+
+    def do_GET(self):
+        path = urlparse(self.path).path
+        if path == "/health":
+            self.send_json(200, {"name": "influxdb", "status": "pass", "message": "mock"})
+        elif path == "/stats":
+            with self.server.lock:
+                stats = asdict(self.server.stats)
+                faults = asdict(self.server.faults)
+            if stats["first_write"] and stats["last_write"] and stats["last_write"] > stats["first_write"]:
+                stats["points_per_second"] = stats["points_accepted"] / (stats["last_write"] - stats["first_write"])
+            faults["script_remaining"] = len(faults.pop("script"))
+            self.send_json(200, {"stats": stats, "faults": faults})
+        else:
+            self.send_json(404, {"code": "not found", "message": "path not found"})
+
+    def do_POST(self):
+        path = urlparse(self.path).path
+        length = int(self.headers.get("Content-Length", 0))
+        body = self.rfile.read(length)
+
+        if path == "/api/v2/write":
+            self.handle_write(body)
+        elif path == "/control":
+            self.handle_control(body)
+        elif path == "/reset":
+            with self.server.lock:
+                self.server.stats = Stats()
+            self.send_empty(204)
+        else:
+            self.send_json(404, {"code": "not found", "message": "path not found"})
+
+    def handle_control(self, body: bytes) -> None:
+        try:
+            changes = json.loads(body or b"{}")
+            with self.server.lock:
+                for name, value in changes.items():
+                    if not hasattr(self.server.faults, name):
+                        raise ValueError(f"unknown setting '{name}'")
+                    if name == "script":
+                        value = parse_script(value) if isinstance(value, str) else list(map(str, value))
+                    setattr(self.server.faults, name, value)
+                faults = asdict(self.server.faults)
+            self.send_json(200, faults)
+        except (ValueError, json.JSONDecodeError) as error:
+            self.send_json(400, {"code": "invalid", "message": str(error)})
+
+    def reset_connection(self) -> None:
+        # SO_LINGER with a zero timeout makes close() send a RST instead of a FIN
+        self.connection.setsockopt(socket.SOL_SOCKET, socket.SO_LINGER, struct.pack("ii", 1, 0))
+        self.connection.close()
+        self.close_connection = True
+
+    def handle_write(self, body: bytes) -> None:
+        server = self.server
+        with server.lock:
+            server.stats.requests += 1
+            server.stats.bytes_received += len(body)
+            faults = server.faults
+            delay = faults.latency_ms + random.uniform(0, faults.jitter_ms)
+            retry_after = faults.retry_after_s
+            partial_rate = faults.partial_rate
+        if delay > 0:
+            time.sleep(delay / 1000.0)
+
+        outcome = server.next_outcome()
+        if outcome == "reset":
+            with server.lock:
+                server.stats.resets += 1
+            self.reset_connection()
+            return
+        if outcome is not None and outcome not in ("200", "204"):
+            status = int(outcome)
+            self.count_status(status)
+            headers = {"Retry-After": str(retry_after)} if status in (429, 503) else {}
+            self.send_json(status, {"code": "unavailable", "message": "injected failure"}, headers)
+            return
+
+        # Authentication and parameters, checked the way InfluxDB does
+        if self.headers.get("Authorization") != f"Token {server.args.token}":
+            self.count_status(401)
+            self.send_json(401, {"code": "unauthorized", "message": "unauthorized access"})
+            return
+        params = parse_qs(urlparse(self.path).query)
+        org, bucket = params.get("org", [None])[0], params.get("bucket", [None])[0]
+        precision = params.get("precision", ["ns"])[0]
+        if not org or not bucket:
+            self.count_status(400)
+            self.send_json(400, {"code": "invalid", "message": "org and bucket are required"})
+            return
+        if (server.args.org and org != server.args.org) or (server.args.bucket and bucket != server.args.bucket):
+            self.count_status(404)
+            self.send_json(404, {"code": "not found", "message": f'bucket "{bucket}" not found'})
+            return
+        if precision not in PRECISIONS:
+            self.count_status(400)
+            self.send_json(400, {"code": "invalid", "message": f"invalid precision '{precision}'"})
+            return
+
+        if self.headers.get("Content-Encoding", "").lower() == "gzip":
+            try:
+                body = gzip.decompress(body)
+            except (OSError, EOFError) as error:
+                self.count_status(400)
+                self.send_json(400, {"code": "invalid", "message": f"gzip: {error}"})
+                return
+            with server.lock:
+                server.stats.gzip_requests += 1
+
+        accepted, errors = [], []
+        for number, raw_line in enumerate(body.decode("utf-8", errors="replace").split("\n"), start=1):
+            line = raw_line.strip()
+            if not line or line.startswith("#"):
+                continue
+            try:
+                validate_line(line)
+                if partial_rate and random.random() < partial_rate:
+                    raise ValueError("injected rejection")
+                accepted.append(line)
+            except ValueError as error:
+                errors.append(f"line {number}: {error}")
+
+        now = time.time()
+        with server.lock:
+            stats = server.stats
+            stats.bytes_decoded += len(body)
+            stats.points_accepted += len(accepted)
+            stats.points_rejected += len(errors)
+            stats.first_write = stats.first_write or now
+            stats.last_write = now
+            if server.dump and accepted:
+                server.dump.write("\n".join(accepted) + "\n")
+                server.dump.flush()
+
+        if server.args.verbose:
+            print(f"write: {len(accepted)} accepted, {len(errors)} rejected, {len(body)} bytes", flush=True)
+
+        if errors:
+            # InfluxDB writes the valid points and reports the rest as a partial write
+            self.count_status(400)
+            message = f"partial write error ({len(accepted)} accepted): " + "; ".join(errors[:10])
+            self.send_json(400, {"code": "invalid", "message": message})
+        else:
+            self.count_status(204)
+            self.send_empty(204)
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description="Mock InfluxDB v2 write endpoint with fault injection.")
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=8086)
+    parser.add_argument("--token", default="mock-token", help="Expected API token")
+    parser.add_argument("--org", help="Expected org (any if omitted)")
+    parser.add_argument("--bucket", help="Expected bucket (any if omitted)")
+    parser.add_argument("--latency-ms", type=float, default=0.0)
+    parser.add_argument("--jitter-ms", type=float, default=0.0)
+    parser.add_argument("--fail-rate", type=float, default=0.0, help="Probability of answering --fail-status")
+    parser.add_argument("--fail-status", type=int, default=503)
+    parser.add_argument("--throttle-rate", type=float, default=0.0, help="Probability of answering 429")
+    parser.add_argument("--retry-after", type=int, default=1, help="Retry-After seconds sent with 429/503")
+    parser.add_argument("--reset-rate", type=float, default=0.0, help="Probability of a connection reset")
+    parser.add_argument("--partial-rate", type=float, default=0.0, help="Probability of rejecting each line")
+    parser.add_argument("--script", default="", help='Scripted outcomes, e.g. "204*10,503*3,reset,429"')
+    parser.add_argument("--dump", help="Append accepted lines to this file")
+    parser.add_argument("--seed", type=int, help="Random seed for reproducible runs")
+    parser.add_argument("-v", "--verbose", action="store_true")
+    args = parser.parse_args()
+
+    if args.seed is not None:
+        random.seed(args.seed)
+    try:
+        server = MockInfluxDB((args.host, args.port), args)
+    except ValueError as error:
+        print(f"Error: {error}", file=sys.stderr)
+        return 1
+
+    print(f"Mock InfluxDB listening on http://{args.host}:{args.port} (token '{args.token}')")
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        print("\nStopping mock server.")
+    finally:
+        with server.lock:
+            print(json.dumps(asdict(server.stats), indent=2))
+        server.server_close()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,66 @@
+// sender_e2e.c - Feeds numbered points to a real sender for sender_e2e.py
+//
+// Usage: sender_e2e <first> <count>
+//
+// Submits the points "e2e v=<i> <i>" for i in [first, first + count), then keeps
+// requesting replay until SIGTERM, when it destroys the sender and exits. The
+// sender is configured from the environment like the application's; the script
+// runs it in a scratch directory since the offline log lives under ./logs.
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "PointRecord.h"
+#include "Sender.h"
+
+static volatile sig_atomic_t g_stop = 0;
+
+static void stop_handler(int sig) {
+    (void)sig;
+    g_stop = 1;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s <first> <count>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    long long first = atoll(argv[1]);
+    long long count = atoll(argv[2]);
+
+    struct sigaction action = { .sa_handler = stop_handler };
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGTERM, &action, NULL);
+    sigaction(SIGINT, &action, NULL);
+
+    static const char* const field_names[] = { "v" };
+    int schema_id = point_schema_register("e2e", NULL, NULL, 0, field_names, 1);
+    SenderContext* sender = sender_create_from_env();
+    if (schema_id < 0 || !sender) {
+        fprintf(stderr, "Could not start the sender.\n");
+        return EXIT_FAILURE;
+    }
+
+    for (long long i = first; i < first + count && !g_stop; i++) {
+        MeasurementFrame frame = { .timestamp = i, .count = 1 };
+        frame.values[0].value = (double)i;
+
+        PooledBuffer* buffer = sender_acquire_buffer(sender);
+        if (!buffer) {
+            usleep(1000);
+            i--;
+            continue;
+        }
+        buffer->length = point_record_encode(schema_id, &frame, buffer->data, buffer->capacity);
+        sender_submit_buffer(sender, &buffer);
+    }
+    printf("Submitted %lld points.\n", count);
+    fflush(stdout);
+
+    while (!g_stop) {
+        usleep(200 * 1000);
+        sender_request_replay(sender);
+    }
+    sender_destroy(sender);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,240 @@
+"""
+End-to-end runs of the sender against mock_influxdb.py, driven through the
+sender_e2e program:
+
+    503 then recovery   the first writes fail, every point still arrives once
+    400 bisection       a bad line in the imported legacy log is quarantined
+                        and the good lines around it are delivered
+    crash mid-commit    the sender is killed with everything on disk and its
+                        last commit torn; the restart delivers the intact part
+
+Usage: python3 sender_e2e.py <sender_e2e binary> <mock_influxdb.py>
+"""
+
+import collections
+import json
+import os
+import signal
+import socket
+import subprocess
+import sys
+import tempfile
+import time
+import urllib.request
+import zlib
+
+TIMEOUT_S = 60
+
+
+def free_port() -> int:
+    with socket.socket() as sock:
+        sock.bind(("127.0.0.1", 0))
+        return sock.getsockname()[1]
+
+
+def wait_for(predicate, what: str, timeout_s: float = TIMEOUT_S) -> None:
+    deadline = time.monotonic() + timeout_s
+    while not predicate():
+        if time.monotonic() > deadline:
+            raise AssertionError(f"timed out waiting for {what}")
+        time.sleep(0.1)
+
+
+def read_lines(path: str) -> list:
+    if not os.path.exists(path):
+        return []
+    with open(path) as file:
+        return [line for line in file.read().split("\n") if line]
+
+
+def decode_members(path: str) -> list:
+    """Returns the lines of each gzip member of an offline segment."""
+    with open(path, "rb") as file:
+        data = file.read()
+    members = []
+    while data:
+        inflater = zlib.decompressobj(31)
+        text = inflater.decompress(data) + inflater.flush()
+        if not inflater.eof:
+            break
+        members.append([line for line in text.decode().split("\n") if line])
+        data = inflater.unused_data
+    return members
+
+
+def segment_paths(directory: str) -> list:
+    offline = os.path.join(directory, "logs", "offline")
+    if not os.path.isdir(offline):
+        return []
+    return sorted(os.path.join(offline, name) for name in os.listdir(offline) if name.endswith(".seg"))
+
+
+def points(first: int, count: int) -> list:
+    return [f"e2e v={i} {i}" for i in range(first, first + count)]
+
+
+class Mock:
+    def __init__(self, mock_script: str, directory: str, *options: str):
+        self.port = free_port()
+        self.dump = os.path.join(directory, "accepted.txt")
+        self.process = subprocess.Popen(
+            [sys.executable, mock_script, "--port", str(self.port), "--dump", self.dump, *options],
+            stdout=subprocess.DEVNULL)
+        wait_for(self.healthy, "the mock server", 10)
+
+    def request(self, path: str, body: dict = None) -> dict:
+        data = json.dumps(body).encode() if body is not None else None
+        with urllib.request.urlopen(f"http://127.0.0.1:{self.port}{path}", data, timeout=5) as response:
+            return json.loads(response.read() or b"{}")
+
+    def healthy(self) -> bool:
+        try:
+            return self.request("/health")["status"] == "pass"
+        except OSError:
+            return False
+
+    def statuses(self) -> dict:
+        return self.request("/stats")["stats"]["statuses"]
+
+    def accepted(self) -> list:
+        return read_lines(self.dump)
+
+    def stop(self) -> None:
+        self.process.terminate()
+        self.process.wait()
+
+
+class Driver:
+    def __init__(self, binary: str, directory: str, mock: Mock, first: int, count: int, **env):
+        environment = dict(os.environ,
+                           INFLUXDB_URL=f"http://127.0.0.1:{mock.port}",
+                           INFLUXDB_BUCKET="e2e", INFLUXDB_ORG="e2e", INFLUXDB_TOKEN="mock-token",
+                           OFFLINE_COMMIT_INTERVAL_MS="50", SENDER_BATCH_MAX_DELAY_MS="50",
+                           SENDER_RETRY_BASE_MS="50", SENDER_RETRY_MAX_MS="200",
+                           SENDER_BREAKER_OPEN_MS="200", SENDER_BREAKER_MAX_OPEN_MS="1000",
+                           SENDER_METRICS_INTERVAL_S="0")
+        environment.update({name: str(value) for name, value in env.items()})
+        self.log = os.path.join(directory, f"sender-{first}.log")
+        with open(self.log, "w") as log:
+            self.process = subprocess.Popen([binary, str(first), str(count)], cwd=directory, env=environment,
+                                            stdout=log, stderr=subprocess.STDOUT)
+
+    def output(self) -> str:
+        with open(self.log) as log:
+            return log.read()
+
+    def stop(self) -> None:
+        self.process.send_signal(signal.SIGTERM)
+        if self.process.wait(timeout=TIMEOUT_S) != 0:
+            raise AssertionError(f"sender exited with {self.process.returncode}:\n{self.output()}")
+
+    def kill(self) -> None:
+        self.process.kill()
+        self.process.wait()
+
+
+def check_exactly_once(accepted: list, expected: list) -> None:
+    counts = collections.Counter(accepted)
+    missing = [line for line in expected if counts[line] == 0]
+    duplicated = [line for line, count in counts.items() if count > 1]
+    unexpected = set(counts) - set(expected)
+    if missing or duplicated or unexpected:
+        raise AssertionError(f"{len(missing)} points missing (e.g. {missing[:3]}), "
+                             f"{len(duplicated)} sent twice (e.g. {duplicated[:3]}), "
+                             f"{len(unexpected)} unexpected (e.g. {sorted(unexpected)[:3]})")
+
+
+def test_503_then_recovery(binary: str, mock_script: str, directory: str) -> None:
+    mock = Mock(mock_script, directory, "--script", "503*5")
+    expected = points(0, 2000)
+    driver = Driver(binary, directory, mock, 0, len(expected))
+    try:
+        wait_for(lambda: set(expected) <= set(mock.accepted()), "every point to arrive")
+        driver.stop()
+        check_exactly_once(mock.accepted(), expected)
+        if mock.statuses().get("503") != 5:
+            raise AssertionError(f"expected five 503 answers, got {mock.statuses()}")
+    finally:
+        driver.kill()
+        mock.stop()
+
+
+def test_400_bisection(binary: str, mock_script: str, directory: str) -> None:
+    # A log left by a version that kept a single file, with one line InfluxDB refuses
+    good = [f"legacy v={i} {i}" for i in range(300)]
+    bad = "legacy v= 150"
+    os.makedirs(os.path.join(directory, "logs"))
+    with open(os.path.join(directory, "logs", "offline_log.txt"), "w") as log:
+        log.write("\n".join(good[:150] + [bad] + good[150:]) + "\n")
+
+    mock = Mock(mock_script, directory)
+    quarantine = os.path.join(directory, "logs", "offline", "quarantine.txt")
+    driver = Driver(binary, directory, mock, 0, 0)
+    try:
+        wait_for(lambda: os.path.exists(quarantine) and set(good) <= set(mock.accepted()),
+                 "the bad line to be quarantined")
+        driver.stop()
+        if read_lines(quarantine) != [bad]:
+            raise AssertionError(f"quarantine holds {read_lines(quarantine)[:5]}")
+        # The mock, like InfluxDB, keeps the valid part of a partial write, so good lines
+        # may arrive more than once; that only rewrites the same points
+        if set(mock.accepted()) != set(good):
+            raise AssertionError("the mock accepted lines that were not in the log")
+        if not mock.statuses().get("400"):
+            raise AssertionError(f"no 400 answer, got {mock.statuses()}")
+    finally:
+        driver.kill()
+        mock.stop()
+
+
+def test_crash_mid_commit(binary: str, mock_script: str, directory: str) -> None:
+    mock = Mock(mock_script, directory, "--fail-rate", "1.0", "--fail-status", "503")
+    submitted = points(10000, 3000)
+    driver = Driver(binary, directory, mock, 10000, len(submitted), SENDER_MAX_RETRIES=0)
+    on_disk = lambda: [line for path in segment_paths(directory) for member in decode_members(path)
+                       for line in member]
+    try:
+        wait_for(lambda: len(on_disk()) == len(submitted), "every point to reach the offline log")
+    finally:
+        driver.kill()
+
+    # Power lost during the last commit: its member is only partly on the card
+    newest = [path for path in segment_paths(directory) if os.path.getsize(path) > 0][-1]
+    lost = decode_members(newest)[-1]
+    os.truncate(newest, os.path.getsize(newest) - 5)
+    expected = [line for line in submitted if line not in set(lost)]
+
+    mock.request("/control", {"fail_rate": 0.0})
+    driver = Driver(binary, directory, mock, 0, 0)
+    try:
+        wait_for(lambda: set(expected) <= set(mock.accepted()), "the intact points to be replayed")
+        time.sleep(1)  # Anything sent twice would arrive by now
+        driver.stop()
+        check_exactly_once(mock.accepted(), expected)
+        if "dropping the last" not in driver.output():
+            raise AssertionError(f"the torn commit was not reported:\n{driver.output()}")
+    finally:
+        driver.kill()
+        mock.stop()
+
+
+def main() -> int:
+    if len(sys.argv) != 3:
+        print(__doc__, file=sys.stderr)
+        return 2
+    binary, mock_script = os.path.abspath(sys.argv[1]), os.path.abspath(sys.argv[2])
+
+    failures = 0
+    for test in (test_503_then_recovery, test_400_bisection, test_crash_mid_commit):
+        with tempfile.TemporaryDirectory(prefix="sender-e2e-") as directory:
+            try:
+                test(binary, mock_script, directory)
+                print(f"{test.__name__}: ok", flush=True)
+            except AssertionError as error:
+                print(f"{test.__name__}: FAILED\n{error}", flush=True)
+                failures += 1
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,171 @@
+// test_data_queue.c - Overflow policies and batch dequeue of the live send queue
+#include <pthread.h>
+#include <unistd.h>
+#include "DataQueue.h"
+#include "test_util.h"
+
+typedef struct {
+    char lines[64][16];
+    size_t count;
+    size_t events;
+} SpillLog;
+
+static void record_spill(PooledBuffer* const items[], size_t count, void* user_context) {
+    SpillLog* log = user_context;
+    for (size_t i = 0; i < count && log->count < 64; i++) {
+        snprintf(log->lines[log->count++], sizeof(log->lines[0]), "%s", items[i]->data);
+    }
+    log->events++;
+}
+
+static void enqueue_numbered(DataQueue* queue, int first, int last) {
+    for (int i = first; i <= last; i++) {
+        char text[16];
+        snprintf(text, sizeof(text), "p%d", i);
+        data_queue_enqueue(queue, text);
+    }
+}
+
+// Dequeues everything and checks it reads "p<first>" to "p<last>" in order
+static void check_contents(DataQueue* queue, int first, int last) {
+    PooledBuffer* items[64];
+    size_t count = data_queue_try_dequeue_batch(queue, items, 64, 0);
+    CHECK(count == (size_t)(last - first + 1));
+    for (size_t i = 0; i < count; i++) {
+        char expected[24];
+        snprintf(expected, sizeof(expected), "p%d", first + (int)i);
+        CHECK_STR(items[i]->data, expected);
+        pooled_buffer_release(&items[i]);
+    }
+}
+
+static void test_drop_newest(void) {
+    BufferPool* pool = buffer_pool_create(64, 16);
+    DataQueue* queue = data_queue_create(pool);
+    data_queue_set_overflow_policy(queue, 4, 0, DATA_QUEUE_OVERFLOW_DROP_NEWEST, NULL, NULL);
+    enqueue_numbered(queue, 1, 6);
+
+    DataQueueStats stats;
+    data_queue_get_stats(queue, &stats);
+    CHECK(stats.enqueued == 4);
+    CHECK(stats.dropped_newest == 2);
+    check_contents(queue, 1, 4);
+    data_queue_destroy(queue);
+    buffer_pool_destroy(pool);
+}
+
+static void test_drop_oldest_trims_to_low_water(void) {
+    BufferPool* pool = buffer_pool_create(64, 16);
+    DataQueue* queue = data_queue_create(pool);
+    data_queue_set_overflow_policy(queue, 4, 0, DATA_QUEUE_OVERFLOW_DROP_OLDEST, NULL, NULL);
+    enqueue_numbered(queue, 1, 5); // The fifth trims the queue to half of four
+
+    DataQueueStats stats;
+    data_queue_get_stats(queue, &stats);
+    CHECK(stats.dropped_oldest == 2);
+    CHECK(stats.current_items == 3);
+    check_contents(queue, 3, 5);
+    data_queue_destroy(queue);
+    buffer_pool_destroy(pool);
+}
+
+static void test_spill_hands_over_oldest_chunk(void) {
+    BufferPool* pool = buffer_pool_create(64, 32);
+    DataQueue* queue = data_queue_create(pool);
+    SpillLog log = { .count = 0 };
+    data_queue_set_overflow_policy(queue, 8, 0, DATA_QUEUE_OVERFLOW_SPILL, record_spill, &log);
+    enqueue_numbered(queue, 1, 9);
+
+    CHECK(log.events == 1);
+    CHECK(log.count == 4);
+    for (size_t i = 0; i < log.count; i++) {
+        char expected[24];
+        snprintf(expected, sizeof(expected), "p%d", (int)i + 1);
+        CHECK_STR(log.lines[i], expected);
+    }
+    DataQueueStats stats;
+    data_queue_get_stats(queue, &stats);
+    CHECK(stats.spilled == 4);
+    CHECK(stats.spill_events == 1);
+    check_contents(queue, 5, 9);
+
+    BufferPoolStats pool_stats;
+    buffer_pool_get_stats(pool, &pool_stats);
+    CHECK(pool_stats.in_use == 0); // Spilled buffers went back to the pool
+    data_queue_destroy(queue);
+    buffer_pool_destroy(pool);
+}
+
+static void test_byte_limit(void) {
+    BufferPool* pool = buffer_pool_create(64, 16);
+    DataQueue* queue = data_queue_create(pool);
+    data_queue_set_overflow_policy(queue, 0, 8, DATA_QUEUE_OVERFLOW_DROP_NEWEST, NULL, NULL);
+    enqueue_numbered(queue, 1, 5); // Two bytes each: four fit in eight
+
+    DataQueueStats stats;
+    data_queue_get_stats(queue, &stats);
+    CHECK(stats.current_bytes == 8);
+    CHECK(stats.dropped_newest == 1);
+    check_contents(queue, 1, 4);
+    data_queue_destroy(queue);
+    buffer_pool_destroy(pool);
+}
+
+static void* enqueue_one_more(void* queue) {
+    enqueue_numbered(queue, 3, 3);
+    return NULL;
+}
+
+static void test_block_waits_for_room(void) {
+    BufferPool* pool = buffer_pool_create(64, 16);
+    DataQueue* queue = data_queue_create(pool);
+    data_queue_set_overflow_policy(queue, 2, 0, DATA_QUEUE_OVERFLOW_BLOCK, NULL, NULL);
+    enqueue_numbered(queue, 1, 2);
+
+    pthread_t producer;
+    pthread_create(&producer, NULL, enqueue_one_more, queue);
+    usleep(50000);
+    CHECK(data_queue_size(queue) == 2); // Still waiting
+
+    PooledBuffer* first = data_queue_dequeue(queue);
+    CHECK_STR(first->data, "p1");
+    pooled_buffer_release(&first);
+    pthread_join(producer, NULL);
+
+    DataQueueStats stats;
+    data_queue_get_stats(queue, &stats);
+    CHECK(stats.blocked == 1);
+    check_contents(queue, 2, 3);
+    data_queue_destroy(queue);
+    buffer_pool_destroy(pool);
+}
+
+static void test_batch_limits(void) {
+    BufferPool* pool = buffer_pool_create(64, 16);
+    DataQueue* queue = data_queue_create(pool);
+    enqueue_numbered(queue, 1, 6);
+
+    PooledBuffer* items[8];
+    CHECK(data_queue_dequeue_batch(queue, items, 4, 0, 0) == 4);
+    for (size_t i = 0; i < 4; i++) pooled_buffer_release(&items[i]);
+    CHECK(data_queue_try_dequeue_batch(queue, items, 8, 3) == 1); // The first item is always taken
+    pooled_buffer_release(&items[0]);
+    check_contents(queue, 6, 6);
+
+    data_queue_wakeup(queue);
+    CHECK(data_queue_dequeue_batch(queue, items, 8, 0, 1000) == 0); // Interrupted, not shut down
+    data_queue_shutdown(queue);
+    CHECK(data_queue_dequeue(queue) == NULL);
+    data_queue_destroy(queue);
+    buffer_pool_destroy(pool);
+}
+
+int main(void) {
+    TEST_RUN(test_drop_newest);
+    TEST_RUN(test_drop_oldest_trims_to_low_water);
+    TEST_RUN(test_spill_hands_over_oldest_chunk);
+    TEST_RUN(test_byte_limit);
+    TEST_RUN(test_block_waits_for_room);
+    TEST_RUN(test_batch_limits);
+    return TEST_EXIT_CODE();
+}
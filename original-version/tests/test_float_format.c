@@ -0,0 +1,83 @@
+// test_float_format.c - Shortest round-trip and fixed-digit formatting of doubles
+#include <math.h>
+#include <stdint.h>
+#include "FloatFormat.h"
+#include "test_util.h"
+
+static const char* format(double value, int digits) {
+    static char out[FLOAT_FORMAT_MAX_LENGTH];
+    size_t length = float_format(value, digits, out);
+    CHECK(length == strlen(out));
+    CHECK(length < FLOAT_FORMAT_MAX_LENGTH);
+    return out;
+}
+
+static void test_shortest_known_values(void) {
+    CHECK_STR(format(0.0, FLOAT_FORMAT_SHORTEST), "0");
+    CHECK_STR(format(3.3, FLOAT_FORMAT_SHORTEST), "3.3");
+    CHECK_STR(format(-22.9068467, FLOAT_FORMAT_SHORTEST), "-22.9068467");
+    CHECK_STR(format(0.1 + 0.2, FLOAT_FORMAT_SHORTEST), "0.30000000000000004");
+    CHECK_STR(format(1e21, FLOAT_FORMAT_SHORTEST), "1e21");
+    CHECK_STR(format(1.5e-9, FLOAT_FORMAT_SHORTEST), "1.5e-9");
+    CHECK_STR(format(123456.0, FLOAT_FORMAT_SHORTEST), "123456");
+}
+
+static void test_non_finite(void) {
+    CHECK_STR(format(NAN, FLOAT_FORMAT_SHORTEST), "nan");
+    CHECK_STR(format(INFINITY, FLOAT_FORMAT_SHORTEST), "inf");
+    CHECK_STR(format(-INFINITY, FLOAT_FORMAT_SHORTEST), "-inf");
+}
+
+static void test_significant_digits(void) {
+    CHECK_STR(format(3.14159265, 3), "3.14");
+    CHECK_STR(format(2.5, 4), "2.5");      // Trailing zeros are dropped
+    CHECK_STR(format(99.96, 3), "100");    // Rounding carries into a new digit
+    CHECK_STR(format(-0.000123456, 2), "-0.00012");
+}
+
+// xorshift64*: reproducible bit patterns covering every exponent
+static uint64_t next_random(uint64_t* state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717ULL;
+}
+
+static void test_random_values_round_trip(void) {
+    uint64_t state = 88172645463325252ULL;
+    int mismatches = 0;
+    for (int i = 0; i < 200000; i++) {
+        uint64_t bits = next_random(&state);
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        if (!isfinite(value)) continue;
+
+        char out[FLOAT_FORMAT_MAX_LENGTH];
+        float_format(value, FLOAT_FORMAT_SHORTEST, out);
+        if (strtod(out, NULL) != value) {
+            if (mismatches++ < 5) fprintf(stderr, "%.17g was written as %s\n", value, out);
+        }
+    }
+    CHECK(mismatches == 0);
+}
+
+static void test_shortest_is_not_longer_than_printf(void) {
+    uint64_t state = 1181783497276652981ULL;
+    for (int i = 0; i < 20000; i++) {
+        double value = (double)(next_random(&state) >> 11) / 9007199254740992.0 * 1000.0;
+        char out[FLOAT_FORMAT_MAX_LENGTH];
+        char reference[64];
+        float_format(value, FLOAT_FORMAT_SHORTEST, out);
+        snprintf(reference, sizeof(reference), "%.17g", value);
+        CHECK(strlen(out) <= strlen(reference));
+    }
+}
+
+int main(void) {
+    TEST_RUN(test_shortest_known_values);
+    TEST_RUN(test_non_finite);
+    TEST_RUN(test_significant_digits);
+    TEST_RUN(test_random_values_round_trip);
+    TEST_RUN(test_shortest_is_not_longer_than_printf);
+    return TEST_EXIT_CODE();
+}
@@ -0,0 +1,132 @@
+// test_offline_format.c - Framing, checksums and torn-write detection of offline log members
+#include "OfflineFormat.h"
+#include "test_util.h"
+
+static const char g_lines[] = "m,source=a v=1 1700000000\nm,source=a v=2 1700000001\nm,source=a v=3 1700000002\n";
+
+typedef struct {
+    char text[256];
+    size_t size;
+} Inflated;
+
+static bool collect(const void* data, size_t size, void* user_context) {
+    Inflated* inflated = user_context;
+    if (inflated->size + size >= sizeof(inflated->text)) return false;
+    memcpy(inflated->text + inflated->size, data, size);
+    inflated->size += size;
+    inflated->text[inflated->size] = '\0';
+    return true;
+}
+
+// Encodes g_lines as one member; caller frees
+static unsigned char* encode_member(size_t* size) {
+    GzipCompressor* compressor = gzip_compressor_create(6);
+    unsigned char* member = NULL;
+    size_t capacity = 0;
+    struct iovec iov[2] = {
+        { .iov_base = (void*)g_lines, .iov_len = 26 }, // Split across pieces on purpose
+        { .iov_base = (void*)(g_lines + 26), .iov_len = sizeof(g_lines) - 1 - 26 },
+    };
+    CHECK(offline_format_encode(compressor, iov, 2, &member, &capacity, size));
+    gzip_compressor_destroy(compressor);
+    return member;
+}
+
+static void test_round_trip(void) {
+    size_t size = 0;
+    unsigned char* member = encode_member(&size);
+    OfflineFrame frame;
+    CHECK(offline_format_parse(member, size, &frame) == OFFLINE_FRAME_OK);
+    CHECK(frame.size == size);
+    CHECK(frame.line_count == 3);
+
+    // A plain gzip reader sees an ordinary member
+    Inflated inflated = { .size = 0 };
+    CHECK(gzip_decompress_stream(member, size, 64, collect, &inflated));
+    CHECK_STR(inflated.text, g_lines);
+    free(member);
+}
+
+static void test_parse_stops_at_member_end(void) {
+    size_t size = 0;
+    unsigned char* member = encode_member(&size);
+    unsigned char* two = malloc(2 * size);
+    memcpy(two, member, size);
+    memcpy(two + size, member, size);
+
+    OfflineFrame frame;
+    CHECK(offline_format_parse(two, 2 * size, &frame) == OFFLINE_FRAME_OK);
+    CHECK(frame.size == size);
+    CHECK(offline_format_parse(two + frame.size, size, &frame) == OFFLINE_FRAME_OK);
+    free(two);
+    free(member);
+}
+
+static void test_every_torn_prefix_is_truncated(void) {
+    size_t size = 0;
+    unsigned char* member = encode_member(&size);
+    for (size_t available = 0; available < size; available++) {
+        OfflineFrame frame;
+        OfflineFrameStatus status = offline_format_parse(member, available, &frame);
+        if (status != OFFLINE_FRAME_TRUNCATED) {
+            fprintf(stderr, "prefix of %zu bytes parsed as %d\n", available, (int)status);
+        }
+        CHECK(status == OFFLINE_FRAME_TRUNCATED);
+    }
+    free(member);
+}
+
+static void test_flipped_bits_are_detected(void) {
+    size_t size = 0;
+    unsigned char* member = encode_member(&size);
+    for (size_t i = 0; i < size; i++) {
+        member[i] ^= 0x10;
+        OfflineFrame frame;
+        OfflineFrameStatus status = offline_format_parse(member, size, &frame);
+        if (status == OFFLINE_FRAME_OK) {
+            fprintf(stderr, "flipped bit in byte %zu went unnoticed\n", i);
+        }
+        CHECK(status != OFFLINE_FRAME_OK);
+        member[i] ^= 0x10;
+    }
+    free(member);
+}
+
+static void test_foreign_data_is_invalid(void) {
+    OfflineFrame frame;
+    const char text[] = "m v=1 1700000000\n";
+    CHECK(offline_format_parse((const unsigned char*)text, sizeof(text) - 1, &frame) == OFFLINE_FRAME_INVALID);
+
+    // A plain gzip member has no frame header
+    GzipCompressor* compressor = gzip_compressor_create(6);
+    unsigned char* plain = NULL;
+    size_t capacity = 0;
+    size_t size = 0;
+    gzip_compressor_begin(compressor, &plain, &capacity);
+    gzip_compressor_append(compressor, text, sizeof(text) - 1);
+    CHECK(gzip_compressor_finish(compressor, &size));
+    CHECK(offline_format_parse(plain, size, &frame) == OFFLINE_FRAME_INVALID);
+    free(plain);
+    gzip_compressor_destroy(compressor);
+}
+
+static void test_subfield_without_checksum_is_invalid(void) {
+    size_t size = 0;
+    unsigned char* member = encode_member(&size);
+    // Shrink the "OL" subfield to size and line count only, as an early draft wrote it
+    member[10] = 12; // XLEN
+    member[14] = 8;  // Subfield length
+    OfflineFrame frame;
+    CHECK(offline_format_parse(member, size, &frame) == OFFLINE_FRAME_INVALID);
+    free(member);
+}
+
+int main(void) {
+    TEST_RUN(test_round_trip);
+    TEST_RUN(test_parse_stops_at_member_end);
+    TEST_RUN(test_every_torn_prefix_is_truncated);
+    TEST_RUN(test_flipped_bits_are_detected);
+    TEST_RUN(test_foreign_data_is_invalid);
+    TEST_RUN(test_subfield_without_checksum_is_invalid);
+    return TEST_EXIT_CODE();
+}
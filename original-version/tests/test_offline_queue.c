@@ -0,0 +1,290 @@
+// test_offline_queue.c - Replay cursors, torn segments, quarantine and the disk budget of the offline log
+#include <dirent.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "OfflineQueue.h"
+#include "Compression.h"
+#include "test_util.h"
+
+#define QUEUE_DIRECTORY "logs/offline"
+#define MAX_POINTS 30000
+
+// A fake endpoint: counts every point it accepts by the value of its `v` field
+typedef struct {
+    int budget;               // Batches accepted before it starts failing
+    int fail_request;         // Request number that fails once with a transient error, or 0
+    bool reject_all;          // Refuse every body as bad content
+    int requests;
+    unsigned char seen[MAX_POINTS];
+    double min_value;         // Smallest `v_min` of a downsampled line
+    char text[1024 * 1024];
+    size_t text_size;
+} FakeServer;
+
+static bool collect_body(const void* data, size_t size, void* user_context) {
+    FakeServer* server = user_context;
+    if (server->text_size + size >= sizeof(server->text)) return false;
+    memcpy(server->text + server->text_size, data, size);
+    server->text_size += size;
+    server->text[server->text_size] = '\0';
+    return true;
+}
+
+static OfflineSendResult fake_send(const void* data, size_t size, void* user_context) {
+    FakeServer* server = user_context;
+    server->requests++;
+    if (server->requests == server->fail_request || server->budget-- <= 0) return OFFLINE_SEND_FAILED;
+
+    server->text_size = 0;
+    if (!gzip_decompress_stream(data, size, 64 * 1024, collect_body, server)) return OFFLINE_SEND_FAILED;
+    if (server->reject_all || strstr(server->text, "bad") != NULL) return OFFLINE_SEND_REJECTED;
+
+    for (char* line = server->text; *line; line = strchr(line, '\n') + 1) {
+        int value = -1;
+        char* v_min = strstr(line, "v_min=");
+        if (v_min && v_min < strchr(line, '\n')) {
+            double min = atof(v_min + 6);
+            if (min < server->min_value) server->min_value = min;
+        } else if (sscanf(line, "m v=%d", &value) == 1 && value >= 0 && value < MAX_POINTS) {
+            server->seen[value]++;
+        }
+    }
+    return OFFLINE_SEND_OK;
+}
+
+static FakeServer* fake_server_create(int budget) {
+    FakeServer* server = calloc(1, sizeof(*server));
+    server->budget = budget;
+    server->min_value = 1e300;
+    return server;
+}
+
+// Checks that points [first, last) arrived exactly once
+static void check_exactly_once(const FakeServer* server, int first, int last) {
+    int missing = 0;
+    int duplicated = 0;
+    for (int i = first; i < last; i++) {
+        missing += server->seen[i] == 0;
+        duplicated += server->seen[i] > 1;
+    }
+    if (missing || duplicated) fprintf(stderr, "%d points missing, %d sent twice\n", missing, duplicated);
+    CHECK(missing == 0 && duplicated == 0);
+}
+
+static void start_queue(size_t segment_bytes, unsigned long long max_bytes) {
+    CHECK(system("rm -rf logs") == 0);
+    OfflineQueueConfig config = {
+        .commit_interval_ms = 60000, // Only offline_queue_flush() commits
+        .commit_bytes = 2048,        // Small members, so replay batches stop part way through a segment
+        .segment_bytes = segment_bytes,
+        .gzip_level = 1,
+        .max_bytes = max_bytes,
+        .downsample_interval_s = 60,
+        .compress_workers = 0,
+    };
+    offline_queue_init(QUEUE_DIRECTORY, &config);
+}
+
+static void restart_queue(size_t segment_bytes) {
+    offline_queue_shutdown();
+    OfflineQueueConfig config = {
+        .commit_interval_ms = 60000,
+        .commit_bytes = 2048,
+        .segment_bytes = segment_bytes,
+        .gzip_level = 1,
+    };
+    offline_queue_init(QUEUE_DIRECTORY, &config);
+}
+
+static void add_points(int first, int last) {
+    char text[2048];
+    size_t used = 0;
+    for (int i = first; i < last; i++) {
+        used += (size_t)snprintf(text + used, sizeof(text) - used, "m v=%d %d\n", i, 1700000000 + i);
+        if (used > sizeof(text) - 64 || i == last - 1) {
+            offline_queue_add_lines(text, used);
+            used = 0;
+        }
+    }
+    offline_queue_flush();
+}
+
+static size_t count_files(const char* suffix) {
+    DIR* dir = opendir(QUEUE_DIRECTORY);
+    size_t count = 0;
+    struct dirent* entry;
+    while (dir && (entry = readdir(dir)) != NULL) {
+        size_t length = strlen(entry->d_name);
+        if (length > strlen(suffix) && strcmp(entry->d_name + length - strlen(suffix), suffix) == 0) count++;
+    }
+    if (dir) closedir(dir);
+    return count;
+}
+
+static char* read_file(const char* path) {
+    FILE* file = fopen(path, "r");
+    if (!file) return NULL;
+    char* text = calloc(1, 1024 * 1024);
+    fread(text, 1, 1024 * 1024 - 1, file);
+    fclose(file);
+    return text;
+}
+
+static void test_newest_first_resumes_every_segment(void) {
+    start_queue(16 * 1024 * 1024, 0);
+    offline_queue_set_replay_order(OFFLINE_REPLAY_NEWEST_FIRST);
+    FakeServer* server = fake_server_create(1);
+
+    add_points(0, 12000);
+    offline_queue_process(fake_send, server);  // First batch of segment 1, then a failure
+    add_points(12000, 24000);
+    server->budget = 1;
+    offline_queue_process(fake_send, server);  // Segment 2 goes first and stops half way too
+    CHECK(count_files(".cursor") == 2);
+
+    server->budget = 1000;
+    offline_queue_process(fake_send, server);
+    check_exactly_once(server, 0, 24000);
+    CHECK(count_files(".cursor") == 0);
+    CHECK(offline_queue_size_bytes() == 0);      // Only the new, empty active segment is left
+    offline_queue_set_replay_order(OFFLINE_REPLAY_OLDEST_FIRST);
+    free(server);
+}
+
+static void test_oldest_first_seals_only_when_reached(void) {
+    start_queue(16 * 1024 * 1024, 0);
+    FakeServer* server = fake_server_create(1);
+    add_points(0, 12000);
+    offline_queue_process(fake_send, server);  // Seals segment 1 and stops in it
+    add_points(12000, 13000);
+    offline_queue_process(fake_send, server);  // Fails in segment 1: segment 2 stays active
+    CHECK(count_files(".seg") == 2);
+
+    server->budget = 1000;
+    offline_queue_process(fake_send, server);
+    check_exactly_once(server, 0, 13000);
+    CHECK(offline_queue_size_bytes() == 0);
+    free(server);
+}
+
+static void test_torn_segment_is_cut_back_at_startup(void) {
+    start_queue(16 * 1024 * 1024, 0);
+    add_points(0, 100);
+    add_points(100, 200);   // Second member, torn below
+    offline_queue_shutdown();
+
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%016llu.seg", QUEUE_DIRECTORY, 1ULL);
+    struct stat st;
+    CHECK(stat(path, &st) == 0);
+    CHECK(truncate(path, st.st_size - 5) == 0); // A commit cut short by a power loss
+
+    restart_queue(16 * 1024 * 1024);
+    struct stat recovered;
+    CHECK(stat(path, &recovered) == 0);
+    CHECK(recovered.st_size < st.st_size - 5);
+
+    FakeServer* server = fake_server_create(1000);
+    offline_queue_process(fake_send, server);
+    check_exactly_once(server, 0, 100);
+    CHECK(server->seen[150] == 0);
+    free(server);
+}
+
+static void test_quarantine_is_written_once(void) {
+    start_queue(16 * 1024 * 1024, 0);
+    char text[64 * 1024];
+    size_t used = 0;
+    for (int i = 0; i < 200; i++) {
+        const char* format = i == 40 || i == 170 ? "bad v=%d %d\n" : "m v=%d %d\n";
+        used += (size_t)snprintf(text + used, sizeof(text) - used, format, i, 1700000000 + i);
+    }
+    offline_queue_add_lines(text, used);
+    offline_queue_flush();
+
+    FakeServer* server = fake_server_create(1000);
+    server->fail_request = 6; // Transient failure half way through the search
+    offline_queue_process(fake_send, server);
+    CHECK(access(QUEUE_DIRECTORY "/quarantine.txt", F_OK) != 0);
+
+    offline_queue_process(fake_send, server);
+    char* quarantine = read_file(QUEUE_DIRECTORY "/quarantine.txt");
+    CHECK_STR(quarantine, "bad v=40 1700000040\nbad v=170 1700000170\n");
+    free(quarantine);
+    for (int i = 0; i < 200; i++) {
+        if (i != 40 && i != 170) CHECK(server->seen[i] >= 1);
+    }
+    free(server);
+}
+
+static void test_bisection_depth_is_capped(void) {
+    start_queue(16 * 1024 * 1024, 0);
+    add_points(0, 4000);
+    FakeServer* server = fake_server_create(100000);
+    server->reject_all = true;
+    offline_queue_process(fake_send, server);
+    CHECK(server->requests <= 1 + 511);
+
+    char* quarantine = read_file(QUEUE_DIRECTORY "/quarantine.txt");
+    size_t lines = 0;
+    for (const char* c = quarantine; c && *c; c++) lines += *c == '\n';
+    CHECK(lines == 4000);
+    CHECK(count_files(".cursor") == 0);
+    free(quarantine);
+    free(server);
+}
+
+static void test_compaction_keeps_only_unsent_data(void) {
+    start_queue(16 * 1024 * 1024, 40000);
+    add_points(0, 12000);
+    FakeServer* server = fake_server_create(1);
+    offline_queue_process(fake_send, server);  // Part of segment 1 acknowledged
+    int acknowledged = 0;
+    while (acknowledged < MAX_POINTS && server->seen[acknowledged]) acknowledged++;
+    CHECK(acknowledged > 0 && acknowledged < 12000);
+
+    offline_queue_enforce_quota();
+    CHECK(count_files(".agg") == 1);
+    CHECK(count_files(".cursor") == 0);
+
+    server->budget = 1000;
+    offline_queue_process(fake_send, server);
+    CHECK(server->min_value == (double)acknowledged); // Nothing before the cursor came back
+    free(server);
+}
+
+static void test_size_does_not_touch_the_queue(void) {
+    start_queue(16 * 1024 * 1024, 0);
+    add_points(0, 100);
+    offline_queue_shutdown();
+    // An interrupted compaction leaves the raw segment next to its aggregate
+    CHECK(system("cp " QUEUE_DIRECTORY "/0000000000000001.seg " QUEUE_DIRECTORY "/0000000000000001.agg") == 0);
+    CHECK(offline_queue_size_bytes() > 0);
+    CHECK(count_files(".seg") == 1);
+    CHECK(count_files(".agg") == 1);
+}
+
+int main(void) {
+    char directory[] = "/tmp/offline-queue-test-XXXXXX";
+    if (!mkdtemp(directory) || chdir(directory) != 0) {
+        perror("Could not create the test directory");
+        return EXIT_FAILURE;
+    }
+
+    TEST_RUN(test_newest_first_resumes_every_segment);
+    TEST_RUN(test_oldest_first_seals_only_when_reached);
+    TEST_RUN(test_torn_segment_is_cut_back_at_startup);
+    TEST_RUN(test_quarantine_is_written_once);
+    TEST_RUN(test_bisection_depth_is_capped);
+    TEST_RUN(test_compaction_keeps_only_unsent_data);
+    TEST_RUN(test_size_does_not_touch_the_queue);
+    offline_queue_shutdown();
+
+    if (chdir("/") == 0) {
+        char command[128];
+        snprintf(command, sizeof(command), "rm -rf %s", directory);
+        CHECK(system(command) == 0);
+    }
+    return TEST_EXIT_CODE();
+}
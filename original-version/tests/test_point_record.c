@@ -0,0 +1,104 @@
+// test_point_record.c - Encoding frames as point records and rendering them as line protocol
+#include <math.h>
+#include "PointRecord.h"
+#include "test_util.h"
+
+static const char* const g_tag_keys[] = { "source" };
+static const char* const g_tag_values[] = { "instrumentacao" };
+static const char* const g_field_names[] = { "ch0", "ch1", "latitude", "longitude" };
+
+static void fill_frame(MeasurementFrame* frame, size_t count) {
+    static const double values[] = { 12.5, -0.25, -22.9068467, -43.1728965, 1.0, 2.0, 3.0, 4.0 };
+    memset(frame, 0, sizeof(*frame));
+    frame->timestamp = 1700000000;
+    frame->count = count;
+    for (size_t i = 0; i < count; i++) {
+        frame->values[i].value = values[i];
+    }
+}
+
+static void test_register_is_idempotent(void) {
+    int first = point_schema_register("measurements", g_tag_keys, g_tag_values, 1, g_field_names, 4);
+    int second = point_schema_register("measurements", g_tag_keys, g_tag_values, 1, g_field_names, 4);
+    CHECK(first >= 0);
+    CHECK(first == second);
+    CHECK(point_schema_register("measurements", g_tag_keys, g_tag_values, 1, g_field_names, 3) != first);
+}
+
+static void test_register_rejects_invalid_names(void) {
+    static const char* const bad_fields[] = { "ch 0" };
+    CHECK(point_schema_register("_internal", g_tag_keys, g_tag_values, 1, g_field_names, 4) == -1);
+    CHECK(point_schema_register("measurements", g_tag_keys, g_tag_values, 1, bad_fields, 1) == -1);
+}
+
+static void test_encode_and_render(void) {
+    int schema_id = point_schema_register("measurements", g_tag_keys, g_tag_values, 1, g_field_names, 4);
+    MeasurementFrame frame;
+    fill_frame(&frame, 4);
+    unsigned char record[POINT_RECORD_MAX_SIZE];
+    size_t size = point_record_encode(schema_id, &frame, record, sizeof(record));
+    CHECK(size > 0);
+
+    LineProtocolBuilder* builder = lp_builder_create_default();
+    CHECK(point_record_render(record, size, builder) == LP_SUCCESS);
+    CHECK_STR(lp_view(builder), "measurements,source=instrumentacao ch0=12.5,ch1=-0.25,latitude=-22.9068467,"
+                                "longitude=-43.1728965 1700000000");
+    lp_builder_destroy(builder);
+}
+
+static void test_full_frame_fits_max_size(void) {
+    static const char* const names[FRAME_MAX_VALUES] = { "a", "b", "c", "d", "e", "f", "g", "h" };
+    _Static_assert(FRAME_MAX_VALUES == 8, "update the field names above");
+    int schema_id = point_schema_register("full", NULL, NULL, 0, names, FRAME_MAX_VALUES);
+    CHECK(schema_id >= 0);
+
+    MeasurementFrame frame;
+    fill_frame(&frame, FRAME_MAX_VALUES);
+    frame.timestamp = INT64_MIN; // Longest timestamp varint
+    unsigned char record[POINT_RECORD_MAX_SIZE];
+    size_t size = point_record_encode(schema_id, &frame, record, sizeof(record));
+    CHECK(size > 0 && size <= POINT_RECORD_MAX_SIZE);
+
+    LineProtocolBuilder* builder = lp_builder_create_default();
+    CHECK(point_record_render(record, size, builder) == LP_SUCCESS);
+    lp_builder_destroy(builder);
+}
+
+static void test_encode_failures(void) {
+    int schema_id = point_schema_register("measurements", g_tag_keys, g_tag_values, 1, g_field_names, 4);
+    MeasurementFrame frame;
+    unsigned char record[POINT_RECORD_MAX_SIZE];
+
+    fill_frame(&frame, 3); // Schema has four fields
+    CHECK(point_record_encode(schema_id, &frame, record, sizeof(record)) == 0);
+
+    fill_frame(&frame, 4);
+    CHECK(point_record_encode(POINT_SCHEMA_MAX + 1, &frame, record, sizeof(record)) == 0);
+    CHECK(point_record_encode(schema_id, &frame, record, 8) == 0);
+
+    frame.values[1].value = NAN;
+    CHECK(point_record_encode(schema_id, &frame, record, sizeof(record)) == 0);
+}
+
+static void test_render_rejects_truncated_record(void) {
+    int schema_id = point_schema_register("measurements", g_tag_keys, g_tag_values, 1, g_field_names, 4);
+    MeasurementFrame frame;
+    fill_frame(&frame, 4);
+    unsigned char record[POINT_RECORD_MAX_SIZE];
+    size_t size = point_record_encode(schema_id, &frame, record, sizeof(record));
+
+    LineProtocolBuilder* builder = lp_builder_create_default();
+    CHECK(point_record_render(record, size - 1, builder) != LP_SUCCESS);
+    CHECK(point_record_render(record, 0, builder) != LP_SUCCESS);
+    lp_builder_destroy(builder);
+}
+
+int main(void) {
+    TEST_RUN(test_register_is_idempotent);
+    TEST_RUN(test_register_rejects_invalid_names);
+    TEST_RUN(test_encode_and_render);
+    TEST_RUN(test_full_frame_fits_max_size);
+    TEST_RUN(test_encode_failures);
+    TEST_RUN(test_render_rejects_truncated_record);
+    return TEST_EXIT_CODE();
+}
@@ -0,0 +1,47 @@
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+/**
+ * @file test_util.h
+ * @brief Minimal assertions for the unit tests run by CTest.
+ *
+ * A failed CHECK prints its location and keeps going, so one run reports
+ * every broken expectation. TEST_RUN prints one line per test and
+ * TEST_EXIT_CODE turns the failure count into the process exit status.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int g_test_failures;
+
+#define CHECK(condition)                                                                  \
+    do {                                                                                  \
+        if (!(condition)) {                                                               \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            g_test_failures++;                                                            \
+        }                                                                                 \
+    } while (0)
+
+#define CHECK_STR(actual, expected)                                                                 \
+    do {                                                                                            \
+        const char* actual_ = (actual);                                                             \
+        const char* expected_ = (expected);                                                         \
+        if (!actual_ || strcmp(actual_, expected_) != 0) {                                          \
+            fprintf(stderr, "%s:%d: expected \"%s\", got \"%s\"\n", __FILE__, __LINE__, expected_, \
+                    actual_ ? actual_ : "(null)");                                                  \
+            g_test_failures++;                                                                      \
+        }                                                                                           \
+    } while (0)
+
+#define TEST_RUN(test)                                                               \
+    do {                                                                             \
+        int failures_before_ = g_test_failures;                                      \
+        test();                                                                      \
+        printf("%s: %s\n", #test, g_test_failures == failures_before_ ? "ok" : "FAILED"); \
+    } while (0)
+
+#define TEST_EXIT_CODE() (g_test_failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE)
+
+#endif // TEST_UTIL_H